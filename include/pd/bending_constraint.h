@@ -0,0 +1,112 @@
+#ifndef PD_PD_BENDING_CONSTRAINT_H
+#define PD_PD_BENDING_CONSTRAINT_H
+
+#include "constraint.h"
+
+#include <array>
+#include <cassert>
+
+namespace pd {
+
+/**
+ * Rest state of the hinge formed by the two triangles (v1, v2, v3) and (v2, v1, v4)
+ * sharing the edge (v1, v2). The discrete mean curvature vector of the hinge is
+ * h = sum_k K(k) * xk, with the cotangent weights K of Bergou et al., "A Quadratic
+ * Bending Model for Inextensible Surfaces" (2006), and vanishes for flat hinges.
+ */
+struct packed_hinge_t
+{
+    using scalar_type = double;
+
+    std::array<std::uint32_t, 4u> offsets; ///< Offsets 3*vi of the vertices in q and b
+    Eigen::Vector4d K;                      ///< Cotangent weights of the hinge's vertices
+    scalar_type weight;                     ///< wi * 3 / (A1 + A2)
+    Eigen::Vector3d h0;                     ///< Rest mean curvature vector, 0 for flat hinges
+
+    static packed_hinge_t
+    pack(std::vector<std::uint32_t> const& indices, scalar_type wi, Eigen::MatrixXd const& p);
+
+    /**
+     * Non-zero entries weight * K(a) * K(c) * I of the hinge's wi * (Ai*Si)^T * (Ai*Si)
+     */
+    std::vector<Eigen::Triplet<scalar_type>> triplets() const;
+
+    /**
+     * Hashes the cotangent weights and the weight, which determine triplets()
+     */
+    std::size_t hash() const;
+};
+
+/**
+ * Bending constraint on a hinge, whose Ai*Si*q is the mean curvature vector h of
+ * packed_hinge_t. The projection keeps the direction of h and restores its rest
+ * length, such that the constraint preserves the rest dihedral angle, as the bending
+ * constraints of Bouaziz et al., "Projective Dynamics" (2014). The gather, the 3-vector
+ * projection and the scatter only touch the 4 vertices of the hinge.
+ */
+class bending_constraint_t : public constraint_t
+{
+  public:
+    using self_type          = bending_constraint_t;
+    using base_type          = constraint_t;
+    using index_type         = std::uint32_t;
+    using scalar_type        = double;
+    using masses_type        = Eigen::VectorXd;
+    using positions_type     = typename base_type::positions_type;
+    using q_type             = typename base_type::q_type;
+    using q_float_type       = typename base_type::q_float_type;
+    using gradient_type      = typename base_type::gradient_type;
+    using sparse_matrix_type = Eigen::SparseMatrix<scalar_type>;
+
+  public:
+    bending_constraint_t(
+        std::initializer_list<index_type> indices,
+        scalar_type wi,
+        positions_type const& p);
+
+    /**
+     * Restores a constraint from its stored state, see snapshot.h
+     */
+    bending_constraint_t(
+        std::vector<index_type> indices,
+        scalar_type wi,
+        packed_hinge_t const& packed);
+
+    virtual std::unique_ptr<constraint_t> clone() const override
+    {
+        return std::make_unique<self_type>(*this);
+    }
+
+    virtual constraint_type_t type() const override { return constraint_type_t::bending; }
+
+    virtual scalar_type
+    project_wi_SiT_AiT_Bi_pi(q_type const& q, Eigen::VectorXd& b) const override;
+    virtual float
+    project_wi_SiT_AiT_Bi_pi(q_float_type const& q, Eigen::VectorXf& b) const override;
+
+    virtual std::vector<Eigen::Triplet<scalar_type>>
+    get_wi_SiT_AiT_Ai_Si(positions_type const& p, masses_type const& M) const override;
+    virtual std::size_t hash_rest_state() const override { return packed_.hash(); }
+
+    virtual scalar_type evaluate(positions_type const& p, masses_type const& M) const override;
+
+    packed_hinge_t const& packed() const { return packed_; }
+
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+  protected:
+    virtual void remap_indices(std::vector<index_type> const& index_map) override;
+
+  private:
+    template <class Scalar>
+    Scalar project(
+        Eigen::Matrix<Scalar, Eigen::Dynamic, 1> const& q,
+        Eigen::Matrix<Scalar, Eigen::Dynamic, 1>& b) const;
+
+    packed_hinge_t packed_;
+    scalar_type rest_curvature_; ///< Rest length of the mean curvature vector
+};
+
+} // namespace pd
+
+#endif // PD_PD_BENDING_CONSTRAINT_H
@@ -0,0 +1,83 @@
+#ifndef PD_PD_CHEBYSHEV_JACOBI_H
+#define PD_PD_CHEBYSHEV_JACOBI_H
+
+#include "linear_solver.h"
+
+#include <Eigen/Core>
+#include <Eigen/SparseCore>
+#include <vector>
+
+namespace pd {
+
+/**
+ * Inexact global step performing a single block Jacobi sweep
+ *
+ *     x <- x + D^-1 * (b - A*x)
+ *
+ * per solve, for the block diagonal D of A made of the 3x3 diagonal block of each
+ * vertex. Unlike the scalar diagonal, the blocks keep the coupling of a vertex's x, y
+ * and z coordinates that contacts and anisotropic constraints add to the system
+ * matrix. Vertices are swept in parallel, and compute() only
+ * stores A, so changes of the system matrix (pinning, topology changes, transient
+ * constraints) cost an assembly but no factorization. One sweep per local-global
+ * iteration converges slowly on its own, solver_t accelerates the iterates with
+ * chebyshev_acceleration_t.
+ */
+class jacobi_solver_t : public linear_solver_t
+{
+  public:
+    using row_major_matrix_type = Eigen::SparseMatrix<scalar_type, Eigen::RowMajor>;
+
+    virtual void compute(sparse_matrix_type const& A) override;
+
+    virtual int solve(
+        vector_type const& b,
+        vector_type& x,
+        convergence_criteria_t const& criteria) const override;
+
+    virtual bool set_update(sparse_matrix_type const& C) override;
+
+  private:
+    sparse_matrix_type A_;                        ///< System matrix without update
+    row_major_matrix_type A_plus_C_;              ///< Updated system matrix, swept in parallel
+    std::vector<Eigen::Matrix3d> inverse_blocks_; ///< Inverted 3x3 diagonal blocks of A + C
+};
+
+/**
+ * Chebyshev semi-iterative acceleration of a stationary iteration q_hat = f(q), after
+ * Wang, "A Chebyshev Semi-Iterative Approach for Accelerating Projective and
+ * Position-based Dynamics" (2015). Iterate k+1 extrapolates from the two previous
+ * iterates,
+ *
+ *     q(k+1) = omega(k+1) * (gamma * (q_hat(k+1) - q(k)) + q(k) - q(k-1)) + q(k-1),
+ *
+ * where omega follows the Chebyshev recurrence for the estimated spectral radius rho
+ * of the iteration, and gamma under-relaxes the Jacobi update. The first delay
+ * iterations are not extrapolated (omega = 1). An overestimated rho makes the
+ * iterates oscillate, solver_t then restarts the acceleration as soon as the
+ * projective dynamics objective increases.
+ */
+struct chebyshev_acceleration_t
+{
+    using scalar_type = double;
+
+    scalar_type rho   = 0.999; ///< Estimated spectral radius of the iteration
+    scalar_type gamma = 0.9;   ///< Under-relaxation of the iteration
+    int delay         = 2;     ///< Iterations before acceleration starts
+
+    /**
+     * omega(k+1), given omega(k)
+     */
+    scalar_type omega(int k, scalar_type previous_omega) const
+    {
+        if (k < delay)
+            return scalar_type{1.};
+        if (k == delay)
+            return scalar_type{2.} / (scalar_type{2.} - rho * rho);
+        return scalar_type{4.} / (scalar_type{4.} - rho * rho * previous_omega);
+    }
+};
+
+} // namespace pd
+
+#endif // PD_PD_CHEBYSHEV_JACOBI_H
@@ -0,0 +1,132 @@
+#ifndef PD_PD_COLLISION_H
+#define PD_PD_COLLISION_H
+
+#include "deformable_mesh.h"
+
+#include <Eigen/Core>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+namespace pd {
+
+/**
+ * Uniform grid hashing the surface faces of a mesh by the cells their (inflated)
+ * swept bounding boxes overlap, that is, the boxes bounding a face at the start and
+ * at the end of a step. The hash persists across frames: update() recomputes the
+ * cell range of every face in parallel and only rehashes the faces whose range
+ * changed, which are few when the mesh moves by less than a cell per frame.
+ */
+class spatial_hash_t
+{
+  public:
+    using scalar_type = double;
+    using cell_type   = Eigen::Vector3i;
+
+    scalar_type cell_size() const { return cell_size_; }
+    void set_cell_size(scalar_type cell_size)
+    {
+        cell_size_ = cell_size;
+        clear();
+    }
+    void clear()
+    {
+        cells_.clear();
+        ranges_.clear();
+    }
+
+    void update(
+        Eigen::MatrixXd const& p0,
+        Eigen::MatrixXd const& p,
+        Eigen::MatrixXi const& F,
+        scalar_type margin);
+
+    cell_type cell_of(Eigen::Vector3d const& x) const;
+    /**
+     * Faces whose inflated bounding box overlaps the cell, nullptr if there are none
+     */
+    std::vector<int> const* faces_in(cell_type const& cell) const;
+    /**
+     * Faces whose inflated bounding box overlaps a cell of the box [lower, upper],
+     * without duplicates
+     */
+    std::vector<int> faces_in(Eigen::Vector3d const& lower, Eigen::Vector3d const& upper) const;
+
+    /**
+     * Number of faces rehashed by the last update
+     */
+    std::size_t rehashed_face_count() const { return rehashed_face_count_; }
+
+  private:
+    struct range_t
+    {
+        cell_type min;
+        cell_type max;
+    };
+
+    static std::uint64_t key(cell_type const& cell);
+    void insert(int f, range_t const& range);
+    void erase(int f, range_t const& range);
+
+    std::unordered_map<std::uint64_t, std::vector<int>> cells_;
+    std::vector<range_t> ranges_; ///< Cell range of each face at the last update
+    scalar_type cell_size_           = scalar_type{0.};
+    std::size_t rehashed_face_count_ = 0u;
+};
+
+/**
+ * Finds contacts of a mesh with the floor and with its own surface, and turns them
+ * into half-space constraints for the local step. Surface vertices closer than
+ * thickness to a surface face (in the spatial hash's broad phase, then by an exact
+ * point-triangle test) are constrained to stay thickness away from the face's plane,
+ * on the side they were on at the start of the step.
+ */
+class collision_detector_t
+{
+  public:
+    using scalar_type   = double;
+    using contacts_type = std::vector<std::unique_ptr<constraint_t>>;
+
+    bool is_floor_active() const { return is_floor_active_; }
+    scalar_type floor_height() const { return floor_height_; }
+    void set_floor(bool is_active, scalar_type height = scalar_type{0.})
+    {
+        is_floor_active_ = is_active;
+        floor_height_    = height;
+    }
+    bool is_self_collision_active() const { return is_self_collision_active_; }
+    void set_self_collision_active(bool is_active) { is_self_collision_active_ = is_active; }
+    scalar_type thickness() const { return thickness_; }
+    void set_thickness(scalar_type thickness) { thickness_ = thickness; }
+    scalar_type contact_wi() const { return contact_wi_; }
+    void set_contact_wi(scalar_type wi) { contact_wi_ = wi; }
+
+    /**
+     * Detects the contacts of mesh moving from its current positions to the
+     * predicted positions p. Vertices are tested against the faces near their path,
+     * so fast vertices passing through a face within one step are caught.
+     */
+    contacts_type detect(deformable_mesh_t const& mesh, Eigen::MatrixXd const& p);
+
+    spatial_hash_t const& spatial_hash() const { return spatial_hash_; }
+    void reset() { spatial_hash_.set_cell_size(scalar_type{0.}); }
+
+  private:
+    void detect_self_collisions(
+        deformable_mesh_t const& mesh,
+        Eigen::MatrixXd const& p,
+        contacts_type& contacts);
+
+    spatial_hash_t spatial_hash_;
+    bool is_floor_active_          = false;
+    bool is_self_collision_active_ = false;
+    scalar_type floor_height_      = scalar_type{0.};
+    scalar_type thickness_         = scalar_type{0.01};
+    scalar_type contact_wi_        = scalar_type{1'000'000'000.};
+};
+
+} // namespace pd
+
+#endif // PD_PD_COLLISION_H
@@ -0,0 +1,213 @@
+#ifndef PD_PD_COMMUNICATOR_H
+#define PD_PD_COMMUNICATOR_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <tuple>
+#include <vector>
+
+namespace pd {
+
+/**
+ * Message passing between the ranks of a distributed simulation. Sends are
+ * buffered, that is, send() returns without waiting for the matching receive(),
+ * so ranks may exchange halos by first sending to and then receiving from all
+ * their neighbours.
+ */
+class communicator_t
+{
+  public:
+    using buffer_type = std::vector<double>;
+
+    virtual ~communicator_t() = default;
+
+    virtual int rank() const = 0;
+    virtual int size() const = 0;
+
+    virtual void send(int destination, int tag, buffer_type const& data) = 0;
+    /**
+     * Blocks until the message with the given tag from source arrived
+     */
+    virtual void receive(int source, int tag, buffer_type& data) = 0;
+    /**
+     * Returns the sum of value over all ranks, on every rank
+     */
+    virtual double all_reduce_sum(double value) = 0;
+};
+
+/**
+ * Shared memory transport between ranks running as threads of one process,
+ * a stand-in for MPI when developing or testing distributed simulations.
+ * all_reduce_sum() sums the ranks' values in rank order, whichever rank arrives
+ * last, such that it reduces to the same value as the other communicators.
+ */
+class local_transport_t
+{
+  public:
+    explicit local_transport_t(int size)
+        : size_(size), reduce_values_(static_cast<std::size_t>(size), 0.)
+    {
+    }
+
+    int size() const { return size_; }
+
+    void send(int source, int destination, int tag, std::vector<double> const& data);
+    void receive(int source, int destination, int tag, std::vector<double>& data);
+    double all_reduce_sum(int rank, double value);
+
+  private:
+    using mailbox_key_type = std::tuple<int, int, int>; ///< source, destination, tag
+
+    int size_;
+    std::mutex mutex_;
+    std::condition_variable condition_;
+    std::map<mailbox_key_type, std::deque<std::vector<double>>> mailboxes_;
+
+    std::vector<double> reduce_values_; ///< Value of each rank in the current reduction
+    int reduce_arrived_         = 0;
+    unsigned reduce_generation_ = 0u;
+    double reduce_result_       = 0.;
+};
+
+class local_communicator_t : public communicator_t
+{
+  public:
+    local_communicator_t(local_transport_t& transport, int rank)
+        : transport_(transport), rank_(rank)
+    {
+    }
+
+    virtual int rank() const override { return rank_; }
+    virtual int size() const override { return transport_.size(); }
+
+    virtual void send(int destination, int tag, buffer_type const& data) override
+    {
+        transport_.send(rank_, destination, tag, data);
+    }
+    virtual void receive(int source, int tag, buffer_type& data) override
+    {
+        transport_.receive(source, rank_, tag, data);
+    }
+    virtual double all_reduce_sum(double value) override
+    {
+        return transport_.all_reduce_sum(rank_, value);
+    }
+
+  private:
+    local_transport_t& transport_;
+    int rank_;
+};
+
+/**
+ * Runs f(communicator) on size ranks, each in its own thread, connected
+ * by a local_transport_t, and returns once all ranks returned
+ */
+void run_local_ranks(int size, std::function<void(communicator_t&)> const& f);
+
+#if !defined(_WIN32)
+
+/**
+ * Communicator between ranks running as processes of one machine, connected by one
+ * Unix domain socket per pair of ranks, see run_local_processes(). Sends are buffered
+ * by the sockets. While a send waits for room in its socket, the rank reads the
+ * messages of all its peers and queues them for later receives, so ranks sending to
+ * each other at the same time never deadlock. all_reduce_sum() sums on rank 0 in rank
+ * order, so every run reduces to the same value, and uses negative tags, which are
+ * reserved. Like MPI's default error handler, a lost connection terminates the rank.
+ */
+class socket_communicator_t : public communicator_t
+{
+  public:
+    /**
+     * sockets[r] is the connected socket to rank r, -1 for the own rank
+     */
+    socket_communicator_t(int rank, std::vector<int> sockets);
+    virtual ~socket_communicator_t() override;
+
+    socket_communicator_t(socket_communicator_t const&) = delete;
+    socket_communicator_t& operator=(socket_communicator_t const&) = delete;
+
+    virtual int rank() const override { return rank_; }
+    virtual int size() const override { return static_cast<int>(peers_.size()); }
+
+    virtual void send(int destination, int tag, buffer_type const& data) override;
+    virtual void receive(int source, int tag, buffer_type& data) override;
+    virtual double all_reduce_sum(double value) override;
+
+  private:
+    struct message_t
+    {
+        int tag;
+        buffer_type data;
+    };
+
+    struct peer_t
+    {
+        int socket     = -1;
+        bool is_closed = false;           ///< The peer finished and closed its socket
+        std::vector<char> incoming{};     ///< Bytes of incomplete messages
+        std::deque<message_t> messages{}; ///< Complete messages not yet received
+    };
+
+    /**
+     * Waits until a peer sent data, or, given a destination, until the destination's
+     * socket has room, and reads everything that arrived. Returns whether the
+     * destination's socket has room.
+     */
+    bool poll_peers(int destination);
+    void read_messages(peer_t& peer);
+
+    int rank_;
+    std::vector<peer_t> peers_;
+};
+
+/**
+ * Forks size processes, each of which runs f(communicator) as one rank connected to
+ * the others by a socket_communicator_t, and waits for them. Returns whether every
+ * rank's f returned true. The forked processes only have the calling thread, so this
+ * must be called before the process uses the thread pool or starts other threads.
+ */
+bool run_local_processes(int size, std::function<bool(communicator_t&)> const& f);
+
+#endif // !_WIN32
+
+#if defined(PD_WITH_MPI)
+
+/**
+ * Communicator over MPI_COMM_WORLD. MPI must be initialized by the application.
+ * all_reduce_sum() gathers the ranks' values and sums them in rank order, since the
+ * order of MPI_SUM reductions is up to the MPI implementation.
+ */
+class mpi_communicator_t : public communicator_t
+{
+  public:
+    mpi_communicator_t();
+    virtual ~mpi_communicator_t() override;
+
+    virtual int rank() const override { return rank_; }
+    virtual int size() const override { return size_; }
+
+    virtual void send(int destination, int tag, buffer_type const& data) override;
+    virtual void receive(int source, int tag, buffer_type& data) override;
+    virtual double all_reduce_sum(double value) override;
+
+  private:
+    void complete_sends();
+
+    struct pending_send_t;
+
+    int rank_;
+    int size_;
+    std::vector<std::unique_ptr<pending_send_t>> pending_sends_; ///< Sends in flight
+};
+
+#endif // PD_WITH_MPI
+
+} // namespace pd
+
+#endif // PD_PD_COMMUNICATOR_H
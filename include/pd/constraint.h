@@ -3,9 +3,48 @@
 
 #include <Eigen/Core>
 #include <Eigen/SparseCore>
+#include <functional>
+#include <memory>
 #include <vector>
 
 namespace pd {
+namespace detail {
+
+inline void hash_combine(std::size_t& seed, std::size_t value)
+{
+    seed ^= value + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+}
+
+/**
+ * Combines the hashes of the coefficients of m into seed
+ */
+template <class Derived>
+void hash_combine_coefficients(std::size_t& seed, Eigen::DenseBase<Derived> const& m)
+{
+    using scalar_type = typename Derived::Scalar;
+    for (Eigen::Index j = 0; j < m.cols(); ++j)
+        for (Eigen::Index i = 0; i < m.rows(); ++i)
+            hash_combine(seed, std::hash<scalar_type>{}(m(i, j)));
+}
+
+} // namespace detail
+
+/**
+ * Tags of the concrete constraint types. The values are stored in snapshots and must
+ * not change.
+ */
+enum class constraint_type_t : std::uint32_t {
+    edge_length                    = 1u,
+    positional                     = 2u,
+    deformation_gradient           = 3u,
+    corotated_deformation_gradient = 4u,
+    shape_targeting                = 5u,
+    strain                         = 6u,
+    triangle_strain                = 7u,
+    bending                        = 8u,
+    isometric_bending              = 9u,
+    half_space                     = 10u
+};
 
 class constraint_t
 {
@@ -14,6 +53,7 @@ class constraint_t
     using masses_type    = Eigen::VectorXd;
     using positions_type = Eigen::MatrixXd;
     using q_type         = Eigen::VectorXd;
+    using q_float_type   = Eigen::VectorXf; ///< Single precision q used by mixed precision solves
     using position_type  = Eigen::RowVector3d;
     using gradient_type  = Eigen::Vector3d;
     using scalar_type    = double;
@@ -29,18 +69,79 @@ class constraint_t
     {
     }
 
-    virtual scalar_type evaluate(positions_type const& p, masses_type const& M)
+    constraint_t(std::vector<index_type> indices, scalar_type wi)
+        : indices_(std::move(indices)), wi_(wi)
+    {
+    }
+
+    virtual ~constraint_t() = default;
+
+    /**
+     * Copies the constraint, including its precomputed rest state
+     */
+    virtual std::unique_ptr<constraint_t> clone() const = 0;
+
+    virtual constraint_type_t type() const = 0;
+
+    /**
+     * Copies the constraint with vertex vi renumbered to index_map[vi], for
+     * moving constraints to a mesh with a different vertex numbering
+     */
+    std::unique_ptr<constraint_t> remapped(std::vector<index_type> const& index_map) const
     {
-        return scalar_type{0.};
+        auto copy = clone();
+        copy->remap_indices(index_map);
+        return copy;
     }
 
+    /**
+     * Evaluates the elastic potential of the constraint at positions p
+     */
+    virtual scalar_type evaluate(positions_type const& p, masses_type const& M) const = 0;
+
     std::vector<index_type> const& indices() const { return indices_; }
     scalar_type wi() const { return wi_; }
 
-    virtual void project_wi_SiT_AiT_Bi_pi(q_type const& q, Eigen::VectorXd& rhs) const = 0;
+    /**
+     * Hashes the rest state wi * (Ai*Si)^T * (Ai*Si) depends on besides the type, indices
+     * and weight, such as the rest shape of an element. Constraints whose system matrix
+     * term only depends on those return 0.
+     */
+    virtual std::size_t hash_rest_state() const { return 0u; }
+
+    /**
+     * Whether the projection pi does not depend on q. The right hand side term
+     * wi * (Ai*Si)^T * Bi * pi is then constant and solvers may add it once, by
+     * projecting at q = 0, instead of projecting the constraint in every local step.
+     * The objective term is then the quadratic form of wi * (Ai*Si)^T * (Ai*Si).
+     */
+    virtual bool is_projection_constant() const { return false; }
+
+    /**
+     * Copies the targets of other, a constraint of the same type, such as the goal
+     * position of a pin or the shape target of an element. Targets only enter the
+     * projection pi, so copies made by remapped() can follow their source's targets
+     * without rebuilding anything.
+     */
+    virtual void copy_targets(constraint_t const& other) {}
+
+    /**
+     * Adds wi * (Ai*Si)^T * Bi * pi to rhs and returns the constraint's term of the
+     * projective dynamics objective, wi/2 * |Ai*Si*q - Bi*pi|^2, which is a byproduct
+     * of computing the projection pi.
+     */
+    virtual scalar_type project_wi_SiT_AiT_Bi_pi(q_type const& q, Eigen::VectorXd& rhs) const = 0;
+    virtual float project_wi_SiT_AiT_Bi_pi(q_float_type const& q, Eigen::VectorXf& rhs) const = 0;
     virtual std::vector<Eigen::Triplet<scalar_type>>
     get_wi_SiT_AiT_Ai_Si(positions_type const& p, masses_type const& M) const = 0;
 
+  protected:
+    virtual void remap_indices(std::vector<index_type> const& index_map)
+    {
+        for (auto& i : indices_)
+            i = index_map[i];
+    }
+
   private:
     std::vector<index_type> indices_;
     scalar_type wi_;
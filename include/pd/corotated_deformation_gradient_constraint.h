@@ -1,15 +1,15 @@
 #ifndef PD_PD_COROTATED_DEFORMATION_GRADIENT_CONSTRAINT_H
 #define PD_PD_COROTATED_DEFORMATION_GRADIENT_CONSTRAINT_H
 
-#include "constraint.h"
+#include "tet_constraint.h"
 
 namespace pd {
 
-class corotated_deformation_gradient_constraint_t : public constraint_t
+class corotated_deformation_gradient_constraint_t : public tet_constraint_t<rotation_projection_t>
 {
   public:
     using self_type          = corotated_deformation_gradient_constraint_t;
-    using base_type          = constraint_t;
+    using base_type          = tet_constraint_t<rotation_projection_t>;
     using index_type         = std::uint32_t;
     using scalar_type        = double;
     using masses_type        = Eigen::VectorXd;
@@ -22,22 +22,31 @@ class corotated_deformation_gradient_constraint_t : public constraint_t
     corotated_deformation_gradient_constraint_t(
         std::initializer_list<index_type> indices,
         scalar_type wi,
-        positions_type const& p);
+        positions_type const& p,
+        lame_parameters_t const& lame = lame_parameters_t{});
 
-    virtual scalar_type evaluate(positions_type const& p, masses_type const& M) override;
+    /**
+     * Restores a constraint from its stored state, see snapshot.h
+     */
+    corotated_deformation_gradient_constraint_t(
+        std::vector<index_type> indices,
+        scalar_type wi,
+        packed_tet_t const& packed,
+        lame_parameters_t const& lame);
 
-    virtual void project_wi_SiT_AiT_Bi_pi(q_type const& q, Eigen::VectorXd& rhs) const override;
+    virtual std::unique_ptr<constraint_t> clone() const override
+    {
+        return std::make_unique<self_type>(*this);
+    }
 
-    virtual std::vector<Eigen::Triplet<scalar_type>>
-    get_wi_SiT_AiT_Ai_Si(positions_type const& p, masses_type const& M) const override;
+    virtual constraint_type_t type() const override
+    {
+        return constraint_type_t::corotated_deformation_gradient;
+    }
 
-  private:
-    scalar_type V0_;
-    Eigen::Matrix3d DmInv_;
-    Eigen::Matrix3d R_; // Rotation matrix from polar decomposition
+    virtual scalar_type evaluate(positions_type const& p, masses_type const& M) const override;
 };
 
 } // namespace pd
 
-
-#endif // PD_PD_COROTATED_DEFORMATION_GRADIENT_CONSTRAINT_H
\ No newline at end of file
+#endif // PD_PD_COROTATED_DEFORMATION_GRADIENT_CONSTRAINT_H
@@ -2,22 +2,31 @@
 #define PD_PD_DEFORMABLE_MESH_H
 
 #include "constraint.h"
+#include "material.h"
 
 #include <Eigen/Core>
+#include <cassert>
+#include <functional>
+#include <memory>
 #include <numeric>
+#include <string>
+#include <vector>
 
 namespace pd {
 
+class solver_t;
+
 class deformable_mesh_t
 {
   public:
-    using positions_type   = Eigen::MatrixXd;
-    using masses_type      = Eigen::VectorXd;
-    using velocities_type  = Eigen::MatrixX3d;
-    using faces_type       = Eigen::MatrixXi;
-    using elements_type    = Eigen::MatrixXi;
-    using constraints_type = std::vector<std::unique_ptr<constraint_t>>;
-    using scalar_type      = typename constraint_t::scalar_type;
+    using positions_type             = Eigen::MatrixXd;
+    using masses_type                = Eigen::VectorXd;
+    using velocities_type            = Eigen::MatrixX3d;
+    using faces_type                 = Eigen::MatrixXi;
+    using elements_type              = Eigen::MatrixXi;
+    using constraints_type           = std::vector<std::unique_ptr<constraint_t>>;
+    using scalar_type                = typename constraint_t::scalar_type;
+    using shape_target_function_type = std::function<Eigen::Matrix3d(std::size_t)>;
 
   public:
     deformable_mesh_t() = default;
@@ -83,6 +92,7 @@ class deformable_mesh_t
     velocities_type const& velocity() const { return v_; }
     masses_type const& mass() const { return m_; }
     std::vector<bool> const& fixed() const { return fixed_; }
+    material_field_t const& materials() const { return materials_; }
 
     positions_type& positions() { return p_; }
     faces_type& faces() { return F_; }
@@ -92,20 +102,125 @@ class deformable_mesh_t
     masses_type& mass() { return m_; }
     std::vector<bool>& fixed() { return fixed_; }
 
+    /**
+     * Assigns a material to each element, in the order of elements(). Elastic
+     * constraints built afterwards take their Lamé parameters and the scale of their
+     * weight from their element's material. reorder_vertices() reorders the materials
+     * along with the elements.
+     */
+    void set_materials(material_field_t materials)
+    {
+        assert(materials.empty() || materials.size() == static_cast<std::size_t>(E_.rows()));
+        materials_ = std::move(materials);
+    }
+
     void immobilize() { v_.setZero(); }
     void tetrahedralize(Eigen::MatrixXd const& V, Eigen::MatrixXi const& F);
-    void set_target_shape();
+
+    /**
+     * Renumbers vertices using the reverse Cuthill-McKee ordering of the mesh's
+     * vertex adjacency graph and sorts elements and faces by their smallest
+     * vertex index. Constraints subsequently built from the elements then touch
+     * neighbouring regions of q and b, and the system matrix has a tight bandwidth.
+     * Existing constraints are discarded, so this should be called at model load.
+     */
+    void reorder_vertices();
+
+    /**
+     * Sorts constraints by their smallest vertex index, such that consecutive
+     * constraints of the local step access nearby memory.
+     */
+    void sort_constraints_by_locality();
+
+    /**
+     * Topology edits for cutting and tearing, which keep the constraints of untouched
+     * elements as they are. remove_elements() removes elements along with the
+     * constraints built on them, and the constraints on edges, faces or hinges which
+     * no remaining element contains. split_vertex() duplicates vertex vi into a new
+     * last vertex, which replaces vi in the given elements. Both copies get half of
+     * vi's mass, such that the total mass is preserved. The constraints on those
+     * elements move to the new vertex, and the constraints on edges, faces or hinges
+     * end up on whichever copies of vi have elements containing them, possibly both.
+     * Vertex indices never change and new vertices are appended, so the factorization
+     * of the previous system matrix remains a good preconditioner, see
+     * solver_t::update_topology(). The boundary faces of tetrahedral meshes are
+     * recomputed, triangle meshes keep their elements as faces.
+     */
+    void remove_elements(std::vector<int> const& elements);
+    int split_vertex(int vi, std::vector<int> const& elements);
+
+    /**
+     * Maps between the current vertex numbering and the numbering of the
+     * model as it was loaded, which differ after reorder_vertices().
+     */
+    int vertex_to_input_index(int vi) const
+    {
+        return input_index_.empty() ? vi : input_index_[vi];
+    }
+    int input_to_vertex_index(int input_vi) const
+    {
+        return vertex_index_.empty() ? input_vi : vertex_index_[input_vi];
+    }
+    positions_type input_ordered_positions() const;
+    faces_type input_ordered_faces() const;
+    elements_type input_ordered_elements() const;
+
+    /**
+     * Evaluates the elastic potential of all constraints at the current positions.
+     * Nothing is cached, the per-constraint energies are summed by a parallel
+     * reduction when requested.
+     */
+    scalar_type elastic_potential() const;
+
+    /**
+     * Sets the shape targets of all shape targeting constraints at once, in parallel.
+     * targets holds one matrix per shape targeting constraint, in the order of
+     * constraints(), which is the order of the elements for the constraints made by
+     * constrain_shape_targeting(). Given a function instead, target(k) is evaluated in
+     * parallel and written directly into the k-th constraint, such that streamed
+     * targets are never buffered. Given a pose, each target is the stretch of its
+     * tetrahedron's deformation in that pose. Other constraints are skipped by their
+     * type tag. Shape targets do not enter the system matrix, so updating them every
+     * frame never refactorizes. Returns the number of targets set.
+     */
+    std::size_t set_shape_targets(std::vector<Eigen::Matrix3d> const& targets);
+    std::size_t set_shape_targets(shape_target_function_type const& target);
+    std::size_t set_shape_targets(positions_type const& pose);
     void constrain_edge_lengths(scalar_type wi = 1'000'000.);
     void add_positional_constraint(int vi, scalar_type wi = 1'000'000'000.);
+
+    /**
+     * Elastic constraints on the elements. wi is the weight of the default material,
+     * the weight of each element is scaled by its material's stiffness(), see
+     * material_field_t.
+     */
     void constrain_deformation_gradient(scalar_type wi = 1'000'000.);
     void constrain_corotated_deformation_gradient(scalar_type wi = 1'000'000.);
     void constrain_shape_targeting(scalar_type wi = 1'000'000.);
     void constrain_strain(scalar_type min, scalar_type max, scalar_type wi = 1'000'000.);
 
+    /**
+     * Constraints on the faces, for cloth and other triangle meshes: in-plane strain
+     * limits on every face, and bending on the hinge of every interior edge. Isometric
+     * bending is linear, it only adds a constant term to the system matrix.
+     */
+    void constrain_triangle_strain(scalar_type min, scalar_type max, scalar_type wi = 1'000'000.);
+    void constrain_bending(scalar_type wi = 1'000.);
+    void constrain_isometric_bending(scalar_type wi = 1'000.);
+
   protected:
     positions_type const& p0() const { return p0_; }
 
+    friend bool save_snapshot(
+        std::string const& filename,
+        deformable_mesh_t const& model,
+        solver_t const* solver);
+    friend bool
+    load_snapshot(std::string const& filename, deformable_mesh_t& model, solver_t* solver);
+
   private:
+    void update_faces();
+
     positions_type p0_;            ///< Rest positions
     positions_type p_;             ///< Positions
     faces_type F_;                 ///< Faces
@@ -114,6 +229,9 @@ class deformable_mesh_t
     velocities_type v_;            ///< Per-vertex velocity
     constraints_type constraints_; ///< PBD constraints
     std::vector<bool> fixed_;      ///< Flags fixed positions
+    std::vector<int> input_index_; ///< Input vertex index of each vertex, empty if not reordered
+    std::vector<int> vertex_index_; ///< Vertex index of each input vertex, empty if not reordered
+    material_field_t materials_;    ///< Per-element materials
 };
 
 } // namespace pd
@@ -0,0 +1,97 @@
+#ifndef PD_PD_DISTRIBUTED_SOLVER_H
+#define PD_PD_DISTRIBUTED_SOLVER_H
+
+#include "communicator.h"
+#include "deformable_mesh.h"
+#include "linear_solver.h"
+
+#include <Eigen/SparseCholesky>
+#include <Eigen/SparseCore>
+#include <vector>
+
+namespace pd {
+
+/**
+ * The part of a deformable_mesh_t simulated by one rank of a distributed simulation.
+ * Local vertices are the vertices owned by the rank followed by ghost vertices,
+ * which are owned by other ranks but share a constraint with an owned vertex. mesh
+ * holds copies of all constraints touching an owned vertex, renumbered to local vertices.
+ */
+struct mesh_partition_t
+{
+    struct halo_t
+    {
+        int rank;                 ///< Neighbouring rank
+        std::vector<int> send;    ///< Owned local vertices which are ghosts of the neighbour
+        std::vector<int> receive; ///< Ghost local vertices owned by the neighbour
+    };
+
+    deformable_mesh_t mesh;        ///< Local vertices, elements and constraints
+    std::vector<int> global_index; ///< Global vertex of each local vertex
+    int owned_count = 0;           ///< Local vertices [0, owned_count) are owned
+    std::vector<halo_t> halos;     ///< Exchanges with neighbouring ranks
+};
+
+/**
+ * Partitions the vertices of mesh into rank_count connected slabs of about equal
+ * size and extracts the partition of the given rank. Every rank computes the same
+ * partitioning, so each rank can extract its own partition and release the global mesh.
+ */
+mesh_partition_t partition_mesh(deformable_mesh_t const& mesh, int rank_count, int rank);
+
+/**
+ * Projective dynamics solver of one rank of a distributed simulation. Every rank
+ * projects the constraints of its partition in the local step, after ghost
+ * positions were updated by a halo exchange. The global step is a distributed
+ * conjugate gradient solve over the rows of the owned vertices, preconditioned by
+ * a factorization of each rank's owned block (block Jacobi). Matrix-vector products
+ * exchange halos, and dot products are reduced over all ranks.
+ */
+class distributed_solver_t
+{
+  public:
+    using scalar_type        = double;
+    using sparse_matrix_type = Eigen::SparseMatrix<scalar_type, Eigen::RowMajor>;
+    using vector_type        = Eigen::VectorXd;
+
+    distributed_solver_t(communicator_t& communicator, mesh_partition_t& partition)
+        : communicator_(communicator), partition_(partition)
+    {
+    }
+
+    void prepare(scalar_type dt);
+
+    /**
+     * Advances the partition by one timestep. fext holds the external force of every
+     * local vertex, the forces of ghost vertices are ignored.
+     */
+    void step(Eigen::MatrixXd const& fext, int num_iterations = 10);
+
+    convergence_criteria_t const& convergence_criteria() const { return convergence_criteria_; }
+    void set_convergence_criteria(convergence_criteria_t const& criteria)
+    {
+        convergence_criteria_ = criteria;
+    }
+    int global_solver_iterations() const { return global_solver_iterations_; }
+
+  private:
+    /**
+     * Sends the owned entries of x the neighbours need and receives the ghost entries
+     */
+    void exchange_halo(vector_type& x) const;
+    scalar_type dot(vector_type const& a, vector_type const& b) const;
+    int conjugate_gradient(vector_type const& b, vector_type& x) const;
+
+    communicator_t& communicator_;
+    mesh_partition_t& partition_;
+    sparse_matrix_type A_; ///< Rows of the owned vertices, 3*owned x 3*local
+    Eigen::SimplicialLDLT<Eigen::SparseMatrix<scalar_type>> owned_block_; ///< Owned x owned
+    vector_type inverse_diagonal_; ///< Inverse of the owned diagonal of A
+    scalar_type dt_ = scalar_type{0.};
+    convergence_criteria_t convergence_criteria_{};
+    int global_solver_iterations_ = 0;
+};
+
+} // namespace pd
+
+#endif // PD_PD_DISTRIBUTED_SOLVER_H
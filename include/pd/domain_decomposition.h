@@ -0,0 +1,103 @@
+#ifndef PD_PD_DOMAIN_DECOMPOSITION_H
+#define PD_PD_DOMAIN_DECOMPOSITION_H
+
+#include "linear_solver.h"
+
+#include <Eigen/SparseCholesky>
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+namespace pd {
+namespace detail {
+
+/**
+ * Breadth first ordering of all vertices of the graph, component by component,
+ * starting each component at a peripheral vertex. Cutting the ordering into
+ * contiguous chunks partitions the graph into connected slabs.
+ */
+std::vector<int> breadth_first_order(std::vector<std::vector<int>> const& adjacency);
+
+} // namespace detail
+
+/**
+ * Additive Schwarz preconditioner over K subdomains of the mesh. Vertices are
+ * partitioned into K connected slabs of about equal size by cutting a breadth
+ * first ordering of the vertex adjacency graph of A, and every subdomain is grown
+ * by a number of overlap layers of neighbouring vertices. The diagonal block of A
+ * of each subdomain is factorized independently, and applying the preconditioner
+ *
+ *     M^-1 * r = sum_k R_k^T * A_k^-1 * R_k * r
+ *
+ * solves all subdomains independently, both in parallel over subdomains.
+ */
+class schwarz_preconditioner_t
+{
+  public:
+    using scalar_type        = double;
+    using sparse_matrix_type = Eigen::SparseMatrix<scalar_type>;
+    using vector_type        = Eigen::VectorXd;
+
+    void compute(sparse_matrix_type const& A);
+    vector_type solve(vector_type const& r) const;
+
+    int subdomain_count() const { return subdomain_count_; }
+    void set_subdomain_count(int count) { subdomain_count_ = count > 0 ? count : 1; }
+    int overlap() const { return overlap_; }
+    void set_overlap(int overlap) { overlap_ = overlap > 0 ? overlap : 0; }
+
+    /**
+     * Subdomain each vertex was partitioned into, before overlap
+     */
+    std::vector<int> const& partition() const { return partition_; }
+
+  private:
+    struct subdomain_t
+    {
+        std::vector<int> vertices; ///< Vertices of the subdomain, including the overlap
+        std::unique_ptr<Eigen::SimplicialLDLT<sparse_matrix_type>> ldlt; ///< Factorization of A_k
+    };
+
+    std::vector<int> partition_;
+    std::vector<subdomain_t> subdomains_;
+    int subdomain_count_ = 8;
+    int overlap_         = 1;
+};
+
+/**
+ * Conjugate gradient solve of the global step preconditioned by additive Schwarz
+ */
+class domain_decomposition_solver_t : public linear_solver_t
+{
+  public:
+    domain_decomposition_solver_t(int subdomain_count, int overlap)
+    {
+        preconditioner_.set_subdomain_count(subdomain_count);
+        preconditioner_.set_overlap(overlap);
+    }
+
+    virtual void compute(sparse_matrix_type const& A) override
+    {
+        // row major matrix-vector products are parallel over rows, see detail::multiply()
+        A_ = A;
+        preconditioner_.compute(A);
+    }
+
+    virtual int solve(
+        vector_type const& b,
+        vector_type& x,
+        convergence_criteria_t const& criteria) const override
+    {
+        return conjugate_gradient(A_, b, x, preconditioner_, criteria);
+    }
+
+    schwarz_preconditioner_t const& preconditioner() const { return preconditioner_; }
+
+  private:
+    Eigen::SparseMatrix<scalar_type, Eigen::RowMajor> A_;
+    schwarz_preconditioner_t preconditioner_;
+};
+
+} // namespace pd
+
+#endif // PD_PD_DOMAIN_DECOMPOSITION_H
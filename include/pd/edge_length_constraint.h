@@ -15,6 +15,7 @@ class edge_length_constraint_t : public constraint_t
     using masses_type        = Eigen::VectorXd;
     using positions_type     = typename base_type::positions_type;
     using q_type             = typename base_type::q_type;
+    using q_float_type       = typename base_type::q_float_type;
     using gradient_type      = typename base_type::gradient_type;
     using sparse_matrix_type = Eigen::SparseMatrix<scalar_type>;
 
@@ -32,12 +33,43 @@ class edge_length_constraint_t : public constraint_t
         d_ = (p.row(e0) - p.row(e1)).norm();
     }
 
-    virtual void project_wi_SiT_AiT_Bi_pi(q_type const& q, Eigen::VectorXd& rhs) const override;
+    /**
+     * Restores a constraint from its stored state, see snapshot.h
+     */
+    edge_length_constraint_t(
+        std::vector<index_type> indices,
+        scalar_type wi,
+        scalar_type rest_length)
+        : base_type(std::move(indices), wi), d_(rest_length)
+    {
+        assert(this->indices().size() == 2u);
+    }
+
+    virtual std::unique_ptr<constraint_t> clone() const override
+    {
+        return std::make_unique<self_type>(*this);
+    }
+
+    virtual constraint_type_t type() const override { return constraint_type_t::edge_length; }
+
+    virtual scalar_type
+    project_wi_SiT_AiT_Bi_pi(q_type const& q, Eigen::VectorXd& rhs) const override;
+    virtual float
+    project_wi_SiT_AiT_Bi_pi(q_float_type const& q, Eigen::VectorXf& rhs) const override;
 
     virtual std::vector<Eigen::Triplet<scalar_type>>
     get_wi_SiT_AiT_Ai_Si(positions_type const& p, masses_type const& M) const override;
 
+    virtual scalar_type evaluate(positions_type const& p, masses_type const& M) const override;
+
+    scalar_type rest_length() const { return d_; }
+
   private:
+    template <class Scalar>
+    Scalar project(
+        Eigen::Matrix<Scalar, Eigen::Dynamic, 1> const& q,
+        Eigen::Matrix<Scalar, Eigen::Dynamic, 1>& b) const;
+
     scalar_type d_; ///< rest length
     sparse_matrix_type Ai_Si_;
     sparse_matrix_type SiT_AiT_Bi_;
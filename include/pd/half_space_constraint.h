@@ -0,0 +1,84 @@
+#ifndef PD_PD_HALF_SPACE_CONSTRAINT_H
+#define PD_PD_HALF_SPACE_CONSTRAINT_H
+
+#include "constraint.h"
+
+#include <cassert>
+
+namespace pd {
+
+/**
+ * Keeps a vertex in the half-space n^T * p >= d. This is the contact
+ * constraint of collision handling, where the plane is the floor or the
+ * tangent plane of a colliding surface face.
+ */
+class half_space_constraint_t : public constraint_t
+{
+  public:
+    using self_type          = half_space_constraint_t;
+    using base_type          = constraint_t;
+    using index_type         = std::uint32_t;
+    using scalar_type        = double;
+    using masses_type        = Eigen::VectorXd;
+    using positions_type     = typename base_type::positions_type;
+    using q_type             = typename base_type::q_type;
+    using q_float_type       = typename base_type::q_float_type;
+    using gradient_type      = typename base_type::gradient_type;
+    using sparse_matrix_type = Eigen::SparseMatrix<scalar_type>;
+
+  public:
+    half_space_constraint_t(
+        std::initializer_list<index_type> indices,
+        scalar_type wi,
+        Eigen::Vector3d const& n,
+        scalar_type d)
+        : base_type(indices, wi), n_(n), d_(d)
+    {
+        assert(indices.size() == 1u);
+    }
+
+    /**
+     * Restores a constraint from its stored state, see snapshot.h
+     */
+    half_space_constraint_t(
+        std::vector<index_type> indices,
+        scalar_type wi,
+        Eigen::Vector3d const& n,
+        scalar_type d)
+        : base_type(std::move(indices), wi), n_(n), d_(d)
+    {
+        assert(this->indices().size() == 1u);
+    }
+
+    virtual std::unique_ptr<constraint_t> clone() const override
+    {
+        return std::make_unique<self_type>(*this);
+    }
+
+    virtual constraint_type_t type() const override { return constraint_type_t::half_space; }
+
+    virtual scalar_type
+    project_wi_SiT_AiT_Bi_pi(q_type const& q, Eigen::VectorXd& rhs) const override;
+    virtual float
+    project_wi_SiT_AiT_Bi_pi(q_float_type const& q, Eigen::VectorXf& rhs) const override;
+    virtual std::vector<Eigen::Triplet<scalar_type>>
+    get_wi_SiT_AiT_Ai_Si(positions_type const& p, masses_type const& M) const override;
+
+    virtual scalar_type evaluate(positions_type const& p, masses_type const& M) const override;
+
+    Eigen::Vector3d const& normal() const { return n_; }
+    scalar_type offset() const { return d_; }
+
+  private:
+    template <class Scalar>
+    Scalar project(
+        Eigen::Matrix<Scalar, Eigen::Dynamic, 1> const& q,
+        Eigen::Matrix<Scalar, Eigen::Dynamic, 1>& b) const;
+
+    Eigen::Vector3d n_; ///< Unit normal of the plane
+    scalar_type d_;     ///< Offset of the plane along n
+};
+
+} // namespace pd
+
+#endif // PD_PD_HALF_SPACE_CONSTRAINT_H
@@ -0,0 +1,88 @@
+#ifndef PD_PD_ISOMETRIC_BENDING_CONSTRAINT_H
+#define PD_PD_ISOMETRIC_BENDING_CONSTRAINT_H
+
+#include "bending_constraint.h"
+
+namespace pd {
+
+/**
+ * Isometric bending of a hinge, after Bergou et al., "A Quadratic Bending Model for
+ * Inextensible Surfaces" (2006). For deformations that preserve edge lengths, which
+ * the cloth's strain constraints enforce, the bending energy of a hinge is quadratic
+ * in the positions, wi/2 * 3 / (A1 + A2) * |h|^2 for the mean curvature vector h of
+ * packed_hinge_t. Its projection pi is the constant rest curvature vector h0, so the
+ * constraint's Laplacian-like wi * (Ai*Si)^T * (Ai*Si) is assembled once into the
+ * system matrix, and its right hand side term weight * K(k) * h0 is constant, and
+ * vanishes for flat rest shapes such as the cloth models. The projection is constant,
+ * so solver_t sums that term once when preparing and never projects the constraint
+ * in the local step.
+ * Since h0 is not rotated with the hinge, curved rest shapes undergoing large
+ * rotations should use bending_constraint_t instead.
+ */
+class isometric_bending_constraint_t : public constraint_t
+{
+  public:
+    using self_type          = isometric_bending_constraint_t;
+    using base_type          = constraint_t;
+    using index_type         = std::uint32_t;
+    using scalar_type        = double;
+    using masses_type        = Eigen::VectorXd;
+    using positions_type     = typename base_type::positions_type;
+    using q_type             = typename base_type::q_type;
+    using q_float_type       = typename base_type::q_float_type;
+    using gradient_type      = typename base_type::gradient_type;
+    using sparse_matrix_type = Eigen::SparseMatrix<scalar_type>;
+
+  public:
+    isometric_bending_constraint_t(
+        std::initializer_list<index_type> indices,
+        scalar_type wi,
+        positions_type const& p);
+
+    /**
+     * Restores a constraint from its stored state, see snapshot.h
+     */
+    isometric_bending_constraint_t(
+        std::vector<index_type> indices,
+        scalar_type wi,
+        packed_hinge_t const& packed);
+
+    virtual std::unique_ptr<constraint_t> clone() const override
+    {
+        return std::make_unique<self_type>(*this);
+    }
+
+    virtual constraint_type_t type() const override { return constraint_type_t::isometric_bending; }
+
+    virtual scalar_type
+    project_wi_SiT_AiT_Bi_pi(q_type const& q, Eigen::VectorXd& b) const override;
+    virtual float
+    project_wi_SiT_AiT_Bi_pi(q_float_type const& q, Eigen::VectorXf& b) const override;
+
+    virtual std::vector<Eigen::Triplet<scalar_type>>
+    get_wi_SiT_AiT_Ai_Si(positions_type const& p, masses_type const& M) const override;
+    virtual std::size_t hash_rest_state() const override { return packed_.hash(); }
+    virtual bool is_projection_constant() const override { return true; }
+
+    virtual scalar_type evaluate(positions_type const& p, masses_type const& M) const override;
+
+    packed_hinge_t const& packed() const { return packed_; }
+
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+  protected:
+    virtual void remap_indices(std::vector<index_type> const& index_map) override;
+
+  private:
+    template <class Scalar>
+    Scalar project(
+        Eigen::Matrix<Scalar, Eigen::Dynamic, 1> const& q,
+        Eigen::Matrix<Scalar, Eigen::Dynamic, 1>& b) const;
+
+    packed_hinge_t packed_;
+    bool is_rest_flat_; ///< The right hand side term vanishes
+};
+
+} // namespace pd
+
+#endif // PD_PD_ISOMETRIC_BENDING_CONSTRAINT_H
@@ -0,0 +1,320 @@
+#ifndef PD_PD_LINEAR_SOLVER_H
+#define PD_PD_LINEAR_SOLVER_H
+
+#include "parallel.h"
+
+#include <Eigen/Core>
+#include <Eigen/SparseCholesky>
+#include <Eigen/SparseCore>
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+namespace pd {
+namespace detail {
+
+/**
+ * Vertex adjacency graph of the 3N x 3N matrix A, where vertices i and j are
+ * adjacent if the 3x3 block A_ij is non-zero
+ */
+inline std::vector<std::vector<int>> vertex_adjacency(Eigen::SparseMatrix<double> const& A)
+{
+    auto const n = static_cast<std::size_t>(A.rows() / 3);
+
+    std::vector<std::vector<int>> adjacency(n);
+    for (int k = 0; k < A.outerSize(); k += 3)
+    {
+        int const j = k / 3;
+        for (Eigen::SparseMatrix<double>::InnerIterator it(A, k); it; ++it)
+        {
+            int const i = static_cast<int>(it.row()) / 3;
+            if (i != j && it.value() != 0.)
+                adjacency[static_cast<std::size_t>(j)].push_back(i);
+        }
+    }
+    for (auto& neighbours : adjacency)
+    {
+        std::sort(neighbours.begin(), neighbours.end());
+        neighbours.erase(std::unique(neighbours.begin(), neighbours.end()), neighbours.end());
+    }
+    return adjacency;
+}
+
+/**
+ * y = A * x
+ */
+template <class MatrixType>
+void multiply(MatrixType const& A, Eigen::VectorXd const& x, Eigen::VectorXd& y)
+{
+    y = A * x;
+}
+
+/**
+ * y = A * x for row major A, in parallel over the rows on the shared thread pool
+ */
+inline void multiply(
+    Eigen::SparseMatrix<double, Eigen::RowMajor> const& A,
+    Eigen::VectorXd const& x,
+    Eigen::VectorXd& y)
+{
+    using matrix_type = Eigen::SparseMatrix<double, Eigen::RowMajor>;
+
+    y.resize(A.rows());
+    parallel_for(0, A.outerSize(), [&](std::ptrdiff_t i) {
+        double sum = 0.;
+        for (matrix_type::InnerIterator it(A, static_cast<Eigen::Index>(i)); it; ++it)
+            sum += it.value() * x(it.index());
+        y(i) = sum;
+    });
+}
+
+} // namespace detail
+
+/**
+ * Stopping criteria of iterative linear solvers. Iterations stop once
+ * |D^-1 * (b - A*x)| <= tolerance * |D^-1 * b| for the diagonal D of A, or after
+ * max_iterations iterations. Scaling by D^-1 keeps the heavy rows of fixed
+ * vertices from dominating the norms, D^-1 * b is on the scale of positions.
+ */
+struct convergence_criteria_t
+{
+    double tolerance   = 1e-8;
+    int max_iterations = 200;
+};
+
+/**
+ * Solves the linear system A*x = b of the global step for a fixed system matrix A.
+ */
+class linear_solver_t
+{
+  public:
+    using scalar_type        = double;
+    using sparse_matrix_type = Eigen::SparseMatrix<scalar_type>;
+    using vector_type        = Eigen::VectorXd;
+
+    virtual ~linear_solver_t() = default;
+
+    virtual void compute(sparse_matrix_type const& A) = 0;
+
+    /**
+     * Solves A*x = b. On input, x holds the initial guess of iterative solvers.
+     * Returns the number of iterations performed, which is 1 for direct solvers.
+     */
+    virtual int solve(
+        vector_type const& b,
+        vector_type& x,
+        convergence_criteria_t const& criteria) const = 0;
+
+    /**
+     * Solvers which do not factorize A can cheaply switch to solving (A + C)*x = b for
+     * a sparse update C of A, replacing any previous update. Returns false if the
+     * solver does not support updates, then they have to be applied on top of it.
+     */
+    virtual bool set_update(sparse_matrix_type const& C) { return false; }
+};
+
+/**
+ * Sparse factorization P*A*P^T = L*D*L^T, with unit lower triangular L and diagonal D,
+ * in a plain form that can be stored and solved with without refactorizing A
+ */
+struct ldlt_factor_t
+{
+    using scalar_type        = double;
+    using sparse_matrix_type = Eigen::SparseMatrix<scalar_type>;
+    using vector_type        = Eigen::VectorXd;
+    using permutation_type   = Eigen::PermutationMatrix<Eigen::Dynamic, Eigen::Dynamic, int>;
+
+    Eigen::VectorXi permutation; ///< Indices of P, empty for the identity
+    sparse_matrix_type L;        ///< Strictly lower triangular part of L
+    vector_type D;               ///< Diagonal of D
+
+    bool empty() const { return D.size() == 0; }
+
+    vector_type solve(vector_type const& b) const
+    {
+        permutation_type const P(permutation);
+        vector_type x = permutation.size() > 0 ? vector_type(P * b) : b;
+        L.triangularView<Eigen::UnitLower>().solveInPlace(x);
+        x.array() /= D.array();
+        L.transpose().triangularView<Eigen::UnitUpper>().solveInPlace(x);
+        if (permutation.size() > 0)
+            x = P.transpose() * x;
+        return x;
+    }
+};
+
+/**
+ * Direct solve using a sparse Cholesky factorization of A
+ */
+class cholesky_solver_t : public linear_solver_t
+{
+  public:
+    using cholesky_type = Eigen::SimplicialLDLT<sparse_matrix_type>;
+
+    virtual void compute(sparse_matrix_type const& A) override
+    {
+        factor_ = ldlt_factor_t{};
+        cholesky_.compute(A);
+    }
+
+    virtual int solve(
+        vector_type const& b,
+        vector_type& x,
+        convergence_criteria_t const& criteria) const override
+    {
+        x = factor_.empty() ? vector_type(cholesky_.solve(b)) : factor_.solve(b);
+        return 1;
+    }
+
+    cholesky_type const& cholesky() const { return cholesky_; }
+    Eigen::Index size() const { return factor_.empty() ? cholesky_.rows() : factor_.D.size(); }
+
+    /**
+     * The factorization of A in plain form, for storing it
+     */
+    ldlt_factor_t factor() const
+    {
+        if (!factor_.empty())
+            return factor_;
+
+        ldlt_factor_t factor{};
+        factor.permutation = cholesky_.permutationP().indices();
+        factor.L           = cholesky_.matrixL().nestedExpression();
+        factor.D           = cholesky_.vectorD();
+        return factor;
+    }
+
+    /**
+     * Solves with a previously stored factorization of A instead of computing it
+     */
+    void set_factor(ldlt_factor_t factor) { factor_ = std::move(factor); }
+
+  private:
+    cholesky_type cholesky_;
+    ldlt_factor_t factor_; ///< Stored factorization in use, empty if cholesky_ is used
+};
+
+/**
+ * Preconditioned conjugate gradient for a sparse symmetric positive definite A. The
+ * preconditioner M must provide vector_type solve(vector_type const& r) const,
+ * which approximates A^-1 * r by a symmetric positive definite operator.
+ * Returns the number of iterations performed.
+ */
+template <class MatrixType, class Preconditioner>
+int conjugate_gradient(
+    MatrixType const& A,
+    Eigen::VectorXd const& b,
+    Eigen::VectorXd& x,
+    Preconditioner const& M,
+    convergence_criteria_t const& criteria)
+{
+    using scalar_type = double;
+    using vector_type = Eigen::VectorXd;
+
+    vector_type const inverse_diagonal = A.diagonal().cwiseInverse();
+    auto const scaled_norm              = [&](vector_type const& v) {
+        return inverse_diagonal.cwiseProduct(v).norm();
+    };
+
+    scalar_type const b_norm = scaled_norm(b);
+    if (b_norm == scalar_type{0.})
+    {
+        x.setZero();
+        return 0;
+    }
+
+    scalar_type const threshold = criteria.tolerance * b_norm;
+    vector_type Ap;
+    detail::multiply(A, x, Ap);
+    vector_type r = b - Ap;
+    if (scaled_norm(r) <= threshold)
+        return 0;
+
+    vector_type z     = M.solve(r);
+    vector_type p     = z;
+    scalar_type rz    = r.dot(z);
+    int iterations    = 0;
+    while (iterations < criteria.max_iterations)
+    {
+        detail::multiply(A, p, Ap);
+        scalar_type const alpha = rz / p.dot(Ap);
+        x += alpha * p;
+        r -= alpha * Ap;
+        ++iterations;
+
+        if (scaled_norm(r) <= threshold)
+            break;
+
+        z                        = M.solve(r);
+        scalar_type const rz_new = r.dot(z);
+        p                        = z + (rz_new / rz) * p;
+        rz                       = rz_new;
+    }
+
+    return iterations;
+}
+
+/**
+ * Conjugate gradients on A, preconditioned by the factorization of a previous system
+ * matrix A0 whose rows are the first rows of A. The remaining rows, which belong to
+ * vertices added since A0, are preconditioned by the inverse of their diagonal. After
+ * a local change of the system matrix, such as a topology edit, A - A0 is local and
+ * conjugate gradients converges in few iterations, which bridges the time until the
+ * factorization of A is ready.
+ */
+class stale_factor_solver_t : public linear_solver_t
+{
+  public:
+    stale_factor_solver_t(std::unique_ptr<linear_solver_t> factorization, Eigen::Index size)
+        : factorization_(std::move(factorization)), factorization_size_(size)
+    {
+    }
+
+    virtual void compute(sparse_matrix_type const& A) override
+    {
+        A_                = A;
+        inverse_diagonal_ = A.diagonal().cwiseInverse();
+    }
+
+    virtual int solve(
+        vector_type const& b,
+        vector_type& x,
+        convergence_criteria_t const& criteria) const override
+    {
+        if (x.rows() != b.rows())
+            x = vector_type::Zero(b.rows());
+
+        return conjugate_gradient(A_, b, x, *this, criteria);
+    }
+
+    /**
+     * Applies the preconditioner
+     */
+    vector_type solve(vector_type const& r) const
+    {
+        auto const n = factorization_size_;
+        vector_type z(r.rows());
+        vector_type z_head = vector_type::Zero(n);
+        factorization_->solve(r.head(n), z_head, convergence_criteria_t{});
+        z.head(n) = z_head;
+        z.tail(r.rows() - n) =
+            inverse_diagonal_.tail(r.rows() - n).cwiseProduct(r.tail(r.rows() - n));
+        return z;
+    }
+
+    /**
+     * Hands the factorization of A0 over to the solver of a later system matrix
+     */
+    std::unique_ptr<linear_solver_t> release_factorization() { return std::move(factorization_); }
+    Eigen::Index factorization_size() const { return factorization_size_; }
+
+  private:
+    std::unique_ptr<linear_solver_t> factorization_; ///< Factorization of A0
+    Eigen::Index factorization_size_;                ///< Rows of A0
+    sparse_matrix_type A_;
+    vector_type inverse_diagonal_;
+};
+
+} // namespace pd
+
+#endif // PD_PD_LINEAR_SOLVER_H
@@ -0,0 +1,100 @@
+#ifndef PD_PD_LOW_RANK_UPDATE_H
+#define PD_PD_LOW_RANK_UPDATE_H
+
+#include "linear_solver.h"
+
+#include <Eigen/Core>
+#include <Eigen/LU>
+#include <Eigen/SparseCore>
+#include <vector>
+
+namespace pd {
+
+/**
+ * Solves (A + C) * x = b with the linear solver of A, for a sparse symmetric update
+ * C touching few rows, such as the system matrix contributions of contacts or of a
+ * dragged vertex. With the m rows D touched by C, C = U * W * U^T where U selects the
+ * rows D and W = C_DD is m x m, and the Woodbury identity gives
+ *
+ *     (A + U*W*U^T)^-1 * b = y - Z * (I + W*G)^-1 * W * y_D,
+ *
+ * for y = A^-1 * b, Z = A^-1 * U and G = U^T * Z. compute() solves for the m columns
+ * of Z and factorizes the m x m capacitance matrix I + W*G, after which every solve
+ * costs one solve with A and a product with Z. This form does not invert W, so C may
+ * be singular. Z is dense, so it is only kept when it is small (n * m below
+ * max_stored_entries). Otherwise Z * s is computed as A^-1 * (U * s), at the cost
+ * of a second solve with A.
+ *
+ * Z and G only depend on the rows D, not on the coefficients of C. compute() costs m
+ * solves with A, the m columns of Z, which is more than the global solves it saves
+ * if it runs every step. update() therefore replaces C by an update touching the same
+ * rows at the cost of refactorizing the m x m capacitance matrix, O(m^3), which is
+ * far below m solves with A as long as m^2 is small against the factor's non-zeros.
+ * Contacts which are regenerated every step on the same vertices only pay update().
+ */
+class low_rank_update_t
+{
+  public:
+    using scalar_type   = double;
+    using vector_type   = Eigen::VectorXd;
+    using triplets_type = std::vector<Eigen::Triplet<scalar_type>>;
+
+    static Eigen::Index constexpr max_stored_entries = Eigen::Index{1} << 24;
+
+    /**
+     * Prepares the update C, given by triplets, of the n x n matrix A which solver has
+     * been computed for
+     */
+    void compute(
+        linear_solver_t const& solver,
+        triplets_type const& triplets,
+        Eigen::Index n,
+        convergence_criteria_t const& criteria);
+
+    /**
+     * Replaces the update by the one given by triplets without solving with A. Returns
+     * false, leaving the update unchanged, if it touches other rows than the current
+     * update, then compute() has to be called instead.
+     */
+    bool update(triplets_type const& triplets);
+
+    /**
+     * Solves (A + C) * x = b, on input x holds the initial guess of iterative solvers.
+     * Returns the number of iterations performed by the solves with A.
+     */
+    int solve(
+        linear_solver_t const& solver,
+        vector_type const& b,
+        vector_type& x,
+        convergence_criteria_t const& criteria) const;
+
+    /**
+     * Number of rows touched by the update
+     */
+    Eigen::Index rank() const { return static_cast<Eigen::Index>(rows_.size()); }
+    bool empty() const { return rows_.empty(); }
+    void clear()
+    {
+        rows_.clear();
+        W_           = Eigen::MatrixXd{};
+        Z_           = Eigen::MatrixXd{};
+        G_           = Eigen::MatrixXd{};
+        capacitance_ = Eigen::PartialPivLU<Eigen::MatrixXd>{};
+    }
+
+  private:
+    /**
+     * Sets W = C_DD from the triplets of C and factorizes the capacitance matrix
+     */
+    void compute_capacitance(triplets_type const& triplets);
+
+    std::vector<Eigen::Index> rows_;                   ///< Rows D touched by the update
+    Eigen::MatrixXd W_;                                ///< C_DD
+    Eigen::MatrixXd Z_;                                ///< A^-1 * U, n x m, if it is small
+    Eigen::MatrixXd G_;                                ///< U^T * A^-1 * U
+    Eigen::PartialPivLU<Eigen::MatrixXd> capacitance_; ///< I + W * U^T * A^-1 * U
+};
+
+} // namespace pd
+
+#endif // PD_PD_LOW_RANK_UPDATE_H
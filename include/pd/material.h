@@ -0,0 +1,119 @@
+#ifndef PD_PD_MATERIAL_H
+#define PD_PD_MATERIAL_H
+
+#include <Eigen/Core>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace pd {
+
+/**
+ * Isotropic elastic material
+ */
+struct material_t
+{
+    using scalar_type = double;
+
+    scalar_type young_modulus = 1'000'000'000.;
+    scalar_type poisson_ratio = 0.45;
+};
+
+/**
+ * Lamé parameters of a material, converted once when the material is assigned, such
+ * that evaluating an element's energy is a lookup
+ */
+struct lame_parameters_t
+{
+    using scalar_type = double;
+
+    lame_parameters_t() : lame_parameters_t(material_t{}) {}
+    explicit lame_parameters_t(material_t const& material)
+        : mu(material.young_modulus / (2. * (1. + material.poisson_ratio))),
+          lambda(
+              (material.young_modulus * material.poisson_ratio) /
+              ((1. + material.poisson_ratio) * (1. - 2. * material.poisson_ratio)))
+    {
+    }
+
+    scalar_type mu;     ///< Shear modulus
+    scalar_type lambda; ///< First Lamé parameter
+};
+
+/**
+ * Materials of the elements of a mesh, stored contiguously as one lame_parameters_t
+ * per element, in the order of the mesh's elements. An empty field assigns the default
+ * material_t to every element.
+ *
+ * Elastic constraints copy the parameters of their element at construction, and their
+ * weight wi is scaled by the element's stiffness relative to the default material, so
+ * neither the local step, the assembly of the system matrix nor evaluating the energy
+ * pay for heterogeneous materials.
+ */
+class material_field_t
+{
+  public:
+    using scalar_type = double;
+
+    material_field_t() = default;
+    explicit material_field_t(std::vector<lame_parameters_t> parameters)
+        : parameters_(std::move(parameters))
+    {
+    }
+    material_field_t(
+        Eigen::VectorXd const& young_moduli,
+        Eigen::VectorXd const& poisson_ratios);
+
+    bool empty() const { return parameters_.empty(); }
+    std::size_t size() const { return parameters_.size(); }
+    std::vector<lame_parameters_t> const& parameters() const { return parameters_; }
+
+    lame_parameters_t const& operator()(std::size_t e) const
+    {
+        return empty() ? default_parameters() : parameters_[e];
+    }
+
+    /**
+     * Shear modulus of element e relative to the default material
+     */
+    scalar_type stiffness(std::size_t e) const
+    {
+        return (*this)(e).mu / default_parameters().mu;
+    }
+
+    /**
+     * Reorders the field along with the elements, element e becomes old element
+     * old_index[e]
+     */
+    void permute(std::vector<int> const& old_index);
+
+    /**
+     * Drops the materials of the elements e with is_removed[e], when the elements are
+     * removed from the mesh
+     */
+    void remove(std::vector<bool> const& is_removed);
+
+  private:
+    static lame_parameters_t const& default_parameters()
+    {
+        static lame_parameters_t const parameters{};
+        return parameters;
+    }
+
+    std::vector<lame_parameters_t> parameters_; ///< Parameters of each element
+};
+
+/**
+ * Reads per-element materials from a text file with one line "young_modulus
+ * poisson_ratio" per element, or a single line assigning one material to every
+ * element. Returns false, leaving field unchanged, if the file could not be read or
+ * does not match element_count.
+ */
+bool read_material_field(
+    std::string const& filename,
+    std::size_t element_count,
+    material_field_t& field);
+
+} // namespace pd
+
+#endif // PD_PD_MATERIAL_H
@@ -0,0 +1,89 @@
+#ifndef PD_PD_MULTIGRID_H
+#define PD_PD_MULTIGRID_H
+
+#include "linear_solver.h"
+
+#include <Eigen/SparseCholesky>
+#include <cstddef>
+#include <vector>
+
+namespace pd {
+
+/**
+ * Smoothed aggregation algebraic multigrid for the 3N x 3N system matrix of the
+ * global step. Vertices (3x3 blocks of A) are grouped into aggregates of
+ * neighbouring vertices, each aggregate becoming one coarse vertex. The tentative
+ * prolongator interpolates every coordinate piecewise constantly from the
+ * aggregates, which reproduces translations, the near null space of
+ * sum wi * (Ai*Si)^T * (Ai*Si). It is smoothed by one damped Jacobi step, and the
+ * coarse matrix is the Galerkin product P^T * A * P. Coarsening stops when few
+ * vertices are left, which are solved for directly.
+ *
+ * As a preconditioner, solve() applies one symmetric V-cycle with damped Jacobi
+ * smoothing, so memory and time per application are linear in the mesh size.
+ */
+class multigrid_preconditioner_t
+{
+  public:
+    using scalar_type        = double;
+    using sparse_matrix_type = Eigen::SparseMatrix<scalar_type>;
+    using vector_type        = Eigen::VectorXd;
+
+    void compute(sparse_matrix_type const& A);
+    vector_type solve(vector_type const& b) const;
+
+    std::size_t levels() const { return levels_.size() + 1u; }
+    int smoothing_steps() const { return smoothing_steps_; }
+    void set_smoothing_steps(int smoothing_steps) { smoothing_steps_ = smoothing_steps; }
+    int coarsest_vertex_count() const { return coarsest_vertex_count_; }
+    void set_coarsest_vertex_count(int count) { coarsest_vertex_count_ = count; }
+
+  private:
+    struct level_t
+    {
+        sparse_matrix_type A;         ///< System matrix of this level
+        sparse_matrix_type P;         ///< Prolongator from the next coarser level
+        sparse_matrix_type PT;        ///< Restriction P^T to the next coarser level
+        vector_type inverse_diagonal; ///< Inverse of the diagonal of A
+        scalar_type omega;            ///< Jacobi damping, 4 / (3 * rho(D^-1 * A))
+    };
+
+    void v_cycle(std::size_t l, vector_type const& b, vector_type& x) const;
+
+    std::vector<level_t> levels_;                           ///< Finest level first
+    sparse_matrix_type coarsest_A_;                         ///< Matrix of the coarsest level
+    Eigen::SimplicialLDLT<sparse_matrix_type> coarsest_solver_;
+    int smoothing_steps_       = 2;
+    int coarsest_vertex_count_ = 256;
+};
+
+/**
+ * Conjugate gradient solve of the global step preconditioned by multigrid
+ */
+class multigrid_solver_t : public linear_solver_t
+{
+  public:
+    virtual void compute(sparse_matrix_type const& A) override
+    {
+        A_ = A;
+        preconditioner_.compute(A_);
+    }
+
+    virtual int solve(
+        vector_type const& b,
+        vector_type& x,
+        convergence_criteria_t const& criteria) const override
+    {
+        return conjugate_gradient(A_, b, x, preconditioner_, criteria);
+    }
+
+    multigrid_preconditioner_t const& preconditioner() const { return preconditioner_; }
+
+  private:
+    sparse_matrix_type A_;
+    multigrid_preconditioner_t preconditioner_;
+};
+
+} // namespace pd
+
+#endif // PD_PD_MULTIGRID_H
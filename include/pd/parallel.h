@@ -0,0 +1,51 @@
+#ifndef PD_PD_PARALLEL_H
+#define PD_PD_PARALLEL_H
+
+#include "thread_pool.h"
+
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+namespace pd {
+
+/**
+ * Calls f(i) for every i in [begin, end), in parallel on the shared thread pool.
+ */
+template <class Function>
+void parallel_for(std::ptrdiff_t begin, std::ptrdiff_t end, Function&& f)
+{
+    thread_pool().parallel_for(begin, end, std::forward<Function>(f));
+}
+
+/**
+ * Computes init + f(begin) + ... + f(end - 1), in parallel on the shared thread pool.
+ * The partial sums of the chunks are added in order, such that the sum does not
+ * depend on which threads ran the chunks.
+ */
+template <class Scalar, class Function>
+Scalar parallel_sum(std::ptrdiff_t begin, std::ptrdiff_t end, Scalar init, Function&& f)
+{
+    auto& pool = thread_pool();
+    std::vector<Scalar> sums(static_cast<std::size_t>(pool.default_chunk_count()), Scalar{0});
+    pool.for_each_chunk(
+        begin,
+        end,
+        pool.default_chunk_count(),
+        [&](std::ptrdiff_t chunk, std::ptrdiff_t first, std::ptrdiff_t last) {
+            Scalar sum{0};
+            for (std::ptrdiff_t i = first; i < last; ++i)
+                sum += f(i);
+            sums[static_cast<std::size_t>(chunk)] = sum;
+        });
+
+    Scalar sum = init;
+    for (auto const& chunk_sum : sums)
+        sum += chunk_sum;
+
+    return sum;
+}
+
+} // namespace pd
+
+#endif // PD_PD_PARALLEL_H
@@ -15,6 +15,7 @@ class positional_constraint_t : public constraint_t
     using masses_type        = Eigen::VectorXd;
     using positions_type     = typename base_type::positions_type;
     using q_type             = typename base_type::q_type;
+    using q_float_type       = typename base_type::q_float_type;
     using gradient_type      = typename base_type::gradient_type;
     using sparse_matrix_type = Eigen::SparseMatrix<scalar_type>;
 
@@ -31,11 +32,52 @@ class positional_constraint_t : public constraint_t
         p0_           = p.row(vi).transpose();
     }
 
-    virtual void project_wi_SiT_AiT_Bi_pi(q_type const& q, Eigen::VectorXd& rhs) const override;
+    /**
+     * Restores a constraint from its stored state, see snapshot.h
+     */
+    positional_constraint_t(
+        std::vector<index_type> indices,
+        scalar_type wi,
+        Eigen::Vector3d const& target)
+        : base_type(std::move(indices), wi), p0_(target)
+    {
+        assert(this->indices().size() == 1u);
+    }
+
+    virtual std::unique_ptr<constraint_t> clone() const override
+    {
+        return std::make_unique<self_type>(*this);
+    }
+
+    virtual constraint_type_t type() const override { return constraint_type_t::positional; }
+
+    virtual scalar_type
+    project_wi_SiT_AiT_Bi_pi(q_type const& q, Eigen::VectorXd& rhs) const override;
+    virtual float
+    project_wi_SiT_AiT_Bi_pi(q_float_type const& q, Eigen::VectorXf& rhs) const override;
     virtual std::vector<Eigen::Triplet<scalar_type>>
     get_wi_SiT_AiT_Ai_Si(positions_type const& p, masses_type const& M) const override;
 
+    virtual scalar_type evaluate(positions_type const& p, masses_type const& M) const override;
+
+    /**
+     * The goal position p0. Moving it leaves wi * (Ai*Si)^T * (Ai*Si) unchanged, so
+     * targets can be animated without touching the system matrix.
+     */
+    Eigen::Vector3d const& target() const { return p0_; }
+    void set_target(Eigen::Vector3d const& target) { p0_ = target; }
+
+    virtual void copy_targets(constraint_t const& other) override
+    {
+        set_target(static_cast<self_type const&>(other).target());
+    }
+
   private:
+    template <class Scalar>
+    Scalar project(
+        Eigen::Matrix<Scalar, Eigen::Dynamic, 1> const& q,
+        Eigen::Matrix<Scalar, Eigen::Dynamic, 1>& b) const;
+
     Eigen::Vector3d p0_;
 };
 
@@ -0,0 +1,90 @@
+#ifndef PD_PD_SHAPE_TARGET_ANIMATION_H
+#define PD_PD_SHAPE_TARGET_ANIMATION_H
+
+#include "deformable_mesh.h"
+
+#include <Eigen/Core>
+#include <array>
+#include <cstddef>
+#include <vector>
+
+namespace pd {
+
+/**
+ * Keyframed animation of the shape targets of a model, for actuating it like muscles.
+ * A keyframe holds one symmetric stretch S per shape targeting constraint, in the
+ * order of the model's constraints (see deformable_mesh_t::set_shape_targets()).
+ *
+ * Stretches are stored as their matrix logarithm log(S), which is symmetric as well,
+ * so a keyframe packs each one into 6 floats (xx, yy, zz, xy, xz, yz) instead of 9
+ * doubles. Playback interpolates log(S) linearly between the two keyframes around the
+ * current time and exponentiates the result, which keeps the interpolated stretches
+ * symmetric positive definite and interpolates volume changes geometrically. The
+ * interpolated targets are computed in parallel and written directly into the
+ * constraints, without an intermediate buffer of matrices.
+ */
+class shape_target_animation_t
+{
+  public:
+    using scalar_type         = double;
+    using positions_type      = Eigen::MatrixXd;
+    using packed_stretch_type = std::array<float, 6u>; ///< log(S) as xx, yy, zz, xy, xz, yz
+
+    /**
+     * Adds a keyframe at time, with the stretches of the model's shape targeting
+     * constraints in the given pose. A keyframe at the same time is replaced.
+     */
+    void add_keyframe(scalar_type time, deformable_mesh_t const& model, positions_type const& pose);
+
+    /**
+     * Adds a keyframe at time from one stretch per shape targeting constraint
+     */
+    void add_keyframe(scalar_type time, std::vector<Eigen::Matrix3d> const& stretches);
+
+    void clear() { keyframes_.clear(); }
+    bool empty() const { return keyframes_.empty(); }
+    std::size_t keyframe_count() const { return keyframes_.size(); }
+    std::size_t target_count() const
+    {
+        return empty() ? std::size_t{0u} : keyframes_.front().log_stretches.size();
+    }
+    scalar_type start_time() const { return empty() ? scalar_type{0.} : keyframes_.front().time; }
+    scalar_type end_time() const { return empty() ? scalar_type{0.} : keyframes_.back().time; }
+
+    /**
+     * The interpolated stretch of the k-th shape targeting constraint at time, which is
+     * clamped to [start_time(), end_time()]
+     */
+    Eigen::Matrix3d stretch(scalar_type time, std::size_t k) const;
+
+    /**
+     * Sets the shape targets of model to the animation's stretches at time. Returns
+     * the number of targets set, 0 if the model's shape targeting constraints do not
+     * match the keyframes.
+     */
+    std::size_t apply(scalar_type time, deformable_mesh_t& model) const;
+
+  private:
+    struct keyframe_t
+    {
+        scalar_type time;
+        std::vector<packed_stretch_type> log_stretches;
+    };
+
+    /**
+     * The keyframes around time, and the interpolation parameter between them
+     */
+    void bracket(
+        scalar_type time,
+        keyframe_t const*& first,
+        keyframe_t const*& second,
+        float& alpha) const;
+
+    void insert(keyframe_t keyframe);
+
+    std::vector<keyframe_t> keyframes_; ///< Sorted by time
+};
+
+} // namespace pd
+
+#endif // PD_PD_SHAPE_TARGET_ANIMATION_H
@@ -1,15 +1,30 @@
 #ifndef PD_PD_SHAPE_TARGETING_CONSTRAINT_H
 #define PD_PD_SHAPE_TARGETING_CONSTRAINT_H
 
-#include "constraint.h"
+#include "tet_constraint.h"
 
 namespace pd {
 
-class shape_targeting_constraint_t : public constraint_t
+/**
+ * Projects F onto R * shapeTarget, where R is the closest rotation to F
+ * and shapeTarget is the symmetric stretch the tetrahedron should assume.
+ */
+struct shape_target_projection_t
+{
+    Eigen::Matrix3d shapeTarget = Eigen::Matrix3d::Identity();
+
+    template <class Scalar>
+    Eigen::Matrix<Scalar, 3, 3> project(Eigen::Matrix<Scalar, 3, 3> const& F) const
+    {
+        return rotation_projection_t{}.project(F) * shapeTarget.template cast<Scalar>();
+    }
+};
+
+class shape_targeting_constraint_t : public tet_constraint_t<shape_target_projection_t>
 {
   public:
     using self_type          = shape_targeting_constraint_t;
-    using base_type          = constraint_t;
+    using base_type          = tet_constraint_t<shape_target_projection_t>;
     using index_type         = std::uint32_t;
     using scalar_type        = double;
     using masses_type        = Eigen::VectorXd;
@@ -17,29 +32,59 @@ class shape_targeting_constraint_t : public constraint_t
     using q_type             = typename base_type::q_type;
     using gradient_type      = typename base_type::gradient_type;
     using sparse_matrix_type = Eigen::SparseMatrix<scalar_type>;
-    Eigen::Matrix3d shapeTarget;
 
   public:
     shape_targeting_constraint_t(
         std::initializer_list<index_type> indices,
         scalar_type wi,
-        positions_type const& p);
+        positions_type const& p,
+        lame_parameters_t const& lame = lame_parameters_t{});
 
-    void set_shape_target(positions_type const& p);
+    /**
+     * Restores a constraint from its stored state, see snapshot.h
+     */
+    shape_targeting_constraint_t(
+        std::vector<index_type> indices,
+        scalar_type wi,
+        packed_tet_t const& packed,
+        Eigen::Matrix3d const& shape_target,
+        lame_parameters_t const& lame);
+
+    virtual std::unique_ptr<constraint_t> clone() const override
+    {
+        return std::make_unique<self_type>(*this);
+    }
 
-    virtual scalar_type evaluate(positions_type const& p, masses_type const& M) override;
+    virtual constraint_type_t type() const override { return constraint_type_t::shape_targeting; }
 
-    virtual void project_wi_SiT_AiT_Bi_pi(q_type const& q, Eigen::VectorXd& rhs) const override;
+    Eigen::Matrix3d const& shape_target() const { return policy().shapeTarget; }
+    void set_shape_target(Eigen::Matrix3d const& shape_target)
+    {
+        policy().shapeTarget = shape_target;
+    }
 
-    virtual std::vector<Eigen::Triplet<scalar_type>>
-    get_wi_SiT_AiT_Ai_Si(positions_type const& p, masses_type const& M) const override;
+    /**
+     * The stretch S of the polar decomposition F = R * S of the tetrahedron's
+     * deformation gradient in the pose p
+     */
+    Eigen::Matrix3d stretch(positions_type const& p) const;
+    void set_shape_target(positions_type const& p) { set_shape_target(stretch(p)); }
 
-  private:
-    scalar_type V0_;
-    Eigen::Matrix3d DmInv_;
-    Eigen::Matrix3d R_; // Rotation matrix from polar decomposition
+    virtual void copy_targets(constraint_t const& other) override
+    {
+        set_shape_target(static_cast<self_type const&>(other).shape_target());
+    }
+
+    virtual scalar_type evaluate(positions_type const& p, masses_type const& M) const override;
 };
 
+/**
+ * Returns the shape targeting constraints among constraints, in order, found by their
+ * type tag
+ */
+std::vector<shape_targeting_constraint_t*>
+shape_targeting_constraints(std::vector<std::unique_ptr<constraint_t>> const& constraints);
+
 } // namespace pd
 
-#endif // PD_PD_SHAPE_TARGETING_CONSTRAINT_H
\ No newline at end of file
+#endif // PD_PD_SHAPE_TARGETING_CONSTRAINT_H
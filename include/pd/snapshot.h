@@ -0,0 +1,102 @@
+#ifndef PD_PD_SNAPSHOT_H
+#define PD_PD_SNAPSHOT_H
+
+#include "deformable_mesh.h"
+#include "linear_solver.h"
+
+#include <Eigen/SparseCore>
+#include <cstdint>
+#include <string>
+
+namespace pd {
+
+class solver_t;
+
+/**
+ * Version of the snapshot format written by save_snapshot()
+ */
+constexpr std::uint32_t snapshot_version = 4u;
+
+/**
+ * Snapshots store the complete state of a model in a binary file: rest and current
+ * positions, velocities, masses, fixed vertices, faces, elements, the vertex
+ * reordering, the element materials, and every constraint with its type tag, indices,
+ * weight and precomputed rest state, such that restoring does not recompute any rest
+ * shape.
+ * Given a solver prepared with the Cholesky global solver, the factorization of its
+ * system matrix is stored as well.
+ *
+ * The file is a header (magic, version, byte order mark) followed by sections, each
+ * a section tag, its byte size and its payload, padded to 8 bytes. Readers skip
+ * sections they do not know, and reject files of a different version or byte order.
+ */
+bool save_snapshot(
+    std::string const& filename,
+    deformable_mesh_t const& model,
+    solver_t const* solver = nullptr);
+
+/**
+ * Restores a snapshot into model, replacing its state. The file is memory mapped and
+ * copied into the model's arrays, so loading is bounded by memory bandwidth. Given a
+ * solver, it is attached to the model, and a stored factorization is imported into
+ * its factorization cache, such that the next prepare() for the snapshot's timestep
+ * does not factorize. Returns false, leaving model unchanged, if the file could not
+ * be read or is not a valid snapshot.
+ */
+bool load_snapshot(
+    std::string const& filename,
+    deformable_mesh_t& model,
+    solver_t* solver = nullptr);
+
+/**
+ * Hash of the dimensions, sparsity pattern and coefficients of A. Unlike the hashes of
+ * the factorization cache, it only depends on the matrix, so it identifies the same
+ * system matrix across runs and builds.
+ */
+std::uint64_t hash_matrix(Eigen::SparseMatrix<double> const& A);
+
+/**
+ * Identifies a system matrix in a directory of factorizations: its hash, and its
+ * dimension and number of non-zeros, which are compared exactly, such that a hash
+ * collision between matrices of different sizes or sparsity is detected
+ */
+struct matrix_key_t
+{
+    std::uint64_t hash;      ///< See hash_matrix()
+    std::uint64_t dimension; ///< Rows and columns
+    std::uint64_t nonzeros;  ///< Stored entries
+};
+
+matrix_key_t get_matrix_key(Eigen::SparseMatrix<double> const& A);
+
+/**
+ * Stores the factorization of the system matrix with the given key in the snapshot
+ * format, in a section holding the key and the factor. The file is written to a
+ * temporary file first and renamed, such that concurrent jobs sharing a directory
+ * never read a partially written factorization.
+ */
+bool save_factorization(
+    std::string const& filename,
+    matrix_key_t const& key,
+    ldlt_factor_t const& factor);
+
+/**
+ * Reads a factorization stored by save_factorization(). Returns false if the file could
+ * not be read, is not a valid factorization file, or was stored for a matrix with a
+ * different key or a factor of a different dimension.
+ */
+bool load_factorization(
+    std::string const& filename,
+    matrix_key_t const& key,
+    ldlt_factor_t& factor);
+
+/**
+ * The directory of factorizations shared across runs named by the environment variable
+ * PD_FACTORIZATION_DIR, empty if it is not set. Solvers start out with it, see
+ * solver_t::set_factorization_directory().
+ */
+std::string factorization_directory_from_environment();
+
+} // namespace pd
+
+#endif // PD_PD_SNAPSHOT_H
@@ -1,13 +1,35 @@
 #ifndef PD_PD_SIMULATION_H
 #define PD_PD_SIMULATION_H
 
+#include "chebyshev_jacobi.h"
+#include "collision.h"
 #include "deformable_mesh.h"
+#include "domain_decomposition.h"
+#include "linear_solver.h"
+#include "low_rank_update.h"
+#include "multigrid.h"
+#include "snapshot.h"
+#include "thread_pool.h"
 
 #include <Eigen/Dense>
 #include <Eigen/SparseCholesky>
 #include <Eigen/SparseCore>
 #include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <functional>
+#include <future>
+#include <iomanip>
 #include <iostream>
+#include <list>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <type_traits>
+#include <typeinfo>
+#include <utility>
 #include <vector>
 
 namespace pd {
@@ -34,16 +56,102 @@ inline Eigen::MatrixXd unflatten(Eigen::VectorXd const& q)
     return p;
 }
 
+/**
+ * Hashes what a constraint set contributes to the system matrix,
+ * that is, the type, indices, weight and rest state of every constraint.
+ */
+inline std::size_t hash_constraints(deformable_mesh_t::constraints_type const& constraints)
+{
+    using scalar_type = typename deformable_mesh_t::scalar_type;
+
+    std::size_t seed = 0u;
+    hash_combine(seed, constraints.size());
+    for (auto const& constraint : constraints)
+    {
+        hash_combine(seed, typeid(*constraint).hash_code());
+        hash_combine(seed, std::hash<scalar_type>{}(constraint->wi()));
+        for (auto const i : constraint->indices())
+            hash_combine(seed, i);
+        hash_combine(seed, constraint->hash_rest_state());
+    }
+    return seed;
+}
+
+/**
+ * Hashes everything that enters the system matrix except the timestep,
+ * that is, the constraint set (type, indices, weights, rest states) and the
+ * per-vertex masses.
+ */
+inline std::size_t hash_system(deformable_mesh_t const& model)
+{
+    std::size_t seed = hash_constraints(model.constraints());
+
+    auto const& mass = model.mass();
+    hash_combine(seed, static_cast<std::size_t>(mass.rows()));
+    hash_combine_coefficients(seed, mass);
+
+    return seed;
+}
+
+/**
+ * What the factorization cache compares exactly next to the hash of a system, such that
+ * a hash collision between systems of different sizes never reuses a factorization.
+ * Both are known without assembling the system matrix, which a cache hit skips.
+ */
+struct system_size_t
+{
+    Eigen::Index dimension;       ///< 3 * number of vertices
+    std::size_t constraint_count; ///< Number of constraints of the model
+
+    bool operator==(system_size_t const& other) const
+    {
+        return dimension == other.dimension && constraint_count == other.constraint_count;
+    }
+};
+
+inline system_size_t system_size(deformable_mesh_t const& model)
+{
+    return system_size_t{3 * model.positions().rows(), model.constraints().size()};
+}
+
 } // namespace detail
 
+/**
+ * Linear solvers available for the global step
+ */
+enum class global_solver_t {
+    cholesky,            ///< Sparse Cholesky factorization, the default
+    multigrid,           ///< Multigrid preconditioned CG, for meshes too large to factorize
+    domain_decomposition, ///< Additive Schwarz preconditioned CG, parallel over subdomains
+    chebyshev_jacobi      ///< One Chebyshev accelerated Jacobi sweep per iteration, inexact
+};
+
+/**
+ * When regions of the mesh fall asleep, see solver_t::set_sleeping_active()
+ */
+struct sleeping_criteria_t
+{
+    using scalar_type = double;
+
+    std::size_t region_size      = 256u; ///< Vertices per region
+    scalar_type velocity         = 1e-3; ///< Speed below which a vertex is at rest
+    scalar_type energy_tolerance = 1e-4; ///< Relative change of a region's energy at rest
+    int step_count               = 10;   ///< Steps at rest before a region falls asleep
+};
+
 class solver_t
 {
   public:
-    using scalar_type = typename deformable_mesh_t::scalar_type;
+    using scalar_type        = typename deformable_mesh_t::scalar_type;
+    using sparse_matrix_type = Eigen::SparseMatrix<scalar_type>;
+    using cholesky_type      = typename cholesky_solver_t::cholesky_type;
 
     void set_model(deformable_mesh_t* model)
     {
         model_ = model;
+        contacts_.clear();
+        transient_constraints_.clear();
+        clear_factorization_cache();
         set_dirty();
     }
     deformable_mesh_t const* model() const { return model_; }
@@ -51,45 +159,346 @@ class solver_t
     void set_dirty() { dirty_ = true; }
     void set_clean() { dirty_ = false; }
     bool ready() const { return !dirty_; }
-    void prepare(scalar_type dt)
+    scalar_type dt() const { return dt_; }
+
+    /**
+     * With a collision detector, every step detects contacts at the predicted
+     * positions and adds them to the local step as half-space constraints.
+     */
+    collision_detector_t* collision_detector() const { return collision_detector_; }
+    void set_collision_detector(collision_detector_t* collision_detector)
     {
-        dt_                   = dt;
-        auto const& positions = model_->positions();
-        auto const& mass      = model_->mass();
-        auto const N          = positions.rows();
+        collision_detector_ = collision_detector;
+    }
+    deformable_mesh_t::constraints_type const& contacts() const { return contacts_; }
 
-        auto const dt2_inv = scalar_type{1.} / (dt * dt);
+    /**
+     * Transient constraints, like contacts, are projected in the local step next to
+     * the model's constraints, but they do not enter the factorized system matrix.
+     * Their contribution to it is applied as a low rank update of the cached
+     * factorization instead, so adding or removing them never refactorizes. They
+     * should touch few vertices, each step with a changed set of transient
+     * constraints (contacts included) performs one solve per touched coordinate.
+     */
+    deformable_mesh_t::constraints_type const& transient_constraints() const
+    {
+        return transient_constraints_;
+    }
+    void add_transient_constraint(std::unique_ptr<constraint_t> constraint)
+    {
+        transient_constraints_.push_back(std::move(constraint));
+    }
+    void remove_transient_constraint(constraint_t const* constraint)
+    {
+        transient_constraints_.erase(
+            std::remove_if(
+                transient_constraints_.begin(),
+                transient_constraints_.end(),
+                [constraint](std::unique_ptr<constraint_t> const& c) {
+                    return c.get() == constraint;
+                }),
+            transient_constraints_.end());
+    }
+    void clear_transient_constraints() { transient_constraints_.clear(); }
+    /**
+     * Number of rows of the system matrix touched by the transient constraints of the
+     * last step
+     */
+    Eigen::Index low_rank_update_rank() const { return low_rank_update_.rank(); }
+
+    /**
+     * Selects the linear solver of the global step. Iterative solvers run until the
+     * convergence criteria are met, warm started from the previous iterate.
+     */
+    global_solver_t global_solver() const { return global_solver_; }
+    void set_global_solver(global_solver_t global_solver)
+    {
+        if (global_solver == global_solver_)
+            return;
 
-        std::vector<Eigen::Triplet<scalar_type>> A_triplets;
-        // vectors double their size on each reallocation.
-        // we decrease the number of reallocations by preallocating a large chunk
-        // upfront to improve performance. 3*N is just a good initial starting capacity
-        A_triplets.reserve(3 * N);
-        auto& constraints = model_->constraints();
-        for (auto& constraint : constraints)
+        global_solver_ = global_solver;
+        set_dirty();
+    }
+    convergence_criteria_t const& convergence_criteria() const { return convergence_criteria_; }
+    void set_convergence_criteria(convergence_criteria_t const& criteria)
+    {
+        convergence_criteria_ = criteria;
+    }
+    /**
+     * Acceleration of the Chebyshev Jacobi solver, which trades the exact global solve
+     * for one parallel Jacobi sweep per local-global iteration and never factorizes
+     */
+    chebyshev_acceleration_t const& chebyshev_acceleration() const
+    {
+        return chebyshev_acceleration_;
+    }
+    void set_chebyshev_acceleration(chebyshev_acceleration_t const& acceleration)
+    {
+        chebyshev_acceleration_ = acceleration;
+    }
+    /**
+     * Number of subdomains and layers of overlap of the domain decomposition solver
+     */
+    int subdomain_count() const { return subdomain_count_; }
+    int subdomain_overlap() const { return subdomain_overlap_; }
+    void set_subdomains(int count, int overlap)
+    {
+        if (count == subdomain_count_ && overlap == subdomain_overlap_)
+            return;
+
+        subdomain_count_   = count;
+        subdomain_overlap_ = overlap;
+        if (global_solver_ == global_solver_t::domain_decomposition)
         {
-            auto const SiT_AiT_Ai_Si = constraint->get_wi_SiT_AiT_Ai_Si(positions, mass);
-            A_triplets.insert(A_triplets.end(), SiT_AiT_Ai_Si.begin(), SiT_AiT_Ai_Si.end());
+            clear_factorization_cache();
+            set_dirty();
         }
+    }
+    /**
+     * Total number of linear solver iterations of the global steps of the last step
+     */
+    int global_solver_iterations() const { return global_solver_iterations_; }
 
-        for (auto i = 0; i < N; ++i)
+    /**
+     * Factorizations (or multigrid hierarchies) are kept in a least recently used cache
+     * keyed by the timestep, a hash of the constraint set and the global solver, so that
+     * switching back to a previously used timestep (or constraint set) does not
+     * refactorize the system matrix. Each entry also stores the dimension and the number
+     * of constraints of its system, which a lookup compares exactly before reusing it.
+     */
+    std::size_t factorization_cache_capacity() const { return factorization_cache_capacity_; }
+    std::size_t factorization_cache_size() const { return factorization_cache_.size(); }
+    void set_factorization_cache_capacity(std::size_t capacity)
+    {
+        factorization_cache_capacity_ = std::max(capacity, std::size_t{1u});
+        while (factorization_cache_.size() > factorization_cache_capacity_)
+            factorization_cache_.pop_back();
+    }
+    /**
+     * The Cholesky solver of the active cache entry, null if the solver is not prepared
+     * or the global solver does not factorize
+     */
+    cholesky_solver_t const* cholesky_solver() const
+    {
+        if (global_solver_ != global_solver_t::cholesky || linear_solver_ == nullptr)
+            return nullptr;
+
+        // after a topology edit, the active solver may still await its factorization
+        auto const is_active = [this](factorization_cache_entry_t const& entry) {
+            return entry.linear_solver.get() == linear_solver_;
+        };
+        auto const it =
+            std::find_if(factorization_cache_.begin(), factorization_cache_.end(), is_active);
+        if (it == factorization_cache_.end() || it->is_stale)
+            return nullptr;
+
+        return static_cast<cholesky_solver_t const*>(linear_solver_);
+    }
+
+    /**
+     * Adds a stored factorization of the current model's system matrix for timestep
+     * dt to the factorization cache, such that prepare(dt) with the Cholesky global
+     * solver does not factorize. The factor must have been computed for the same
+     * constraints and masses. Returns false, leaving the cache unchanged, if the factor's
+     * dimension is not the model's.
+     */
+    bool import_factorization(scalar_type dt, ldlt_factor_t factor)
+    {
+        auto const size = detail::system_size(*model_);
+        if (factor.D.size() != size.dimension)
+            return false;
+
+        std::size_t const hash = detail::hash_system(*model_);
+        factorization_cache_.remove_if([&](factorization_cache_entry_t const& entry) {
+            return entry.dt == dt && entry.hash == hash && entry.size == size &&
+                   entry.global_solver == global_solver_t::cholesky;
+        });
+
+        auto linear_solver = std::make_unique<cholesky_solver_t>();
+        linear_solver->set_factor(std::move(factor));
+        factorization_cache_.push_front(factorization_cache_entry_t{
+            dt,
+            hash,
+            size,
+            global_solver_t::cholesky,
+            std::move(linear_solver)});
+        if (factorization_cache_.size() > factorization_cache_capacity_)
+            factorization_cache_.pop_back();
+
+        // the active solver may have been evicted
+        linear_solver_   = nullptr;
+        low_rank_solver_ = nullptr;
+        set_dirty();
+        return true;
+    }
+
+    /**
+     * Directory of factorizations shared across runs, empty to disable it. It defaults to
+     * the environment variable PD_FACTORIZATION_DIR, so batch jobs enable it without code
+     * changes. On a factorization cache miss with the Cholesky global solver, prepare()
+     * reads the factorization of the system matrix from this directory, looking it up by
+     * the matrix's key (see get_matrix_key()), and stores it there after factorizing if it
+     * was not found. Jobs which rerun the same mesh, weights and timestep thus factorize
+     * once. The key is computed from the assembled matrix, so a hit still pays for
+     * assembling and hashing the system matrix, and only skips the factorization.
+     */
+    std::string const& factorization_directory() const { return factorization_directory_; }
+    void set_factorization_directory(std::string directory)
+    {
+        factorization_directory_ = std::move(directory);
+    }
+
+    void clear_factorization_cache()
+    {
+        factorization_cache_.clear();
+        linear_solver_          = nullptr;
+        low_rank_solver_        = nullptr;
+        system_hash_            = 0u;
+        K_                      = sparse_matrix_type{};
+    }
+
+    void prepare(scalar_type dt)
+    {
+        build_local_constraints();
+        if (is_sleeping_active_)
+            build_shards();
+        build_chunks(thread_pool());
+
+        dt_                     = dt;
+        std::size_t const hash  = detail::hash_system(*model_);
+        auto const size         = detail::system_size(*model_);
+        low_rank_solver_        = nullptr;
+        auto const is_cache_hit = [&](factorization_cache_entry_t const& entry) {
+            return entry.dt == dt && entry.hash == hash && entry.size == size &&
+                   entry.global_solver == global_solver_;
+        };
+
+        auto const it =
+            std::find_if(factorization_cache_.begin(), factorization_cache_.end(), is_cache_hit);
+        if (it != factorization_cache_.end())
         {
-            A_triplets.push_back({3 * i + 0, 3 * i + 0, mass(i) * dt2_inv});
-            A_triplets.push_back({3 * i + 1, 3 * i + 1, mass(i) * dt2_inv});
-            A_triplets.push_back({3 * i + 2, 3 * i + 2, mass(i) * dt2_inv});
+            // move the hit to the front, it is now the most recently used factorization
+            factorization_cache_.splice(factorization_cache_.begin(), factorization_cache_, it);
+            linear_solver_ = factorization_cache_.front().linear_solver.get();
+            set_clean();
+            return;
         }
 
-        Eigen::SparseMatrix<scalar_type> A(3 * N, 3 * N);
-        A.setFromTriplets(A_triplets.begin(), A_triplets.end());
+        sparse_matrix_type const A = assemble_system_matrix(dt, hash);
+
+        std::unique_ptr<linear_solver_t> linear_solver;
+        if (global_solver_ == global_solver_t::multigrid)
+            linear_solver = std::make_unique<multigrid_solver_t>();
+        else if (global_solver_ == global_solver_t::domain_decomposition)
+            linear_solver = std::make_unique<domain_decomposition_solver_t>(
+                subdomain_count_,
+                subdomain_overlap_);
+        else if (global_solver_ == global_solver_t::chebyshev_jacobi)
+            linear_solver = std::make_unique<jacobi_solver_t>();
+        else
+            linear_solver = std::make_unique<cholesky_solver_t>();
+
+        if (global_solver_ == global_solver_t::cholesky && !factorization_directory_.empty())
+            factorize_with_directory(A, static_cast<cholesky_solver_t&>(*linear_solver));
+        else
+            linear_solver->compute(A);
 
-        cholesky_decomposition_.compute(A);
+        factorization_cache_.push_front(
+            factorization_cache_entry_t{dt, hash, size, global_solver_, std::move(linear_solver)});
+        if (factorization_cache_.size() > factorization_cache_capacity_)
+            factorization_cache_.pop_back();
+
+        linear_solver_ = factorization_cache_.front().linear_solver.get();
 
         set_clean();
     }
 
+    /**
+     * Updates the prepared solver after a topology edit of the model, see
+     * deformable_mesh_t::remove_elements() and deformable_mesh_t::split_vertex(),
+     * without refactorizing in the frame of the edit. With the Cholesky global solver,
+     * the system matrix is reassembled, and until its factorization is ready, the global
+     * step runs conjugate gradients on it, preconditioned by the previous factorization
+     * (see stale_factor_solver_t). The factorization is computed as a task of the thread
+     * pool and replaces the preconditioned solver at the start of the first step after it
+     * finished. Without workers, that is for PD_THREAD_COUNT=1, the thread pool runs the
+     * task immediately (see thread_pool_t::submit()), so the edit does refactorize in its
+     * frame, and the preconditioned solver is replaced by the next step. Other global
+     * solvers are prepared again by the next prepare().
+     */
+    void update_topology()
+    {
+        if (!ready() || global_solver_ != global_solver_t::cholesky || linear_solver_ == nullptr)
+        {
+            set_dirty();
+            return;
+        }
+
+        auto const is_active = [this](factorization_cache_entry_t const& entry) {
+            return entry.linear_solver.get() == linear_solver_;
+        };
+        auto const it =
+            std::find_if(factorization_cache_.begin(), factorization_cache_.end(), is_active);
+        assert(it != factorization_cache_.end());
+
+        // the previous factorization no longer matches any system, take it out of the
+        // cache. A solver still waiting for its factorization hands its own one on.
+        std::unique_ptr<linear_solver_t> factorization = std::move(it->linear_solver);
+        Eigen::Index factorization_size{0};
+        if (it->is_stale)
+        {
+            auto& stale_solver = static_cast<stale_factor_solver_t&>(*factorization);
+            factorization_size = stale_solver.factorization_size();
+            factorization      = stale_solver.release_factorization();
+        }
+        else
+        {
+            factorization_size = static_cast<cholesky_solver_t&>(*factorization).size();
+        }
+        factorization_cache_.erase(it);
+
+        std::size_t const hash     = detail::hash_system(*model_);
+        sparse_matrix_type const A = assemble_system_matrix(dt_, hash);
+        auto linear_solver         = std::make_unique<stale_factor_solver_t>(
+            std::move(factorization),
+            factorization_size);
+        linear_solver->compute(A);
+        factorization_cache_.push_front(factorization_cache_entry_t{
+            dt_,
+            hash,
+            detail::system_size(*model_),
+            global_solver_,
+            std::move(linear_solver),
+            true});
+        if (factorization_cache_.size() > factorization_cache_capacity_)
+            factorization_cache_.pop_back();
+        linear_solver_   = factorization_cache_.front().linear_solver.get();
+        low_rank_solver_ = nullptr;
+
+        refactorizations_.push_back(refactorization_t{
+            dt_,
+            hash,
+            thread_pool().submit([A]() -> std::unique_ptr<linear_solver_t> {
+                auto cholesky_solver = std::make_unique<cholesky_solver_t>();
+                cholesky_solver->compute(A);
+                return cholesky_solver;
+            })});
+
+        build_local_constraints();
+        if (is_sleeping_active_)
+            build_shards();
+        build_chunks(thread_pool());
+    }
+
+    /**
+     * Whether factorizations started by update_topology() are still being computed
+     */
+    bool is_refactorizing() const { return !refactorizations_.empty(); }
+
     void step(Eigen::MatrixXd const& fext, int num_iterations = 10)
     {
-        auto const& constraints = model_->constraints(); // std::vector<constraint_t*>, likely 2-3
+        collect_refactorizations();
+
         auto& positions         = model_->positions();  // Eigen::MatrixXd, V x 3
         auto& velocities        = model_->velocity();   // Eigen::MatrixXd, V x 3
         auto const& mass        = model_->mass();    // Eigen::VectorXd, V x 1
@@ -107,6 +516,15 @@ class solver_t
         // format of sn is [x1, y1, z1, x2, y2, z2, ..., xn, yn, zn]^T
         Eigen::VectorXd sn = detail::flatten(explicit_integration); // size 3V x 1
 
+        if (collision_detector_ != nullptr)
+            contacts_ = collision_detector_->detect(*model_, explicit_integration);
+        else
+            contacts_.clear();
+
+        update_low_rank_update();
+        if (is_sleeping_active_)
+            wake_regions(fext);
+
         // the matrix-vector product: (M / dt^2) * sn
         Eigen::VectorXd masses;
         masses.resize(3 * N);   // size 3V x 1
@@ -121,38 +539,851 @@ class solver_t
             auto const sni               = sn.block(3u * i, 0, 3, 1); // extract from 3i to 3i+2
             masses.block(3 * i, 0, 3, 1) = dt2_inv * M * sni;
         }
+        // the constant right hand side of the constraints with constant projections
+        if (b_constant_.rows() == masses.rows())
+            masses += b_constant_;
 
         // initial q(t+1)
         Eigen::VectorXd q = sn; // size 3V x 1
 
+        if (is_mixed_precision_)
+            solve_local_global<float>(q, sn, masses, num_iterations);
+        else
+            solve_local_global<scalar_type>(q, sn, masses, num_iterations);
+
+        if (is_sleeping_active_)
+            update_sleeping_regions(q);
+
+        Eigen::MatrixXd const qn_plus_1 = detail::unflatten(q);
+        velocities                      = (qn_plus_1 - positions) * dt_inv;
+        positions                       = qn_plus_1;
+    }
+
+    /**
+     * In mixed precision mode, the local step (constraint projections and the
+     * right hand side accumulation) runs in single precision while the global
+     * solve keeps using the double precision factorization.
+     */
+    bool is_mixed_precision() const { return is_mixed_precision_; }
+    void set_mixed_precision(bool is_mixed_precision) { is_mixed_precision_ = is_mixed_precision; }
+
+    /**
+     * The local step returns each constraint's energy as a byproduct of its projection,
+     * so the projective dynamics objective
+     *
+     *     1/(2 dt^2) * |M^(1/2) * (q - sn)|^2 + sum wi/2 * |Ai*Si*q - Bi*pi|^2
+     *
+     * of every iterate q is known at no extra cost. energy_history() holds the objective
+     * of the iterates of the last step. With a non-zero energy tolerance, a step stops
+     * iterating once the objective decreased by less than tolerance * objective.
+     *
+     * Constraints with constant projections, such as isometric bending, are not
+     * projected, see build_local_constraints(). Their term of the objective is evaluated
+     * as a quadratic form, which costs a sparse matrix-vector product per iterate. It is
+     * only included when the objective is needed: with an energy tolerance, with the
+     * Chebyshev Jacobi solver, whose acceleration restarts when the objective increases,
+     * or with energy monitoring on. Otherwise, energy_history() leaves their term out.
+     */
+    std::vector<scalar_type> const& energy_history() const { return energy_history_; }
+    int iterations() const { return iterations_; }
+    scalar_type energy_tolerance() const { return energy_tolerance_; }
+    void set_energy_tolerance(scalar_type tolerance) { energy_tolerance_ = tolerance; }
+    bool is_energy_monitored() const { return is_energy_monitored_; }
+    void set_energy_monitored(bool is_energy_monitored)
+    {
+        is_energy_monitored_ = is_energy_monitored;
+    }
+
+    /**
+     * With sleeping, the vertices are split into regions of consecutive vertex indices,
+     * which reorder_vertices() makes spatially coherent, and the model's constraints
+     * into one shard per region, by their smallest vertex index. A region falls asleep
+     * once its vertices moved slower than the criteria's velocity and the energy of its
+     * shard stayed constant for step_count steps. Its vertices then keep their
+     * positions, and shards touching only sleeping regions are skipped in the local
+     * step, their contribution to the right hand side is cached instead. A region wakes
+     * up when the external force on one of its vertices changes, a vertex gets a new
+     * contact or a transient constraint, or the global solve moves a vertex faster than
+     * the criteria's velocity. The local step thus scales with the active regions, the
+     * global solve still covers every vertex.
+     */
+    bool is_sleeping_active() const { return is_sleeping_active_; }
+    void set_sleeping_active(bool is_sleeping_active)
+    {
+        if (is_sleeping_active == is_sleeping_active_)
+            return;
+
+        is_sleeping_active_ = is_sleeping_active;
+        set_dirty();
+    }
+    sleeping_criteria_t const& sleeping_criteria() const { return sleeping_criteria_; }
+    void set_sleeping_criteria(sleeping_criteria_t const& criteria)
+    {
+        if (criteria.region_size != sleeping_criteria_.region_size)
+            set_dirty();
+
+        sleeping_criteria_ = criteria;
+    }
+    std::size_t region_count() const { return is_region_asleep_.size(); }
+    std::size_t sleeping_region_count() const
+    {
+        return static_cast<std::size_t>(
+            std::count(is_region_asleep_.begin(), is_region_asleep_.end(), true));
+    }
+    void wake_all()
+    {
+        std::fill(is_region_asleep_.begin(), is_region_asleep_.end(), false);
+        std::fill(quiet_steps_.begin(), quiet_steps_.end(), 0);
+        are_shards_dirty_ = true;
+    }
+
+  private:
+    /**
+     * Assembles the system matrix M / dt^2 + sum wi * (Ai*Si)^T * (Ai*Si) of the model,
+     * whose constraints and masses have the given hash
+     */
+    sparse_matrix_type assemble_system_matrix(scalar_type dt, std::size_t hash)
+    {
+        auto const& positions = model_->positions();
+        auto const& mass      = model_->mass();
+        auto const N          = positions.rows();
+
+        // The constraint part of the system matrix, sum wi * (Ai*Si)^T * (Ai*Si),
+        // does not depend on dt, so we only reassemble it when the constraint set changed.
+        if (hash != system_hash_ || K_.rows() != 3 * N)
+        {
+            // Each chunk of constraints collects its own triplets, which are concatenated
+            // in chunk order, such that K does not depend on the threads' timing.
+            auto& pool              = thread_pool();
+            auto const& constraints = model_->constraints();
+            std::vector<std::vector<Eigen::Triplet<scalar_type>>> chunk_triplets(
+                static_cast<std::size_t>(pool.default_chunk_count()));
+            pool.for_each_chunk(
+                0,
+                static_cast<std::ptrdiff_t>(constraints.size()),
+                pool.default_chunk_count(),
+                [&](std::ptrdiff_t chunk, std::ptrdiff_t first, std::ptrdiff_t last) {
+                    auto& triplets = chunk_triplets[static_cast<std::size_t>(chunk)];
+                    for (std::ptrdiff_t c = first; c < last; ++c)
+                    {
+                        auto const SiT_AiT_Ai_Si =
+                            constraints[static_cast<std::size_t>(c)]->get_wi_SiT_AiT_Ai_Si(
+                                positions,
+                                mass);
+                        triplets.insert(
+                            triplets.end(),
+                            SiT_AiT_Ai_Si.begin(),
+                            SiT_AiT_Ai_Si.end());
+                    }
+                });
+
+            std::size_t triplet_count = 0u;
+            for (auto const& triplets : chunk_triplets)
+                triplet_count += triplets.size();
+            std::vector<Eigen::Triplet<scalar_type>> K_triplets;
+            K_triplets.reserve(triplet_count);
+            for (auto const& triplets : chunk_triplets)
+                K_triplets.insert(K_triplets.end(), triplets.begin(), triplets.end());
+
+            K_.resize(3 * N, 3 * N);
+            K_.setFromTriplets(K_triplets.begin(), K_triplets.end());
+            system_hash_ = hash;
+        }
+
+        auto const dt2_inv = scalar_type{1.} / (dt * dt);
+        Eigen::VectorXd M(3 * N);
+        for (auto i = 0; i < N; ++i)
+            M.block(3 * i, 0, 3, 1).setConstant(mass(i) * dt2_inv);
+
+        sparse_matrix_type A = K_;
+        A += sparse_matrix_type(M.asDiagonal());
+        return A;
+    }
+
+    /**
+     * Swaps finished background factorizations into the cache entries still waiting
+     * for them. Factorizations of systems superseded by later edits are dropped.
+     */
+    void collect_refactorizations()
+    {
+        for (auto it = refactorizations_.begin(); it != refactorizations_.end();)
+        {
+            auto const status = it->factorization.wait_for(std::chrono::seconds{0});
+            if (status != std::future_status::ready)
+            {
+                ++it;
+                continue;
+            }
+
+            auto const is_waiting = [&](factorization_cache_entry_t const& entry) {
+                return entry.is_stale && entry.dt == it->dt && entry.hash == it->hash;
+            };
+            auto const entry =
+                std::find_if(factorization_cache_.begin(), factorization_cache_.end(), is_waiting);
+            if (entry != factorization_cache_.end())
+            {
+                bool const is_active = entry->linear_solver.get() == linear_solver_;
+                entry->linear_solver = it->factorization.get();
+                entry->is_stale      = false;
+                if (is_active)
+                    linear_solver_ = entry->linear_solver.get();
+            }
+            it = refactorizations_.erase(it);
+        }
+    }
+
+    /**
+     * Recomputes the low rank update of the transient constraints if they or the
+     * factorization they update changed. Linear solvers which support updates of
+     * their system matrix apply the transient constraints themselves. The m solves
+     * with the factorization, see low_rank_update_t, are only paid when the factorization
+     * or the set of rows the constraints touch changed. Contacts regenerated every step
+     * on the same vertices, or a dragged vertex, only refactorize the m x m capacitance
+     * matrix.
+     */
+    void update_low_rank_update()
+    {
+        std::size_t hash = detail::hash_constraints(contacts_);
+        detail::hash_combine(hash, detail::hash_constraints(transient_constraints_));
+        bool const is_same_solver = linear_solver_ == low_rank_solver_;
+        if (hash == low_rank_hash_ && is_same_solver)
+            return;
+
+        low_rank_hash_   = hash;
+        low_rank_solver_ = linear_solver_;
+
+        auto const& positions = model_->positions();
+        auto const& mass      = model_->mass();
+        low_rank_update_t::triplets_type triplets;
+        for (auto const* constraints : {&contacts_, &transient_constraints_})
+        {
+            for (auto const& constraint : *constraints)
+            {
+                auto const SiT_AiT_Ai_Si = constraint->get_wi_SiT_AiT_Ai_Si(positions, mass);
+                triplets.insert(triplets.end(), SiT_AiT_Ai_Si.begin(), SiT_AiT_Ai_Si.end());
+            }
+        }
+        auto const n = 3 * positions.rows();
+        sparse_matrix_type C(n, n);
+        C.setFromTriplets(triplets.begin(), triplets.end());
+        if (linear_solver_->set_update(C))
+        {
+            low_rank_update_.clear();
+            return;
+        }
+
+        if (is_same_solver && low_rank_update_.update(triplets))
+            return;
+
+        low_rank_update_.compute(*linear_solver_, triplets, n, convergence_criteria_);
+    }
+
+    template <class LocalScalar>
+    void solve_local_global(
+        Eigen::VectorXd& q,
+        Eigen::VectorXd const& sn,
+        Eigen::VectorXd const& masses,
+        int num_iterations)
+    {
+        using local_vector_type = Eigen::Matrix<LocalScalar, Eigen::Dynamic, 1>;
+
+        auto const& mass   = model_->mass();
+        auto const dt2_inv = scalar_type{1.} / (dt_ * dt_);
+
+        // the pool is fetched once per step, the local step runs once per iteration
+        auto& pool = thread_pool();
+
         Eigen::VectorXd b;
-        b.resize(3 * N); // size 3V x 1
+        b.resize(q.rows()); // size 3V x 1
+
+        local_vector_type q_local;
+        local_vector_type b_local;
+        if constexpr (!std::is_same_v<LocalScalar, scalar_type>)
+            b_local.resize(q.rows());
+
+        bool const is_chebyshev = global_solver_ == global_solver_t::chebyshev_jacobi;
+        Eigen::VectorXd q_previous;
+        Eigen::VectorXd q_hat;
+        scalar_type omega{1.};
+        int chebyshev_k = 0; // iterations since the acceleration (re)started
 
+        bool const is_energy_needed =
+            energy_tolerance_ > scalar_type{0.} || is_chebyshev || is_energy_monitored_;
+        bool const has_constant_energy =
+            is_energy_needed && constant_energy_matrix_.rows() == q.rows();
+
+        energy_history_.clear();
+        iterations_               = 0;
+        global_solver_iterations_ = 0;
         for (int k = 0; k < num_iterations; ++k) // minimize the loss by adjusting q (q(t+1)
         {
             // b = (M/dt^2)*sn + sum wi * (Ai*Si)^T * (Ai*Si)
-            b.setZero();
-            for (auto const& constraint : constraints)
+            scalar_type elastic_energy{0.};
+            if constexpr (std::is_same_v<LocalScalar, scalar_type>)
+            {
+                b.setZero();
+                elastic_energy = project_constraints(pool, q, b);
+                for (auto const& contact : contacts_)
+                {
+                    elastic_energy += contact->project_wi_SiT_AiT_Bi_pi(q, b);
+                }
+                for (auto const& constraint : transient_constraints_)
+                {
+                    elastic_energy += constraint->project_wi_SiT_AiT_Bi_pi(q, b);
+                }
+            }
+            else
             {
-                constraint->project_wi_SiT_AiT_Bi_pi(q, b);
+                q_local = q.template cast<LocalScalar>();
+                b_local.setZero();
+                LocalScalar local_elastic_energy = project_constraints(pool, q_local, b_local);
+                for (auto const& contact : contacts_)
+                {
+                    local_elastic_energy += contact->project_wi_SiT_AiT_Bi_pi(q_local, b_local);
+                }
+                for (auto const& constraint : transient_constraints_)
+                {
+                    local_elastic_energy += constraint->project_wi_SiT_AiT_Bi_pi(q_local, b_local);
+                }
+                b              = b_local.template cast<scalar_type>();
+                elastic_energy = static_cast<scalar_type>(local_elastic_energy);
             }
             b += masses;
+            if (is_sleeping_active_)
+            {
+                b += b_sleeping_;
+                elastic_energy += sleeping_energy_;
+            }
+            if (has_constant_energy)
+                elastic_energy += constant_projection_energy(q);
+
+            scalar_type inertial_energy{0.};
+            for (auto i = 0; i < mass.rows(); ++i)
+                inertial_energy +=
+                    mass(i) * (q.block(3 * i, 0, 3, 1) - sn.block(3 * i, 0, 3, 1)).squaredNorm();
+            inertial_energy *= scalar_type{0.5} * dt2_inv;
+
+            scalar_type const energy = inertial_energy + elastic_energy;
+            if (energy_tolerance_ > scalar_type{0.} && !energy_history_.empty())
+            {
+                scalar_type const previous_energy = energy_history_.back();
+                if (previous_energy - energy <= energy_tolerance_ * std::abs(previous_energy))
+                {
+                    energy_history_.push_back(energy);
+                    break;
+                }
+            }
+            energy_history_.push_back(energy);
 
             // Ax = b
-            q = cholesky_decomposition_.solve(b);
+            if (is_chebyshev)
+            {
+                q_hat = q;
+                global_solver_iterations_ +=
+                    low_rank_update_.solve(*linear_solver_, b, q_hat, convergence_criteria_);
+
+                // an increased objective means the extrapolation overshot,
+                // restart the acceleration from the current iterate
+                auto const size = energy_history_.size();
+                if (size >= 2u && energy_history_[size - 1u] > energy_history_[size - 2u])
+                    chebyshev_k = 0;
+
+                auto const& acceleration = chebyshev_acceleration_;
+                omega                    = acceleration.omega(chebyshev_k, omega);
+                if (chebyshev_k == 0)
+                    q_previous = q;
+                ++chebyshev_k;
+                Eigen::VectorXd q_next =
+                    omega * (acceleration.gamma * (q_hat - q) + q - q_previous) + q_previous;
+                q_previous = std::move(q);
+                q          = std::move(q_next);
+            }
+            else
+            {
+                global_solver_iterations_ +=
+                    low_rank_update_.solve(*linear_solver_, b, q, convergence_criteria_);
+            }
+            ++iterations_;
         }
+    }
 
-        Eigen::MatrixXd const qn_plus_1 = detail::unflatten(q);
-        velocities                      = (qn_plus_1 - positions) * dt_inv;
-        positions                       = qn_plus_1;
+    /**
+     * Separates the constraints projected in the local step from the constraints whose
+     * projection is constant, see constraint_t::is_projection_constant(). Projecting
+     * those at q = 0 adds their constant right hand side term, which is summed here,
+     * once, and step() adds it to the inertial term. It also returns their objective
+     * term at q = 0, the offset of their objective term, the quadratic form
+     * 1/2 * q^T * L * q - q^T * b_constant + offset of their system matrix term L, see
+     * constant_projection_energy().
+     */
+    void build_local_constraints()
+    {
+        auto const& constraints = model_->constraints();
+        auto const& positions   = model_->positions();
+        auto const& mass        = model_->mass();
+        auto const n            = 3 * positions.rows();
+
+        local_constraints_.clear();
+        local_constraints_.reserve(constraints.size());
+        b_constant_.setZero(n);
+        constant_energy_offset_ = scalar_type{0.};
+        Eigen::VectorXd const q_zero = Eigen::VectorXd::Zero(n);
+        std::vector<Eigen::Triplet<scalar_type>> triplets;
+        for (std::size_t c = 0u; c < constraints.size(); ++c)
+        {
+            auto const& constraint = *constraints[c];
+            if (!constraint.is_projection_constant())
+            {
+                local_constraints_.push_back(c);
+                continue;
+            }
+
+            constant_energy_offset_ += constraint.project_wi_SiT_AiT_Bi_pi(q_zero, b_constant_);
+            auto const SiT_AiT_Ai_Si = constraint.get_wi_SiT_AiT_Ai_Si(positions, mass);
+            triplets.insert(triplets.end(), SiT_AiT_Ai_Si.begin(), SiT_AiT_Ai_Si.end());
+        }
+
+        constant_energy_matrix_.resize(triplets.empty() ? 0 : n, triplets.empty() ? 0 : n);
+        constant_energy_matrix_.setFromTriplets(triplets.begin(), triplets.end());
+        if (triplets.empty())
+            b_constant_.resize(0);
     }
 
-  private:
+    /**
+     * The objective term of the constraints with constant projections at q
+     */
+    scalar_type constant_projection_energy(Eigen::VectorXd const& q) const
+    {
+        return scalar_type{0.5} * q.dot(constant_energy_matrix_ * q) - q.dot(b_constant_) +
+               constant_energy_offset_;
+    }
+
+    /**
+     * Splits the items of the local step, the local constraints or, with sleeping
+     * active, the shards, into one chunk per thread of the pool, like
+     * thread_pool_t::for_each_chunk() does, and records the rows of b each chunk
+     * touches. Constraints are sorted by locality, so the chunks' rows overlap little.
+     */
+    void build_chunks(thread_pool_t const& pool)
+    {
+        auto const& constraints = model_->constraints();
+        auto const count        = static_cast<std::ptrdiff_t>(
+            is_sleeping_active_ ? shards_.size() : local_constraints_.size());
+        auto const chunk_count =
+            std::min(static_cast<std::ptrdiff_t>(pool.concurrency()), count);
+
+        auto const rows_of = [&](std::size_t c, Eigen::Index& first, Eigen::Index& last) {
+            for (auto const vi : constraints[c]->indices())
+            {
+                first = std::min(first, 3 * static_cast<Eigen::Index>(vi));
+                last  = std::max(last, 3 * static_cast<Eigen::Index>(vi) + 3);
+            }
+        };
+        chunk_rows_.assign(static_cast<std::size_t>(chunk_count), {0, 0});
+        for (std::ptrdiff_t chunk = 0; chunk < chunk_count; ++chunk)
+        {
+            auto const first_item = thread_pool_t::chunk_bound(count, chunk_count, chunk);
+            auto const last_item  = thread_pool_t::chunk_bound(count, chunk_count, chunk + 1);
+            Eigen::Index first    = 3 * model_->positions().rows();
+            Eigen::Index last     = 0;
+            for (std::ptrdiff_t i = first_item; i < last_item; ++i)
+            {
+                auto const item = static_cast<std::size_t>(i);
+                if (!is_sleeping_active_)
+                {
+                    rows_of(local_constraints_[item], first, last);
+                    continue;
+                }
+                for (auto const c : shards_[item])
+                    rows_of(c, first, last);
+            }
+            if (first < last)
+                chunk_rows_[static_cast<std::size_t>(chunk)] = {first, last};
+        }
+
+        // the first chunk projects directly into b
+        auto const buffer_count = std::max(chunk_count - 1, std::ptrdiff_t{0});
+        b_chunks_.resize(static_cast<std::size_t>(buffer_count));
+        for (auto& b_chunk : b_chunks_)
+            b_chunk.resize(3 * model_->positions().rows());
+        b_chunks_float_.clear();
+        chunk_energy_.assign(static_cast<std::size_t>(chunk_count), scalar_type{0.});
+    }
+
+    /**
+     * Accumulation vectors of the chunks but the first, for the precision of the
+     * local step
+     */
+    template <class BVector>
+    std::vector<BVector>& chunk_buffers()
+    {
+        if constexpr (std::is_same_v<typename BVector::Scalar, float>)
+        {
+            if (b_chunks_float_.size() != b_chunks_.size())
+            {
+                b_chunks_float_.assign(
+                    b_chunks_.size(),
+                    Eigen::VectorXf(3 * model_->positions().rows()));
+            }
+            return b_chunks_float_;
+        }
+        else
+        {
+            return b_chunks_;
+        }
+    }
+
+    /**
+     * Adds the projections of the local constraints to b and returns their energy,
+     * skipping the shards of sleeping regions. Constraints scatter into shared entries
+     * of b, so every chunk of constraints but the first accumulates into its own
+     * vector, of which only the chunk's rows are zeroed and added to b. The sums run in
+     * parallel over rows of b and in chunk order within each row.
+     */
+    template <class QVector, class BVector>
+    typename BVector::Scalar project_constraints(thread_pool_t& pool, QVector const& q, BVector& b)
+    {
+        using local_scalar_type = typename BVector::Scalar;
+
+        auto const& constraints = model_->constraints();
+        auto const count        = static_cast<std::ptrdiff_t>(
+            is_sleeping_active_ ? shards_.size() : local_constraints_.size());
+        auto const chunk_count =
+            std::min(static_cast<std::ptrdiff_t>(pool.concurrency()), count);
+
+        // the pool or the sleeping mode changed since prepare()
+        auto const built_chunk_count = static_cast<std::ptrdiff_t>(chunk_rows_.size());
+        if (built_chunk_count != std::max(chunk_count, std::ptrdiff_t{0}))
+            build_chunks(pool);
+
+        auto& b_chunks           = chunk_buffers<BVector>();
+        auto const project_chunk =
+            [&](std::ptrdiff_t chunk, std::ptrdiff_t first, std::ptrdiff_t last) {
+                auto const k     = static_cast<std::size_t>(chunk);
+                BVector& b_chunk = chunk == 0 ? b : b_chunks[k - 1u];
+                if (chunk > 0)
+                {
+                    auto const [row_begin, row_end] = chunk_rows_[k];
+                    b_chunk.segment(row_begin, row_end - row_begin).setZero();
+                }
+
+                local_scalar_type energy{0.};
+                for (std::ptrdiff_t i = first; i < last; ++i)
+                {
+                    if (!is_sleeping_active_)
+                    {
+                        auto const c = local_constraints_[static_cast<std::size_t>(i)];
+                        energy += constraints[c]->project_wi_SiT_AiT_Bi_pi(q, b_chunk);
+                        continue;
+                    }
+
+                    auto const s = static_cast<std::size_t>(i);
+                    if (is_shard_asleep_[s])
+                        continue;
+
+                    local_scalar_type shard_energy{0.};
+                    for (auto const c : shards_[s])
+                        shard_energy += constraints[c]->project_wi_SiT_AiT_Bi_pi(q, b_chunk);
+                    shard_energy_[s] = static_cast<scalar_type>(shard_energy);
+                    energy += shard_energy;
+                }
+                chunk_energy_[k] = static_cast<scalar_type>(energy);
+            };
+        pool.for_each_chunk(0, count, chunk_count, project_chunk);
+
+        if (chunk_count > 1)
+        {
+            auto const add_chunks =
+                [&](std::ptrdiff_t, std::ptrdiff_t first_row, std::ptrdiff_t last_row) {
+                    for (std::ptrdiff_t chunk = 1; chunk < chunk_count; ++chunk)
+                    {
+                        auto const [row_begin, row_end] =
+                            chunk_rows_[static_cast<std::size_t>(chunk)];
+                        auto const begin = std::max<Eigen::Index>(first_row, row_begin);
+                        auto const end   = std::min<Eigen::Index>(last_row, row_end);
+                        if (begin < end)
+                        {
+                            b.segment(begin, end - begin) +=
+                                b_chunks[static_cast<std::size_t>(chunk - 1)].segment(
+                                    begin,
+                                    end - begin);
+                        }
+                    }
+                };
+            pool.for_each_chunk(0, b.rows(), pool.default_chunk_count(), add_chunks);
+        }
+
+        local_scalar_type energy{0.};
+        for (auto const chunk_energy : chunk_energy_)
+            energy += static_cast<local_scalar_type>(chunk_energy);
+        return energy;
+    }
+
+    std::size_t region_of(Eigen::Index vi) const
+    {
+        return static_cast<std::size_t>(vi) / sleeping_criteria_.region_size;
+    }
+
+    /**
+     * Splits the vertices into regions and the local constraints into their shards,
+     * with every region awake
+     */
+    void build_shards()
+    {
+        auto const& constraints        = model_->constraints();
+        auto const N                   = model_->positions().rows();
+        sleeping_criteria_.region_size = std::max(sleeping_criteria_.region_size, std::size_t{1u});
+        auto const region_count        = region_of(N + sleeping_criteria_.region_size - 1u);
+
+        shards_.assign(region_count, {});
+        shard_regions_.assign(region_count, {});
+        for (auto const c : local_constraints_)
+        {
+            auto const& indices = constraints[c]->indices();
+            if (indices.empty())
+                continue;
+
+            auto const s = region_of(*std::min_element(indices.begin(), indices.end()));
+            shards_[s].push_back(c);
+            for (auto const vi : indices)
+                shard_regions_[s].push_back(region_of(vi));
+        }
+        for (auto& regions : shard_regions_)
+        {
+            std::sort(regions.begin(), regions.end());
+            regions.erase(std::unique(regions.begin(), regions.end()), regions.end());
+        }
+
+        is_region_asleep_.assign(region_count, false);
+        quiet_steps_.assign(region_count, 0);
+        is_shard_asleep_.assign(region_count, false);
+        shard_energy_.assign(region_count, scalar_type{0.});
+        previous_shard_energy_.assign(region_count, scalar_type{0.});
+        was_in_contact_.assign(static_cast<std::size_t>(N), false);
+        previous_fext_    = Eigen::MatrixXd::Zero(N, 3);
+        b_sleeping_       = Eigen::VectorXd::Zero(3 * N);
+        sleeping_energy_  = scalar_type{0.};
+        are_shards_dirty_ = false;
+    }
+
+    void wake_region(std::size_t r)
+    {
+        quiet_steps_[r] = 0;
+        if (!is_region_asleep_[r])
+            return;
+
+        is_region_asleep_[r] = false;
+        are_shards_dirty_    = true;
+    }
+
+    /**
+     * Wakes the regions whose external forces changed or which got new contacts or
+     * transient constraints, and caches the contribution of the sleeping shards
+     */
+    void wake_regions(Eigen::MatrixXd const& fext)
+    {
+        auto const N = model_->positions().rows();
+        for (auto i = 0; i < N; ++i)
+        {
+            if (fext.row(i) != previous_fext_.row(i))
+                wake_region(region_of(i));
+        }
+        previous_fext_ = fext;
+
+        std::vector<bool> is_in_contact(static_cast<std::size_t>(N), false);
+        for (auto const& contact : contacts_)
+        {
+            for (auto const vi : contact->indices())
+            {
+                is_in_contact[vi] = true;
+                if (!was_in_contact_[vi])
+                    wake_region(region_of(vi));
+            }
+        }
+        was_in_contact_ = std::move(is_in_contact);
+
+        for (auto const& constraint : transient_constraints_)
+            for (auto const vi : constraint->indices())
+                wake_region(region_of(vi));
+
+        if (!are_shards_dirty_)
+            return;
+
+        // sleeping vertices keep their positions, so the projections of the sleeping
+        // shards are constant until one of their regions wakes up
+        Eigen::VectorXd const q = detail::flatten(model_->positions());
+        auto const& constraints = model_->constraints();
+        b_sleeping_.setZero();
+        sleeping_energy_ = scalar_type{0.};
+        for (std::size_t s = 0u; s < shards_.size(); ++s)
+        {
+            auto const& regions = shard_regions_[s];
+            is_shard_asleep_[s] =
+                !regions.empty() && std::all_of(regions.begin(), regions.end(), [&](auto r) {
+                    return is_region_asleep_[r];
+                });
+            if (!is_shard_asleep_[s])
+                continue;
+
+            for (auto const c : shards_[s])
+                sleeping_energy_ += constraints[c]->project_wi_SiT_AiT_Bi_pi(q, b_sleeping_);
+        }
+        are_shards_dirty_ = false;
+    }
+
+    /**
+     * Puts regions at rest to sleep and wakes sleeping regions which the global solve
+     * moved, given the new positions q. Sleeping vertices are reset to their positions.
+     */
+    void update_sleeping_regions(Eigen::VectorXd& q)
+    {
+        auto const& positions = model_->positions();
+        auto const& mass      = model_->mass();
+        auto const N          = positions.rows();
+        auto const& criteria  = sleeping_criteria_;
+        auto const max_step   = criteria.velocity * dt_;
+
+        for (std::size_t r = 0u; r < is_region_asleep_.size(); ++r)
+        {
+            auto const begin = static_cast<Eigen::Index>(r * criteria.region_size);
+            auto const end   = std::min(begin + static_cast<Eigen::Index>(criteria.region_size), N);
+
+            scalar_type max_displacement{0.};
+            scalar_type region_mass{0.};
+            for (auto i = begin; i < end; ++i)
+            {
+                max_displacement = std::max(
+                    max_displacement,
+                    (q.segment<3>(3 * i) - positions.row(i).transpose()).norm());
+                if (!model_->is_fixed(static_cast<int>(i)))
+                    region_mass += mass(i);
+            }
+
+            bool const is_at_rest = max_displacement <= max_step;
+            if (is_region_asleep_[r] && !is_at_rest)
+            {
+                wake_region(r);
+                continue;
+            }
+
+            if (!is_region_asleep_[r])
+            {
+                auto const energy          = shard_energy_[r];
+                auto const previous_energy = previous_shard_energy_[r];
+                auto const max_energy      = std::max(std::abs(energy), std::abs(previous_energy));
+                previous_shard_energy_[r]  = energy;
+
+                // energy changes below the kinetic energy of the region at rest are noise
+                auto const rest_energy =
+                    scalar_type{0.5} * region_mass * criteria.velocity * criteria.velocity;
+                auto const tolerance = criteria.energy_tolerance * max_energy + rest_energy;
+
+                bool const is_energy_constant = std::abs(energy - previous_energy) <= tolerance;
+
+                quiet_steps_[r] = is_at_rest && is_energy_constant ? quiet_steps_[r] + 1 : 0;
+                if (quiet_steps_[r] < criteria.step_count)
+                    continue;
+
+                is_region_asleep_[r] = true;
+                are_shards_dirty_    = true;
+            }
+
+            for (auto i = begin; i < end; ++i)
+                q.segment<3>(3 * i) = positions.row(i).transpose();
+        }
+    }
+
+    /**
+     * Reads the factorization of A from the factorization directory, or computes it and
+     * stores it there
+     */
+    void factorize_with_directory(sparse_matrix_type const& A, cholesky_solver_t& cholesky_solver)
+    {
+        matrix_key_t const key = get_matrix_key(A);
+        std::ostringstream name;
+        name << std::hex << std::setw(16) << std::setfill('0') << key.hash << ".pdfactor";
+        std::string const filename =
+            (std::filesystem::path(factorization_directory_) / name.str()).string();
+
+        ldlt_factor_t factor{};
+        if (load_factorization(filename, key, factor))
+        {
+            cholesky_solver.set_factor(std::move(factor));
+            return;
+        }
+
+        cholesky_solver.compute(A);
+        if (cholesky_solver.cholesky().info() == Eigen::Success)
+            save_factorization(filename, key, cholesky_solver.factor());
+    }
+
+    struct factorization_cache_entry_t
+    {
+        scalar_type dt;
+        std::size_t hash;
+        detail::system_size_t size; ///< Compared exactly, guards against hash collisions
+        global_solver_t global_solver;
+        std::unique_ptr<linear_solver_t> linear_solver;
+        bool is_stale = false; ///< Awaits its factorization, see update_topology()
+    };
+
+    struct refactorization_t
+    {
+        scalar_type dt;
+        std::size_t hash;
+        std::future<std::unique_ptr<linear_solver_t>> factorization;
+    };
+
     deformable_mesh_t* model_;
     bool dirty_;
-    Eigen::SimplicialCholesky<Eigen::SparseMatrix<scalar_type>> cholesky_decomposition_;
-    Eigen::MatrixXd A_;
-    scalar_type dt_;
+    linear_solver_t* linear_solver_ = nullptr; ///< Linear solver of the active cache entry
+    std::list<factorization_cache_entry_t> factorization_cache_{}; ///< Most recently used first
+    std::list<refactorization_t> refactorizations_{}; ///< Factorizations computed in background
+    std::size_t factorization_cache_capacity_ = 4u;
+    std::size_t system_hash_                  = 0u; ///< Hash of the system K_ was assembled for
+    std::string factorization_directory_ =
+        factorization_directory_from_environment(); ///< Factorizations shared across runs
+    sparse_matrix_type K_;                          ///< sum wi * (Ai*Si)^T * (Ai*Si)
+    scalar_type dt_ = scalar_type{0.};
+    collision_detector_t* collision_detector_ = nullptr;
+    deformable_mesh_t::constraints_type contacts_{}; ///< Contacts of the current step
+    deformable_mesh_t::constraints_type transient_constraints_{};
+    low_rank_update_t low_rank_update_{}; ///< Update of the transient constraints
+    linear_solver_t const* low_rank_solver_ = nullptr; ///< Linear solver low_rank_update_ updates
+    std::size_t low_rank_hash_              = 0u; ///< Hash of the transient constraints it holds
+    bool is_mixed_precision_ = false;
+    std::vector<scalar_type> energy_history_{}; ///< Objective of each iterate of the last step
+    int iterations_                = 0;          ///< Iterations performed by the last step
+    scalar_type energy_tolerance_  = scalar_type{0.};
+    global_solver_t global_solver_ = global_solver_t::cholesky;
+    convergence_criteria_t convergence_criteria_{};
+    int global_solver_iterations_ = 0; ///< Linear solver iterations of the last step
+    int subdomain_count_          = 8;
+    int subdomain_overlap_        = 1;
+    chebyshev_acceleration_t chebyshev_acceleration_{};
+    bool is_sleeping_active_ = false;
+    sleeping_criteria_t sleeping_criteria_{};
+    std::vector<std::vector<std::size_t>> shards_{};        ///< Constraints of each region
+    std::vector<std::vector<std::size_t>> shard_regions_{}; ///< Regions each shard touches
+    std::vector<bool> is_region_asleep_{};
+    std::vector<int> quiet_steps_{}; ///< Consecutive steps each region was at rest
+    std::vector<bool> is_shard_asleep_{};
+    std::vector<scalar_type> shard_energy_{};          ///< Energy of each shard at the last iterate
+    std::vector<scalar_type> previous_shard_energy_{}; ///< Energy of each shard in the last step
+    std::vector<bool> was_in_contact_{};               ///< Vertices in contact in the last step
+    Eigen::MatrixXd previous_fext_{};                  ///< External forces of the last step
+    Eigen::VectorXd b_sleeping_{};                     ///< Projections of the sleeping shards
+    scalar_type sleeping_energy_ = scalar_type{0.};    ///< Energy of the sleeping shards
+    bool are_shards_dirty_       = false;              ///< Sleeping regions changed
+    std::vector<std::pair<Eigen::Index, Eigen::Index>> chunk_rows_{}; ///< Rows of b per chunk
+    std::vector<Eigen::VectorXd> b_chunks_{};       ///< Projections of the chunks but the first
+    std::vector<Eigen::VectorXf> b_chunks_float_{}; ///< b_chunks_ of the float local step
+    std::vector<scalar_type> chunk_energy_{};       ///< Energy of each chunk at the last iterate
+    std::vector<std::size_t> local_constraints_{};  ///< Model constraints of the local step
+    Eigen::VectorXd b_constant_{};                  ///< Right hand side of constant projections
+    sparse_matrix_type constant_energy_matrix_{};   ///< System matrix term of constant projections
+    scalar_type constant_energy_offset_ = scalar_type{0.}; ///< Their objective term at q = 0
+    bool is_energy_monitored_           = false;
 };
 
 } // namespace pd
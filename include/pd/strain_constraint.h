@@ -1,15 +1,56 @@
 #ifndef PD_PD_STRAIN_CONSTRAINT_H
 #define PD_PD_STRAIN_CONSTRAINT_H
 
-#include "constraint.h"
+#include "tet_constraint.h"
+
+#include <algorithm>
 
 namespace pd {
 
-class strain_constraint_t : public constraint_t
+/**
+ * Projects F onto U * Fhat * V^T, where Fhat holds the singular values
+ * of F clamped to [sigma_min, sigma_max].
+ */
+struct strain_limit_projection_t
+{
+    double sigma_min = 1.;
+    double sigma_max = 1.;
+
+    template <class Scalar>
+    Eigen::Matrix<Scalar, 3, 3> project(Eigen::Matrix<Scalar, 3, 3> const& F) const
+    {
+        using vector3_type = Eigen::Matrix<Scalar, 3, 1>;
+        using matrix3_type = Eigen::Matrix<Scalar, 3, 3>;
+
+        bool const is_tet_inverted = F.determinant() < Scalar{0.};
+
+        Eigen::JacobiSVD<matrix3_type> SVD(F, Eigen::ComputeFullU | Eigen::ComputeFullV);
+        matrix3_type const& U = SVD.matrixU();
+        matrix3_type const& V = SVD.matrixV();
+
+        Scalar const min = static_cast<Scalar>(sigma_min);
+        Scalar const max = static_cast<Scalar>(sigma_max);
+
+        vector3_type sigma = SVD.singularValues();
+
+        sigma(0) = std::clamp(sigma(0), min, max);
+        sigma(1) = std::clamp(sigma(1), min, max);
+        sigma(2) = std::clamp(sigma(2), min, max);
+
+        if (is_tet_inverted)
+        {
+            sigma(2) = -sigma(2);
+        }
+
+        return U * sigma.asDiagonal() * V.transpose();
+    }
+};
+
+class strain_constraint_t : public tet_constraint_t<strain_limit_projection_t>
 {
   public:
     using self_type          = strain_constraint_t;
-    using base_type          = constraint_t;
+    using base_type          = tet_constraint_t<strain_limit_projection_t>;
     using index_type         = std::uint32_t;
     using scalar_type        = double;
     using masses_type        = Eigen::VectorXd;
@@ -26,18 +67,29 @@ class strain_constraint_t : public constraint_t
         scalar_type sigma_min,
         scalar_type sigma_max);
 
-    virtual void project_wi_SiT_AiT_Bi_pi(q_type const& q, Eigen::VectorXd& b) const override;
+    /**
+     * Restores a constraint from its stored state, see snapshot.h
+     */
+    strain_constraint_t(
+        std::vector<index_type> indices,
+        scalar_type wi,
+        packed_tet_t const& packed,
+        scalar_type sigma_min,
+        scalar_type sigma_max);
+
+    virtual std::unique_ptr<constraint_t> clone() const override
+    {
+        return std::make_unique<self_type>(*this);
+    }
+
+    virtual constraint_type_t type() const override { return constraint_type_t::strain; }
 
-    virtual std::vector<Eigen::Triplet<scalar_type>>
-    get_wi_SiT_AiT_Ai_Si(positions_type const& p, masses_type const& M) const override;
+    virtual scalar_type evaluate(positions_type const& p, masses_type const& M) const override;
 
-  private:
-    scalar_type V0_;
-    Eigen::Matrix3d DmInv_;
-    scalar_type sigma_min_;
-    scalar_type sigma_max_;
+    scalar_type sigma_min() const { return policy().sigma_min; }
+    scalar_type sigma_max() const { return policy().sigma_max; }
 };
 
 } // namespace pd
 
-#endif // PD_PD_STRAIN_CONSTRAINT_H
\ No newline at end of file
+#endif // PD_PD_STRAIN_CONSTRAINT_H
@@ -0,0 +1,157 @@
+#ifndef PD_PD_SUBSPACE_SOLVER_H
+#define PD_PD_SUBSPACE_SOLVER_H
+
+#include "deformable_mesh.h"
+
+#include <Eigen/Cholesky>
+#include <Eigen/Core>
+#include <Eigen/SparseCore>
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+namespace pd {
+
+/**
+ * Projective dynamics restricted to a linear subspace q = U * z of the positions,
+ * after Brandt et al., "Hyper-Reduced Projective Dynamics" (2018), for meshes too
+ * large to step in full. The global step solves the dense r x r system
+ *
+ *     (U^T * M * U / dt^2 + U^T * K * U) * z
+ *         = U^T * (M / dt^2 * sn + sum wi * SiT_AiT_Bi_pi),
+ *
+ * which is factorized once. The element and edge energies are approximated by a
+ * cubature: a few sample constraints of each constraint type, each weighted by the
+ * number of constraints it stands for. Positional constraints are all kept with weight
+ * 1, since a sample could not stand in for the pins it replaces. Kept constraints are
+ * copied onto private local vertices, whose positions are gathered from z through the
+ * matching rows of U, so the local step only touches the samples and both steps cost
+ * nothing per vertex of the full mesh. The system matrix is reduced with the same
+ * cubature, such that the rest shape remains an equilibrium of the reduced system.
+ * Targets, such as animated shape targets or moved pins, are copied from the model's
+ * constraints to their samples in every step, since they leave the system unchanged.
+ *
+ * By default, U is a linear blend skinning subspace: handles are placed on the mesh
+ * by farthest point sampling, each contributing an affine transformation (12
+ * coordinates of z), blended by compactly supported, normalized radial weights.
+ * Other bases, such as modal bases, can be set directly, as long as the positions
+ * they reproduce include the rest shape. Contacts are not supported in the subspace.
+ * Full positions are only reconstructed by reconstruct(), for rendering or export.
+ */
+class subspace_solver_t
+{
+  public:
+    using scalar_type        = double;
+    using sparse_matrix_type = Eigen::SparseMatrix<scalar_type>;
+    using vector_type        = Eigen::VectorXd;
+    using dense_matrix_type  = Eigen::MatrixXd;
+
+    void set_model(deformable_mesh_t* model)
+    {
+        model_ = model;
+        U_     = sparse_matrix_type{};
+        set_dirty();
+    }
+    deformable_mesh_t const* model() const { return model_; }
+    deformable_mesh_t* model() { return model_; }
+    void set_dirty() { dirty_ = true; }
+    bool ready() const { return !dirty_; }
+    scalar_type dt() const { return dt_; }
+
+    /**
+     * Number of skinning handles of the default subspace, which has dimension
+     * 12 * handle_count
+     */
+    int handle_count() const { return handle_count_; }
+    void set_handle_count(int handle_count)
+    {
+        handle_count_ = handle_count;
+        U_            = sparse_matrix_type{};
+        set_dirty();
+    }
+
+    /**
+     * Sets the 3N x r basis U, replacing the skinning subspace
+     */
+    void set_basis(sparse_matrix_type U)
+    {
+        U_ = std::move(U);
+        set_dirty();
+    }
+    sparse_matrix_type const& basis() const { return U_; }
+    Eigen::Index dimension() const { return U_.cols(); }
+
+    /**
+     * Maximum number of sample constraints of each element or edge constraint type.
+     * Types with fewer constraints, and positional constraints, are kept in full.
+     */
+    int sample_count() const { return sample_count_; }
+    void set_sample_count(int sample_count)
+    {
+        sample_count_ = sample_count;
+        set_dirty();
+    }
+    std::size_t cubature_size() const { return cubature_.size(); }
+
+    /**
+     * Builds the subspace if needed and the cubature of the model's current
+     * constraints, projects the model's positions and velocities onto the subspace,
+     * and factorizes the reduced system matrix
+     */
+    void prepare(scalar_type dt);
+
+    /**
+     * Reduces the external forces U^T * fext, which stay applied to every step until
+     * they are set again. Reducing costs a product with U, so constant forces such as
+     * gravity should be set once.
+     */
+    void set_external_forces(Eigen::MatrixXd const& fext);
+
+    void step(int num_iterations = 10);
+
+    /**
+     * Writes the full positions U * z and velocities U * dz/dt to the model
+     */
+    void reconstruct();
+
+    vector_type const& z() const { return z_; }
+    vector_type const& z_velocity() const { return z_velocity_; }
+
+  private:
+    /**
+     * A sample constraint of the cubature, copied from the model's constraint source
+     * onto local vertices [first_vertex, first_vertex + vertex_count)
+     */
+    struct sample_t
+    {
+        std::unique_ptr<constraint_t> constraint;
+        std::size_t source;
+        scalar_type weight;
+        std::size_t first_vertex;
+        std::size_t vertex_count;
+    };
+
+    void build_skinning_subspace();
+    void build_cubature();
+
+    deformable_mesh_t* model_ = nullptr;
+    bool dirty_               = true;
+    scalar_type dt_           = scalar_type{0.};
+    int handle_count_         = 32;
+    int sample_count_         = 256;
+
+    sparse_matrix_type U_;                      ///< Basis, q = U * z
+    std::vector<sample_t> cubature_;            ///< Sample constraints
+    std::vector<int> local_to_vertex_;          ///< Vertex of each local vertex
+    sparse_matrix_type U_local_;                ///< Rows of U of the local vertices
+    sparse_matrix_type U_local_transpose_;      ///< U_local^T, scatters local forces
+    dense_matrix_type M_reduced_;               ///< U^T * M * U
+    Eigen::LLT<dense_matrix_type> A_reduced_;   ///< Factorized reduced system matrix
+    vector_type z_;                             ///< Reduced positions
+    vector_type z_velocity_;                    ///< Reduced velocities
+    vector_type f_reduced_;                     ///< Reduced external forces
+};
+
+} // namespace pd
+
+#endif // PD_PD_SUBSPACE_SOLVER_H
@@ -0,0 +1,66 @@
+#ifndef PD_PD_SURFACE_BVH_H
+#define PD_PD_SURFACE_BVH_H
+
+#include <Eigen/Core>
+#include <Eigen/Geometry>
+#include <vector>
+
+namespace pd {
+
+/**
+ * Bounding volume hierarchy over the faces of a triangle surface, for ray casts
+ * (picking) against a deforming mesh. build() splits the faces top-down at the
+ * median of their centroids along the longest axis. Since the simulation keeps the
+ * surface's topology, the hierarchy is kept across frames and refit() only recomputes
+ * the boxes bottom-up from the new positions, which is linear in the face count and
+ * parallel over the leaves. Refitted hierarchies lose some tightness as the mesh
+ * deforms, build() starts over from the current positions.
+ */
+class surface_bvh_t
+{
+  public:
+    using scalar_type = double;
+    using box_type    = Eigen::AlignedBox<scalar_type, 3>;
+
+    struct ray_hit_t
+    {
+        int face      = -1;              ///< Hit face, -1 if the ray missed
+        scalar_type t = scalar_type{0.}; ///< Ray parameter of the hit
+        Eigen::Vector3d barycentric{};   ///< Barycentric coordinates of the hit in the face
+    };
+
+    void build(Eigen::MatrixXd const& V, Eigen::MatrixXi const& F);
+    void refit(Eigen::MatrixXd const& V);
+
+    /**
+     * Closest intersection of the ray origin + t * direction, t >= 0, with the surface
+     * at positions V, which the hierarchy must have been built or refit for
+     */
+    ray_hit_t intersect(
+        Eigen::MatrixXd const& V,
+        Eigen::Vector3d const& origin,
+        Eigen::Vector3d const& direction) const;
+
+    bool empty() const { return nodes_.empty(); }
+    Eigen::Index face_count() const { return F_.rows(); }
+    std::size_t node_count() const { return nodes_.size(); }
+
+  private:
+    struct node_t
+    {
+        box_type box;
+        int first; ///< First child of inner nodes (the second is first + 1), first face of leaves
+        int count; ///< Number of faces of leaves, 0 for inner nodes
+    };
+
+    box_type face_box(Eigen::MatrixXd const& V, int f) const;
+
+    Eigen::MatrixXi F_;
+    std::vector<node_t> nodes_; ///< Root first, children are stored after their parent
+    std::vector<int> faces_;    ///< Faces ordered by leaf
+    int max_leaf_face_count_ = 4;
+};
+
+} // namespace pd
+
+#endif // PD_PD_SURFACE_BVH_H
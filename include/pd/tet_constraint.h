@@ -0,0 +1,256 @@
+#ifndef PD_PD_TET_CONSTRAINT_H
+#define PD_PD_TET_CONSTRAINT_H
+
+#include "constraint.h"
+#include "material.h"
+
+#include <Eigen/Dense>
+#include <Eigen/SVD>
+#include <array>
+#include <cassert>
+
+namespace pd {
+
+/**
+ * Projects F onto its closest proper rotation R. This is the projection
+ * of both the deformation gradient and the corotated deformation gradient constraints.
+ */
+struct rotation_projection_t
+{
+    template <class Scalar>
+    Eigen::Matrix<Scalar, 3, 3> project(Eigen::Matrix<Scalar, 3, 3> const& F) const
+    {
+        using matrix3_type = Eigen::Matrix<Scalar, 3, 3>;
+
+        Eigen::JacobiSVD<matrix3_type> SVD(F, Eigen::ComputeFullU | Eigen::ComputeFullV);
+        matrix3_type R = SVD.matrixU() * SVD.matrixV().transpose();
+        if (R.determinant() < Scalar{0.})
+        {
+            R.col(2) = -R.col(2);
+        }
+        return R;
+    }
+};
+
+/**
+ * Per-tetrahedron data of the local step, precomputed at construction and packed
+ * contiguously, such that projecting a tetrahedron is a gather of its 4 vertices,
+ * a 3x3 kernel and a scatter. With D = [DmInv; -(sum of the rows of DmInv)], the
+ * gradient operator is G = D^T, and F = X * G^T for the 3x4 matrix X of vertex positions.
+ */
+struct alignas(32) packed_tet_t
+{
+    using scalar_type = double;
+
+    std::array<std::uint32_t, 4u> offsets; ///< Offsets 3*vi of the vertices in q and b
+    scalar_type V0;                         ///< Signed rest volume
+    scalar_type weight;                     ///< wi * |V0|
+    Eigen::Matrix<scalar_type, 3, 4> G;     ///< Gradient operator
+};
+
+/**
+ * Constraint on the deformation gradient F = Ds * DmInv of a tetrahedron.
+ *
+ * Ai*Si only depends on the rest shape of the tetrahedron, so the right hand side
+ * contribution wi * (Ai*Si)^T * Bi * pi and the system matrix contribution
+ * wi * (Ai*Si)^T * (Ai*Si) are the same for every tetrahedral constraint. Only the
+ * projection pi of F differs, and it is supplied by ProjectionPolicy, which must
+ * provide
+ *
+ *     template <class Scalar>
+ *     Eigen::Matrix<Scalar, 3, 3> project(Eigen::Matrix<Scalar, 3, 3> const& F) const;
+ *
+ * The policy is resolved at compile time, such that the local step of a
+ * constraint type is a single kernel with the projection inlined. The Lamé parameters
+ * of the tetrahedron's material are only used to evaluate its elastic energy.
+ */
+template <class ProjectionPolicy>
+class tet_constraint_t : public constraint_t
+{
+  public:
+    using self_type          = tet_constraint_t<ProjectionPolicy>;
+    using base_type          = constraint_t;
+    using policy_type        = ProjectionPolicy;
+    using index_type         = std::uint32_t;
+    using scalar_type        = double;
+    using masses_type        = Eigen::VectorXd;
+    using positions_type     = typename base_type::positions_type;
+    using q_type             = typename base_type::q_type;
+    using q_float_type       = typename base_type::q_float_type;
+    using gradient_type      = typename base_type::gradient_type;
+    using sparse_matrix_type = Eigen::SparseMatrix<scalar_type>;
+
+  public:
+    tet_constraint_t(
+        std::initializer_list<index_type> indices,
+        scalar_type wi,
+        positions_type const& p,
+        policy_type const& policy     = policy_type{},
+        lame_parameters_t const& lame = lame_parameters_t{})
+        : base_type(indices, wi), packed_{}, policy_(policy), lame_(lame)
+    {
+        assert(indices.size() == 4u);
+
+        Eigen::Matrix3d const Dm    = deformed_shape(p);
+        Eigen::Matrix3d const DmInv = Dm.inverse();
+
+        for (std::size_t a = 0u; a < 4u; ++a)
+            packed_.offsets[a] = 3u * this->indices()[a];
+
+        packed_.V0              = (1. / 6.) * Dm.determinant();
+        packed_.weight          = wi * std::abs(packed_.V0);
+        packed_.G.leftCols<3>() = DmInv.transpose();
+        packed_.G.col(3)        = -DmInv.transpose().rowwise().sum();
+    }
+
+    /**
+     * Restores a constraint from its stored state, see snapshot.h
+     */
+    tet_constraint_t(
+        std::vector<index_type> indices,
+        scalar_type wi,
+        packed_tet_t const& packed,
+        policy_type const& policy,
+        lame_parameters_t const& lame = lame_parameters_t{})
+        : base_type(std::move(indices), wi), packed_(packed), policy_(policy), lame_(lame)
+    {
+        assert(this->indices().size() == 4u);
+    }
+
+    virtual scalar_type
+    project_wi_SiT_AiT_Bi_pi(q_type const& q, Eigen::VectorXd& b) const override final
+    {
+        return project<scalar_type>(q, b);
+    }
+
+    virtual float
+    project_wi_SiT_AiT_Bi_pi(q_float_type const& q, Eigen::VectorXf& b) const override final
+    {
+        return project<float>(q, b);
+    }
+
+    virtual std::vector<Eigen::Triplet<scalar_type>>
+    get_wi_SiT_AiT_Ai_Si(positions_type const& p, masses_type const& M) const override final;
+
+    /**
+     * The system matrix term weight * G^T * G only depends on the packed weight and
+     * gradient operator
+     */
+    virtual std::size_t hash_rest_state() const override final
+    {
+        std::size_t seed = std::hash<scalar_type>{}(packed_.weight);
+        detail::hash_combine_coefficients(seed, packed_.G);
+        return seed;
+    }
+
+    scalar_type V0() const { return packed_.V0; }
+    Eigen::Matrix3d DmInv() const { return packed_.G.leftCols<3>().transpose(); }
+    packed_tet_t const& packed() const { return packed_; }
+    policy_type const& policy() const { return policy_; }
+    policy_type& policy() { return policy_; }
+    lame_parameters_t const& lame_parameters() const { return lame_; }
+
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+  protected:
+    virtual void remap_indices(std::vector<index_type> const& index_map) override
+    {
+        base_type::remap_indices(index_map);
+        for (std::size_t a = 0u; a < 4u; ++a)
+            packed_.offsets[a] = 3u * this->indices()[a];
+    }
+
+    /**
+     * Computes Ds = [p1 - p4, p2 - p4, p3 - p4] from the positions p of the mesh
+     */
+    Eigen::Matrix3d deformed_shape(positions_type const& p) const
+    {
+        auto const v1 = this->indices().at(0);
+        auto const v2 = this->indices().at(1);
+        auto const v3 = this->indices().at(2);
+        auto const v4 = this->indices().at(3);
+
+        Eigen::Matrix3d Ds;
+        Ds.col(0) = (p.row(v1) - p.row(v4)).transpose();
+        Ds.col(1) = (p.row(v2) - p.row(v4)).transpose();
+        Ds.col(2) = (p.row(v3) - p.row(v4)).transpose();
+        return Ds;
+    }
+
+  private:
+    template <class Scalar>
+    Scalar project(
+        Eigen::Matrix<Scalar, Eigen::Dynamic, 1> const& q,
+        Eigen::Matrix<Scalar, Eigen::Dynamic, 1>& b) const;
+
+    packed_tet_t packed_;
+    policy_type policy_;
+    lame_parameters_t lame_; ///< Material of the tetrahedron
+};
+
+template <class ProjectionPolicy>
+template <class Scalar>
+Scalar tet_constraint_t<ProjectionPolicy>::project(
+    Eigen::Matrix<Scalar, Eigen::Dynamic, 1> const& q,
+    Eigen::Matrix<Scalar, Eigen::Dynamic, 1>& b) const
+{
+    using matrix3_type  = Eigen::Matrix<Scalar, 3, 3>;
+    using matrix34_type = Eigen::Matrix<Scalar, 3, 4>;
+
+    auto const& offsets = packed_.offsets;
+
+    // gather the positions of the tetrahedron's vertices
+    matrix34_type X;
+    X.col(0) = q.template block<3, 1>(offsets[0], 0);
+    X.col(1) = q.template block<3, 1>(offsets[1], 0);
+    X.col(2) = q.template block<3, 1>(offsets[2], 0);
+    X.col(3) = q.template block<3, 1>(offsets[3], 0);
+
+    matrix3_type const F = X * packed_.G.template cast<Scalar>().transpose();
+
+    // the goal of PD (i.e. pi) is given by the projection policy
+    matrix3_type const P = policy_.template project<Scalar>(F);
+
+    // We have symbolically computed wi * (Ai*Si)^T * Bi * pi, which is
+    // wi * |V0| * P * G, one column per vertex of the tetrahedron.
+    Scalar const weight   = static_cast<Scalar>(packed_.weight);
+    matrix34_type const B = (weight * P) * packed_.G.template cast<Scalar>();
+
+    b.template block<3, 1>(offsets[0], 0) += B.col(0);
+    b.template block<3, 1>(offsets[1], 0) += B.col(1);
+    b.template block<3, 1>(offsets[2], 0) += B.col(2);
+    b.template block<3, 1>(offsets[3], 0) += B.col(3);
+
+    // wi/2 * |Ai*Si*q - Bi*pi|^2 = wi/2 * |V0| * |F - P|^2
+    return Scalar{0.5} * weight * (F - P).squaredNorm();
+}
+
+template <class ProjectionPolicy>
+std::vector<Eigen::Triplet<typename tet_constraint_t<ProjectionPolicy>::scalar_type>>
+tet_constraint_t<ProjectionPolicy>::get_wi_SiT_AiT_Ai_Si(
+    positions_type const& p,
+    masses_type const& M) const
+{
+    auto const& offsets = packed_.offsets;
+
+    // We symbolically precomputed the product (Ai*Si)^T * (Ai*Si). The 3x3 block
+    // coupling vertices a and c is (D * D^T)(a, c) * I, so we directly compute the
+    // non-zero entries of wi * (Ai*Si)^T * (Ai*Si) without performing sparse matrix products.
+    Eigen::Matrix4d const DDT = packed_.weight * (packed_.G.transpose() * packed_.G);
+
+    std::array<Eigen::Triplet<scalar_type>, 12u * 4u> triplets;
+    std::size_t t = 0u;
+    for (std::size_t a = 0u; a < 4u; ++a)
+        for (std::size_t c = 0u; c < 4u; ++c)
+            for (int d = 0; d < 3; ++d)
+                triplets[t++] = {
+                    static_cast<int>(offsets[a]) + d,
+                    static_cast<int>(offsets[c]) + d,
+                    DDT(a, c)};
+
+    return std::vector<Eigen::Triplet<scalar_type>>{triplets.begin(), triplets.end()};
+}
+
+} // namespace pd
+
+#endif // PD_PD_TET_CONSTRAINT_H
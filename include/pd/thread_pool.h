@@ -0,0 +1,194 @@
+#ifndef PD_PD_THREAD_POOL_H
+#define PD_PD_THREAD_POOL_H
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace pd {
+
+struct thread_pool_options_t
+{
+    int thread_count = 0;     ///< Threads of parallel loops including the caller, 0 for all cores
+    std::vector<int> cores{}; ///< Cores the workers are pinned to round robin, empty to not pin
+
+    /**
+     * Options from the environment: PD_THREAD_COUNT sets the thread count and
+     * PD_THREAD_CORES a comma separated list of cores, such as "4,5,6,7"
+     */
+    static thread_pool_options_t from_environment();
+};
+
+/**
+ * Work stealing scheduler shared by all parallel work of the simulator, such that the
+ * local step, assembly, constraint construction and I/O never oversubscribe the cores
+ * by each running their own threads.
+ *
+ * Parallel loops split their range into chunks, which are pushed onto the deque of
+ * the calling worker, or spread over the workers' deques when called from outside
+ * the pool. Workers pop their own deque from the back and steal from the front of
+ * the others when they run dry. The caller runs chunks too until all of its chunks
+ * are done, so nested loops and loops called from tasks cannot deadlock.
+ *
+ * Tasks submitted by submit(), such as background factorizations and file exports,
+ * wait in a separate queue that only idle workers take from. Callers waiting on their
+ * chunks never pick them up, so a long task never stalls a parallel loop. Without
+ * workers, that is for a thread count of 1, submitted tasks run immediately.
+ */
+class thread_pool_t
+{
+  public:
+    using task_type = std::function<void()>;
+
+    explicit thread_pool_t(thread_pool_options_t options = {});
+
+    /**
+     * Runs the remaining tasks, then joins the workers
+     */
+    ~thread_pool_t();
+
+    thread_pool_t(thread_pool_t const&)            = delete;
+    thread_pool_t& operator=(thread_pool_t const&) = delete;
+
+    thread_pool_options_t const& options() const { return options_; }
+    int worker_count() const { return static_cast<int>(workers_.size()); }
+
+    /**
+     * Number of threads running the chunks of a parallel loop, the workers and the caller
+     */
+    int concurrency() const { return worker_count() + 1; }
+
+    /**
+     * Number of chunks parallel loops split their range into, a few per thread such
+     * that stealing evens out chunks of uneven cost
+     */
+    std::ptrdiff_t default_chunk_count() const { return 4 * concurrency(); }
+
+    /**
+     * First item of chunk c of n items split into chunk_count chunks, n for c = chunk_count
+     */
+    static std::ptrdiff_t
+    chunk_bound(std::ptrdiff_t n, std::ptrdiff_t chunk_count, std::ptrdiff_t c)
+    {
+        return n * c / chunk_count;
+    }
+
+    /**
+     * Splits [begin, end) into at most chunk_count contiguous chunks and calls
+     * f(chunk, first, last) for every chunk [first, last) in parallel. Chunks are
+     * numbered in order, such that per-chunk results can be combined deterministically.
+     */
+    template <class Function>
+    void for_each_chunk(
+        std::ptrdiff_t begin,
+        std::ptrdiff_t end,
+        std::ptrdiff_t chunk_count,
+        Function&& f)
+    {
+        auto const n = end - begin;
+        chunk_count  = std::min(chunk_count, n);
+        if (chunk_count <= 0)
+            return;
+
+        auto const chunk = [&](std::ptrdiff_t c) {
+            auto const first = begin + chunk_bound(n, chunk_count, c);
+            auto const last  = begin + chunk_bound(n, chunk_count, c + 1);
+            f(c, first, last);
+        };
+        if (chunk_count == 1 || workers_.empty())
+        {
+            for (std::ptrdiff_t c = 0; c < chunk_count; ++c)
+                chunk(c);
+            return;
+        }
+        run_chunks(chunk_count, chunk);
+    }
+
+    /**
+     * Calls f(i) for every i in [begin, end) in parallel
+     */
+    template <class Function>
+    void parallel_for(std::ptrdiff_t begin, std::ptrdiff_t end, Function&& f)
+    {
+        for_each_chunk(
+            begin,
+            end,
+            default_chunk_count(),
+            [&](std::ptrdiff_t, std::ptrdiff_t first, std::ptrdiff_t last) {
+                for (std::ptrdiff_t i = first; i < last; ++i)
+                    f(i);
+            });
+    }
+
+    /**
+     * Runs f() on a worker and returns the future of its result
+     */
+    template <class Function>
+    std::future<std::invoke_result_t<std::decay_t<Function>>> submit(Function&& f)
+    {
+        using result_type = std::invoke_result_t<std::decay_t<Function>>;
+
+        auto task =
+            std::make_shared<std::packaged_task<result_type()>>(std::forward<Function>(f));
+        auto future = task->get_future();
+        if (workers_.empty())
+            (*task)();
+        else
+            push_background([task]() { (*task)(); });
+        return future;
+    }
+
+  private:
+    struct worker_t
+    {
+        std::mutex mutex;
+        std::deque<task_type> tasks; ///< Chunks, the owner works from the back
+        std::thread thread;
+    };
+
+    void run_chunks(std::ptrdiff_t chunk_count, std::function<void(std::ptrdiff_t)> const& chunk);
+    void push(task_type task);
+    void push_background(task_type task);
+
+    /**
+     * Pops a chunk of the calling thread's deque, or steals one from another deque
+     */
+    bool try_take_chunk(task_type& task);
+    bool try_take_background(task_type& task);
+    void work(std::size_t worker);
+
+    thread_pool_options_t options_;
+    std::vector<std::unique_ptr<worker_t>> workers_;
+    std::mutex background_mutex_;
+    std::deque<task_type> background_tasks_;
+    std::mutex sleep_mutex_;
+    std::condition_variable wake_;
+    std::atomic<std::size_t> pending_{0u};     ///< Queued chunks and tasks
+    std::atomic<std::size_t> next_worker_{0u}; ///< Deque of the next chunk pushed from outside
+    bool stop_ = false;                        ///< Guarded by sleep_mutex_
+};
+
+/**
+ * The scheduler shared by the whole simulator, created from the environment's options
+ * on first use. Only the first call locks.
+ */
+thread_pool_t& thread_pool();
+
+/**
+ * Replaces the shared scheduler by one with the given options, after running the old
+ * one's remaining tasks. No parallel loop may be running and no worker may call it.
+ */
+void set_thread_pool_options(thread_pool_options_t const& options);
+
+} // namespace pd
+
+#endif // PD_PD_THREAD_POOL_H
@@ -0,0 +1,222 @@
+#ifndef PD_PD_TRIANGLE_CONSTRAINT_H
+#define PD_PD_TRIANGLE_CONSTRAINT_H
+
+#include "constraint.h"
+
+#include <Eigen/Dense>
+#include <array>
+#include <cassert>
+
+namespace pd {
+
+/**
+ * Per-triangle data of the local step, the 2D counterpart of packed_tet_t. The rest
+ * triangle is expressed in an orthonormal basis of its plane, such that Dm is 2x2.
+ * With D = [DmInv; -(sum of the rows of DmInv)], the gradient operator is G = D^T,
+ * and the 3x2 deformation gradient is F = X * G^T for the 3x3 matrix X of vertex
+ * positions.
+ */
+struct alignas(32) packed_triangle_t
+{
+    using scalar_type = double;
+
+    std::array<std::uint32_t, 3u> offsets; ///< Offsets 3*vi of the vertices in q and b
+    scalar_type A0;                         ///< Rest area
+    scalar_type weight;                     ///< wi * A0
+    Eigen::Matrix<scalar_type, 2, 3> G;     ///< Gradient operator
+};
+
+/**
+ * Constraint on the 3x2 deformation gradient F = Ds * DmInv of a triangle, for
+ * membranes such as cloth. As for tet_constraint_t, the system matrix and right hand
+ * side contributions only depend on the rest shape, and the projection pi of F is
+ * supplied by ProjectionPolicy, which must provide
+ *
+ *     template <class Scalar>
+ *     Eigen::Matrix<Scalar, 3, 2> project(Eigen::Matrix<Scalar, 3, 2> const& F) const;
+ */
+template <class ProjectionPolicy>
+class triangle_constraint_t : public constraint_t
+{
+  public:
+    using self_type          = triangle_constraint_t<ProjectionPolicy>;
+    using base_type          = constraint_t;
+    using policy_type        = ProjectionPolicy;
+    using index_type         = std::uint32_t;
+    using scalar_type        = double;
+    using masses_type        = Eigen::VectorXd;
+    using positions_type     = typename base_type::positions_type;
+    using q_type             = typename base_type::q_type;
+    using q_float_type       = typename base_type::q_float_type;
+    using gradient_type      = typename base_type::gradient_type;
+    using sparse_matrix_type = Eigen::SparseMatrix<scalar_type>;
+
+  public:
+    triangle_constraint_t(
+        std::initializer_list<index_type> indices,
+        scalar_type wi,
+        positions_type const& p,
+        policy_type const& policy = policy_type{})
+        : base_type(indices, wi), packed_{}, policy_(policy)
+    {
+        assert(indices.size() == 3u);
+
+        // express the rest triangle in the orthonormal basis (t1, t2) of its plane
+        Eigen::Matrix<scalar_type, 3, 2> const Ds = deformed_shape(p);
+        Eigen::Vector3d const t1                  = Ds.col(0).normalized();
+        Eigen::Vector3d const t2 = (Ds.col(1) - Ds.col(1).dot(t1) * t1).normalized();
+
+        Eigen::Matrix2d Dm;
+        Dm << Ds.col(0).dot(t1), Ds.col(1).dot(t1), scalar_type{0.}, Ds.col(1).dot(t2);
+        Eigen::Matrix2d const DmInv = Dm.inverse();
+
+        for (std::size_t a = 0u; a < 3u; ++a)
+            packed_.offsets[a] = 3u * this->indices()[a];
+
+        packed_.A0              = 0.5 * std::abs(Dm.determinant());
+        packed_.weight          = wi * packed_.A0;
+        packed_.G.leftCols<2>() = DmInv.transpose();
+        packed_.G.col(2)        = -DmInv.transpose().rowwise().sum();
+    }
+
+    /**
+     * Restores a constraint from its stored state, see snapshot.h
+     */
+    triangle_constraint_t(
+        std::vector<index_type> indices,
+        scalar_type wi,
+        packed_triangle_t const& packed,
+        policy_type const& policy)
+        : base_type(std::move(indices), wi), packed_(packed), policy_(policy)
+    {
+        assert(this->indices().size() == 3u);
+    }
+
+    virtual scalar_type
+    project_wi_SiT_AiT_Bi_pi(q_type const& q, Eigen::VectorXd& b) const override final
+    {
+        return project<scalar_type>(q, b);
+    }
+
+    virtual float
+    project_wi_SiT_AiT_Bi_pi(q_float_type const& q, Eigen::VectorXf& b) const override final
+    {
+        return project<float>(q, b);
+    }
+
+    virtual std::vector<Eigen::Triplet<scalar_type>>
+    get_wi_SiT_AiT_Ai_Si(positions_type const& p, masses_type const& M) const override final;
+
+    /**
+     * The system matrix term weight * G^T * G only depends on the packed weight and
+     * gradient operator
+     */
+    virtual std::size_t hash_rest_state() const override final
+    {
+        std::size_t seed = std::hash<scalar_type>{}(packed_.weight);
+        detail::hash_combine_coefficients(seed, packed_.G);
+        return seed;
+    }
+
+    scalar_type A0() const { return packed_.A0; }
+    Eigen::Matrix2d DmInv() const { return packed_.G.leftCols<2>().transpose(); }
+    packed_triangle_t const& packed() const { return packed_; }
+    policy_type const& policy() const { return policy_; }
+    policy_type& policy() { return policy_; }
+
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+  protected:
+    virtual void remap_indices(std::vector<index_type> const& index_map) override
+    {
+        base_type::remap_indices(index_map);
+        for (std::size_t a = 0u; a < 3u; ++a)
+            packed_.offsets[a] = 3u * this->indices()[a];
+    }
+
+    /**
+     * Computes Ds = [p1 - p3, p2 - p3] from the positions p of the mesh
+     */
+    Eigen::Matrix<scalar_type, 3, 2> deformed_shape(positions_type const& p) const
+    {
+        auto const v1 = this->indices().at(0);
+        auto const v2 = this->indices().at(1);
+        auto const v3 = this->indices().at(2);
+
+        Eigen::Matrix<scalar_type, 3, 2> Ds;
+        Ds.col(0) = (p.row(v1) - p.row(v3)).transpose();
+        Ds.col(1) = (p.row(v2) - p.row(v3)).transpose();
+        return Ds;
+    }
+
+  private:
+    template <class Scalar>
+    Scalar project(
+        Eigen::Matrix<Scalar, Eigen::Dynamic, 1> const& q,
+        Eigen::Matrix<Scalar, Eigen::Dynamic, 1>& b) const;
+
+    packed_triangle_t packed_;
+    policy_type policy_;
+};
+
+template <class ProjectionPolicy>
+template <class Scalar>
+Scalar triangle_constraint_t<ProjectionPolicy>::project(
+    Eigen::Matrix<Scalar, Eigen::Dynamic, 1> const& q,
+    Eigen::Matrix<Scalar, Eigen::Dynamic, 1>& b) const
+{
+    using matrix3_type  = Eigen::Matrix<Scalar, 3, 3>;
+    using matrix32_type = Eigen::Matrix<Scalar, 3, 2>;
+
+    auto const& offsets = packed_.offsets;
+
+    // gather the positions of the triangle's vertices
+    matrix3_type X;
+    X.col(0) = q.template block<3, 1>(offsets[0], 0);
+    X.col(1) = q.template block<3, 1>(offsets[1], 0);
+    X.col(2) = q.template block<3, 1>(offsets[2], 0);
+
+    matrix32_type const F = X * packed_.G.template cast<Scalar>().transpose();
+
+    // the goal of PD (i.e. pi) is given by the projection policy
+    matrix32_type const P = policy_.template project<Scalar>(F);
+
+    // wi * (Ai*Si)^T * Bi * pi is wi * A0 * P * G, one column per vertex of the triangle
+    Scalar const weight  = static_cast<Scalar>(packed_.weight);
+    matrix3_type const B = (weight * P) * packed_.G.template cast<Scalar>();
+
+    b.template block<3, 1>(offsets[0], 0) += B.col(0);
+    b.template block<3, 1>(offsets[1], 0) += B.col(1);
+    b.template block<3, 1>(offsets[2], 0) += B.col(2);
+
+    // wi/2 * |Ai*Si*q - Bi*pi|^2 = wi/2 * A0 * |F - P|^2
+    return Scalar{0.5} * weight * (F - P).squaredNorm();
+}
+
+template <class ProjectionPolicy>
+std::vector<Eigen::Triplet<typename triangle_constraint_t<ProjectionPolicy>::scalar_type>>
+triangle_constraint_t<ProjectionPolicy>::get_wi_SiT_AiT_Ai_Si(
+    positions_type const& p,
+    masses_type const& M) const
+{
+    auto const& offsets = packed_.offsets;
+
+    // the 3x3 block coupling vertices a and c is (D * D^T)(a, c) * I, as for tetrahedra
+    Eigen::Matrix3d const DDT = packed_.weight * (packed_.G.transpose() * packed_.G);
+
+    std::array<Eigen::Triplet<scalar_type>, 9u * 3u> triplets;
+    std::size_t t = 0u;
+    for (std::size_t a = 0u; a < 3u; ++a)
+        for (std::size_t c = 0u; c < 3u; ++c)
+            for (int d = 0; d < 3; ++d)
+                triplets[t++] = {
+                    static_cast<int>(offsets[a]) + d,
+                    static_cast<int>(offsets[c]) + d,
+                    DDT(a, c)};
+
+    return std::vector<Eigen::Triplet<scalar_type>>{triplets.begin(), triplets.end()};
+}
+
+} // namespace pd
+
+#endif // PD_PD_TRIANGLE_CONSTRAINT_H
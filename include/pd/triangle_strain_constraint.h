@@ -0,0 +1,105 @@
+#ifndef PD_PD_TRIANGLE_STRAIN_CONSTRAINT_H
+#define PD_PD_TRIANGLE_STRAIN_CONSTRAINT_H
+
+#include "triangle_constraint.h"
+
+#include <Eigen/Eigenvalues>
+#include <algorithm>
+#include <cmath>
+
+namespace pd {
+
+/**
+ * Projects the 3x2 deformation gradient F = U * Sigma * V^T of a triangle onto
+ * U * Fhat * V^T, where Fhat holds the singular values of F clamped to
+ * [sigma_min, sigma_max]. The default bounds project onto the polar factor U * V^T,
+ * i.e. the in-plane rest shape. The 2x2 problem is solved in closed form from the
+ * eigendecomposition of F^T * F instead of a 3x2 SVD.
+ */
+struct triangle_strain_projection_t
+{
+    double sigma_min = 1.;
+    double sigma_max = 1.;
+
+    template <class Scalar>
+    Eigen::Matrix<Scalar, 3, 2> project(Eigen::Matrix<Scalar, 3, 2> const& F) const
+    {
+        using vector3_type  = Eigen::Matrix<Scalar, 3, 1>;
+        using matrix2_type  = Eigen::Matrix<Scalar, 2, 2>;
+        using matrix32_type = Eigen::Matrix<Scalar, 3, 2>;
+
+        Eigen::SelfAdjointEigenSolver<matrix2_type> eigen;
+        eigen.computeDirect(F.transpose() * F);
+        matrix2_type const& V = eigen.eigenvectors();
+
+        // eigenvalues are ascending, the second singular value is the largest
+        Scalar const sigma0 = std::sqrt(std::max(eigen.eigenvalues()(0), Scalar{0.}));
+        Scalar const sigma1 = std::sqrt(std::max(eigen.eigenvalues()(1), Scalar{0.}));
+
+        // the left singular vectors of degenerate triangles are any orthonormal pair
+        Scalar const epsilon = Eigen::NumTraits<Scalar>::dummy_precision();
+        vector3_type const u1 =
+            sigma1 > epsilon ? vector3_type{F * V.col(1) / sigma1} : vector3_type::UnitX();
+        vector3_type const u0 =
+            sigma0 > epsilon ? vector3_type{F * V.col(0) / sigma0} : u1.unitOrthogonal();
+
+        Scalar const min = static_cast<Scalar>(sigma_min);
+        Scalar const max = static_cast<Scalar>(sigma_max);
+
+        matrix32_type const P = std::clamp(sigma0, min, max) * u0 * V.col(0).transpose() +
+                                std::clamp(sigma1, min, max) * u1 * V.col(1).transpose();
+        return P;
+    }
+};
+
+/**
+ * In-plane strain limiting of a triangle, the membrane counterpart of
+ * strain_constraint_t for cloth and shells.
+ */
+class triangle_strain_constraint_t : public triangle_constraint_t<triangle_strain_projection_t>
+{
+  public:
+    using self_type          = triangle_strain_constraint_t;
+    using base_type          = triangle_constraint_t<triangle_strain_projection_t>;
+    using index_type         = std::uint32_t;
+    using scalar_type        = double;
+    using masses_type        = Eigen::VectorXd;
+    using positions_type     = typename base_type::positions_type;
+    using q_type             = typename base_type::q_type;
+    using gradient_type      = typename base_type::gradient_type;
+    using sparse_matrix_type = Eigen::SparseMatrix<scalar_type>;
+
+  public:
+    triangle_strain_constraint_t(
+        std::initializer_list<index_type> indices,
+        scalar_type wi,
+        positions_type const& p,
+        scalar_type sigma_min,
+        scalar_type sigma_max);
+
+    /**
+     * Restores a constraint from its stored state, see snapshot.h
+     */
+    triangle_strain_constraint_t(
+        std::vector<index_type> indices,
+        scalar_type wi,
+        packed_triangle_t const& packed,
+        scalar_type sigma_min,
+        scalar_type sigma_max);
+
+    virtual std::unique_ptr<constraint_t> clone() const override
+    {
+        return std::make_unique<self_type>(*this);
+    }
+
+    virtual constraint_type_t type() const override { return constraint_type_t::triangle_strain; }
+
+    virtual scalar_type evaluate(positions_type const& p, masses_type const& M) const override;
+
+    scalar_type sigma_min() const { return policy().sigma_min; }
+    scalar_type sigma_max() const { return policy().sigma_max; }
+};
+
+} // namespace pd
+
+#endif // PD_PD_TRIANGLE_STRAIN_CONSTRAINT_H
@@ -3,12 +3,14 @@
 
 #include "pd/deformable_mesh.h"
 #include "pd/solver.h"
+#include "pd/subspace_solver.h"
+#include "pd/surface_bvh.h"
 #include "physics_params.h"
 #include "picking_state.h"
 
 #include <GLFW/glfw3.h>
 #include <igl/opengl/glfw/Viewer.h>
-#include <igl/unproject_onto_mesh.h>
+#include <igl/unproject.h>
 
 namespace ui {
 
@@ -18,16 +20,22 @@ struct mouse_down_handler_t
     picking_state_t* picking_state;
     pd::solver_t* solver;
     physics_params_t* physics_params;
+    pd::surface_bvh_t* surface_bvh;
+    pd::subspace_solver_t* subspace_solver;
 
     mouse_down_handler_t(
         std::function<bool()> is_model_ready,
         picking_state_t* picking_state,
         pd::solver_t* solver,
-        physics_params_t* physics_params)
+        physics_params_t* physics_params,
+        pd::surface_bvh_t* surface_bvh,
+        pd::subspace_solver_t* subspace_solver)
         : is_model_ready(is_model_ready),
           picking_state(picking_state),
           solver(solver),
-          physics_params(physics_params)
+          physics_params(physics_params),
+          surface_bvh(surface_bvh),
+          subspace_solver(subspace_solver)
     {
     }
 
@@ -5,6 +5,7 @@
 #include "picking_state.h"
 
 #include <igl/opengl/glfw/Viewer.h>
+#include <igl/project.h>
 #include <igl/unproject.h>
 
 namespace ui {
@@ -14,14 +15,12 @@ struct mouse_move_handler_t
     std::function<bool()> is_model_ready;
     picking_state_t* picking_state;
     pd::deformable_mesh_t* model;
-    Eigen::MatrixX3d* fext;
 
     mouse_move_handler_t(
         std::function<bool()> is_model_ready,
         picking_state_t* picking_state,
-        pd::deformable_mesh_t* model,
-        Eigen::MatrixX3d* fext)
-        : is_model_ready(is_model_ready), picking_state(picking_state), model(model), fext(fext)
+        pd::deformable_mesh_t* model)
+        : is_model_ready(is_model_ready), picking_state(picking_state), model(model)
     {
     }
 
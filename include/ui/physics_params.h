@@ -6,8 +6,20 @@ namespace ui {
 struct physics_params_t
 {
     bool is_gravity_active                   = false;
+    bool is_mixed_precision_active           = false;
+    bool is_sleeping_active                  = false; ///< Skips regions at rest in the local step
+    int global_solver                        = 0; ///< Index of the pd::global_solver_t
+    int subdomain_count                      = 8;
+    float chebyshev_rho                      = 0.999f;
+    bool is_floor_active                     = false;
+    float floor_height                       = -1.f;
+    bool is_self_collision_active            = false;
+    float collision_thickness                = 0.01f;
     float dt                                 = 0.0166667;
     int solver_iterations                    = 10;
+    bool is_subspace_active                  = false; ///< Steps the reduced subspace solver
+    int subspace_handle_count                = 32;
+    int subspace_sample_count                = 256; ///< Cubature samples per constraint type
     float mass_per_particle                  = 10.f;
     float edge_constraint_wi                 = 1'000'000.f;
     float positional_constraint_wi           = 1'000'000'000.f;
@@ -15,6 +27,12 @@ struct physics_params_t
     float corotated_deformation_gradient_constraint_wi = 10'000'000.f;
     float shape_targeting_constraint_wi      = 10'000'000.f;
     float strain_limit_constraint_wi         = 10'000'000.f;
+    float triangle_strain_constraint_wi      = 1'000'000.f;
+    float bending_constraint_wi              = 1'000.f;
+    bool is_shape_target_animation_playing   = false;
+    float shape_target_animation_time        = 0.f; ///< Playback time, loops over the keyframes
+    bool is_frame_export_active              = false; ///< Writes simulated frames to frames/
+    int exported_frame_count                 = 0;
 };
 
 } // namespace ui
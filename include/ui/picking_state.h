@@ -1,14 +1,16 @@
 #ifndef PD_UI_PICKING_STATE_H
 #define PD_UI_PICKING_STATE_H
 
+#include "pd/positional_constraint.h"
+
 namespace ui {
 
 struct picking_state_t
 {
-    bool is_picking = false;
-    int vertex      = 0;
-    float force     = 4000.f;
-    int mouse_x, mouse_y;
+    bool is_picking                         = false;
+    int vertex                              = 0;
+    float stiffness                         = 1'000'000.f; ///< Weight of the drag attachment
+    pd::positional_constraint_t* attachment = nullptr;     ///< Transient constraint of the solver
 };
 
 } // namespace ui
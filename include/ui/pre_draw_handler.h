@@ -1,7 +1,10 @@
 #ifndef PD_UI_PRE_DRAW_HANDLER_H
 #define PD_UI_PRE_DRAW_HANDLER_H
 
+#include "pd/shape_target_animation.h"
 #include "pd/solver.h"
+#include "pd/subspace_solver.h"
+#include "pd/surface_bvh.h"
 #include "ui/physics_params.h"
 
 #include <igl/opengl/glfw/Viewer.h>
@@ -14,13 +17,25 @@ struct pre_draw_handler_t
     physics_params_t* physics_params;
     pd::solver_t* solver;
     Eigen::MatrixX3d* fext;
+    pd::surface_bvh_t* surface_bvh;
+    pd::shape_target_animation_t const* shape_target_animation;
+    pd::subspace_solver_t* subspace_solver;
 
     pre_draw_handler_t(
         std::function<bool()> is_model_ready,
         physics_params_t* physics_params,
         pd::solver_t* solver,
-        Eigen::MatrixX3d* fext)
-        : is_model_ready(is_model_ready), physics_params(physics_params), solver(solver), fext(fext)
+        Eigen::MatrixX3d* fext,
+        pd::surface_bvh_t* surface_bvh,
+        pd::shape_target_animation_t const* shape_target_animation,
+        pd::subspace_solver_t* subspace_solver)
+        : is_model_ready(is_model_ready),
+          physics_params(physics_params),
+          solver(solver),
+          fext(fext),
+          surface_bvh(surface_bvh),
+          shape_target_animation(shape_target_animation),
+          subspace_solver(subspace_solver)
     {
     }
 
@@ -0,0 +1,215 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <geometry/get_simple_bar_model.h>
+#include <pd/communicator.h>
+#include <pd/deformable_mesh.h>
+#include <pd/distributed_solver.h>
+#include <pd/solver.h>
+#include <string>
+#include <vector>
+
+#if defined(PD_WITH_MPI)
+#include <mpi.h>
+#endif
+
+/**
+ * Simulates a bar on several ranks with distributed_solver_t and checks the result
+ * against solver_t on one process. The ranks run as forked processes connected by
+ * sockets (the default, except on Windows), as threads of this process, or, with
+ * PD_WITH_MPI, as the processes of an MPI job:
+ *
+ *     pd-distributed [--ranks N] [--steps S] [--transport processes|threads]
+ *     mpirun -np N pd-distributed [--steps S] --transport mpi
+ *
+ * Returns 0 if the distributed positions match the single-process positions.
+ */
+namespace {
+
+struct options_t
+{
+    int rank_count        = 3;
+    int step_count        = 10;
+#if defined(_WIN32)
+    std::string transport = "threads";
+#else
+    std::string transport = "processes";
+#endif
+};
+
+double constexpr dt              = 0.01;
+int constexpr num_iterations     = 10;
+double constexpr max_deviation   = 1e-6; ///< Of any coordinate, the bar is 1 long
+int constexpr gather_tag         = 1;
+std::size_t constexpr bar_width  = 12u;
+std::size_t constexpr bar_height = 4u;
+std::size_t constexpr bar_depth  = 4u;
+
+/**
+ * A bar clamped at one end and pulled down at the other, as in pd-plot
+ */
+pd::deformable_mesh_t make_bar_model(Eigen::MatrixXd& fext)
+{
+    auto [V, T, F] = geometry::get_simple_bar_model(bar_width, bar_height, bar_depth);
+    Eigen::RowVector3d const v_mean = V.colwise().mean();
+    V.rowwise() -= v_mean;
+    V.array() /= V.maxCoeff() - V.minCoeff();
+
+    Eigen::VectorXd masses(V.rows());
+    masses.setConstant(10.);
+    pd::deformable_mesh_t mesh{V, F, T, masses};
+    mesh.constrain_deformation_gradient(10'000'000.);
+    auto const num_fixed_particles = static_cast<int>(bar_height * bar_depth);
+    for (int i = 0; i < num_fixed_particles; ++i)
+    {
+        mesh.add_positional_constraint(i, 1'000'000'000.);
+        mesh.fix(i);
+    }
+
+    fext.setZero(V.rows(), 3);
+    fext.col(1).array() -= 9.81;
+    fext.bottomRows(num_fixed_particles).col(1).array() -= 10'000.;
+    return mesh;
+}
+
+/**
+ * Simulates the bar on the communicator's rank and compares the gathered positions
+ * with the single-process simulation on rank 0. Every rank returns the result.
+ */
+bool run_rank(pd::communicator_t& communicator, options_t const& options)
+{
+    Eigen::MatrixXd fext;
+    pd::deformable_mesh_t mesh = make_bar_model(fext);
+
+    pd::mesh_partition_t partition =
+        pd::partition_mesh(mesh, communicator.size(), communicator.rank());
+    auto const L = static_cast<int>(partition.global_index.size());
+    Eigen::MatrixXd local_fext(L, 3);
+    for (int i = 0; i < L; ++i)
+        local_fext.row(i) = fext.row(partition.global_index[static_cast<std::size_t>(i)]);
+
+    pd::convergence_criteria_t criteria{};
+    criteria.tolerance      = 1e-12;
+    criteria.max_iterations = 1000;
+
+    pd::distributed_solver_t solver(communicator, partition);
+    solver.set_convergence_criteria(criteria);
+    solver.prepare(dt);
+    for (int s = 0; s < options.step_count; ++s)
+        solver.step(local_fext, num_iterations);
+
+    // owned vertices as (global index, x, y, z)
+    pd::communicator_t::buffer_type owned;
+    owned.reserve(4u * static_cast<std::size_t>(partition.owned_count));
+    for (int i = 0; i < partition.owned_count; ++i)
+    {
+        owned.push_back(static_cast<double>(partition.global_index[static_cast<std::size_t>(i)]));
+        for (int d = 0; d < 3; ++d)
+            owned.push_back(partition.mesh.positions()(i, d));
+    }
+
+    double failures = 0.;
+    if (communicator.rank() != 0)
+    {
+        communicator.send(0, gather_tag, owned);
+    }
+    else
+    {
+        Eigen::MatrixXd positions(mesh.positions().rows(), 3);
+        for (int source = 0; source < communicator.size(); ++source)
+        {
+            if (source != 0)
+                communicator.receive(source, gather_tag, owned);
+            for (std::size_t k = 0u; k + 3u < owned.size(); k += 4u)
+                for (int d = 0; d < 3; ++d)
+                    positions(static_cast<Eigen::Index>(owned[k]), d) = owned[k + 1u + d];
+        }
+
+        pd::solver_t reference{};
+        reference.set_model(&mesh);
+        reference.prepare(dt);
+        for (int s = 0; s < options.step_count; ++s)
+            reference.step(fext, num_iterations);
+
+        double const deviation = (positions - mesh.positions()).cwiseAbs().maxCoeff();
+        std::printf(
+            "%d ranks (%s), %d steps, %d vertices: max deviation from one process %g\n",
+            communicator.size(),
+            options.transport.c_str(),
+            options.step_count,
+            static_cast<int>(positions.rows()),
+            deviation);
+        if (!(deviation <= max_deviation))
+            failures = 1.;
+    }
+
+    return communicator.all_reduce_sum(failures) == 0.;
+}
+
+bool parse_options(int argc, char** argv, options_t& options)
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        bool const has_value = i + 1 < argc;
+        if (std::strcmp(argv[i], "--ranks") == 0 && has_value)
+            options.rank_count = std::atoi(argv[++i]);
+        else if (std::strcmp(argv[i], "--steps") == 0 && has_value)
+            options.step_count = std::atoi(argv[++i]);
+        else if (std::strcmp(argv[i], "--transport") == 0 && has_value)
+            options.transport = argv[++i];
+        else
+            return false;
+    }
+    return options.rank_count > 0 && options.step_count >= 0;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    options_t options{};
+    if (!parse_options(argc, argv, options))
+    {
+        std::fprintf(
+            stderr,
+            "usage: %s [--ranks N] [--steps S] [--transport processes|threads|mpi]\n",
+            argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    bool is_success = false;
+    if (options.transport == "threads")
+    {
+        std::vector<char> rank_success(static_cast<std::size_t>(options.rank_count), 0);
+        pd::run_local_ranks(options.rank_count, [&](pd::communicator_t& c) {
+            rank_success[static_cast<std::size_t>(c.rank())] = run_rank(c, options);
+        });
+        is_success = rank_success.front() != 0;
+    }
+#if !defined(_WIN32)
+    else if (options.transport == "processes")
+    {
+        is_success = pd::run_local_processes(options.rank_count, [&](pd::communicator_t& c) {
+            return run_rank(c, options);
+        });
+    }
+#endif
+#if defined(PD_WITH_MPI)
+    else if (options.transport == "mpi")
+    {
+        MPI_Init(&argc, &argv);
+        {
+            pd::mpi_communicator_t communicator{};
+            is_success = run_rank(communicator, options);
+        }
+        MPI_Finalize();
+    }
+#endif
+    else
+    {
+        std::fprintf(stderr, "unknown transport %s\n", options.transport.c_str());
+        return EXIT_FAILURE;
+    }
+
+    return is_success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -1,13 +1,18 @@
 #include "geometry/get_simple_bar_model.h"
 #include "geometry/get_simple_cloth_model.h"
 #include "pd/deformable_mesh.h"
+#include "pd/shape_target_animation.h"
+#include "pd/snapshot.h"
 #include "pd/solver.h"
+#include "pd/subspace_solver.h"
+#include "pd/thread_pool.h"
 #include "ui/mouse_down_handler.h"
 #include "ui/mouse_move_handler.h"
 #include "ui/physics_params.h"
 #include "ui/picking_state.h"
 #include "ui/pre_draw_handler.h"
 
+#include <algorithm>
 #include <array>
 #include <filesystem>
 #include <igl/decimate.h>
@@ -28,6 +33,12 @@ int main(int argc, char** argv)
     ui::picking_state_t picking_state{};
     ui::physics_params_t physics_params{};
     pd::solver_t solver;
+    pd::collision_detector_t collision_detector;
+    solver.set_collision_detector(&collision_detector);
+    pd::surface_bvh_t surface_bvh;
+    pd::shape_target_animation_t shape_target_animation;
+    pd::subspace_solver_t subspace_solver;
+    bool should_reorder_vertices = true;
 
     auto const is_model_ready = [&]() {
         return model.positions().rows() > 0;
@@ -42,15 +53,25 @@ int main(int argc, char** argv)
     viewer.plugins.push_back(&menu);
 
     viewer.callback_mouse_down =
-        ui::mouse_down_handler_t{is_model_ready, &picking_state, &solver, &physics_params};
+        ui::mouse_down_handler_t{
+            is_model_ready,
+            &picking_state,
+            &solver,
+            &physics_params,
+            &surface_bvh,
+            &subspace_solver};
 
     viewer.callback_mouse_move =
-        ui::mouse_move_handler_t{is_model_ready, &picking_state, &model, &fext};
+        ui::mouse_move_handler_t{is_model_ready, &picking_state, &model};
 
     viewer.callback_mouse_up =
         [&](igl::opengl::glfw::Viewer& viewer, int button, int modifier) -> bool {
         if (picking_state.is_picking)
+        {
             picking_state.is_picking = false;
+            solver.remove_transient_constraint(picking_state.attachment);
+            picking_state.attachment = nullptr;
+        }
 
         return false;
     };
@@ -61,22 +82,38 @@ int main(int argc, char** argv)
         V.array() /= V.maxCoeff() - V.minCoeff();
     };
 
+    // resets everything that depends on the model's vertices and constraints, after the
+    // model was replaced by a new mesh, a snapshot or a tetrahedralization
+    auto const reset_model_state = [&]() {
+        subspace_solver.set_model(&model);
+        picking_state.is_picking = false;
+        picking_state.attachment = nullptr;
+        collision_detector.reset();
+        surface_bvh.build(model.positions(), model.faces());
+        shape_target_animation.clear();
+
+        fext.resizeLike(model.positions());
+        fext.setZero();
+
+        viewer.data().clear();
+        viewer.data().set_mesh(model.positions(), model.faces());
+        viewer.core().align_camera_center(model.positions());
+    };
+
     auto const reset_simulation_model = [&](Eigen::MatrixXd& V,
                                             Eigen::MatrixXi& F,
                                             Eigen::MatrixXi& T,
-                                            bool should_rescale = false) {
+                                            bool should_rescale = false,
+                                            pd::material_field_t materials = {}) {
         if (should_rescale)
             rescale(V);
 
         model = pd::deformable_mesh_t{V, F, T};
+        model.set_materials(std::move(materials));
+        if (should_reorder_vertices)
+            model.reorder_vertices();
         solver.set_model(&model);
-
-        fext.resizeLike(model.positions());
-        fext.setZero();
-
-        viewer.data().clear();
-        viewer.data().set_mesh(model.positions(), model.faces());
-        viewer.core().align_camera_center(model.positions());
+        reset_model_state();
     };
 
     menu.callback_draw_viewer_window = [&]() {
@@ -107,7 +144,10 @@ int main(int argc, char** argv)
             {
                 std::string const filename = igl::file_dialog_save();
                 std::filesystem::path const mesh{filename};
-                igl::write_triangle_mesh(mesh.string(), model.positions(), model.faces());
+                igl::write_triangle_mesh(
+                    mesh.string(),
+                    model.input_ordered_positions(),
+                    model.input_ordered_faces());
             }
             if (ImGui::Button("Load tet mesh", ImVec2((w - p) / 2.f, 0)))
             {
@@ -119,7 +159,17 @@ int main(int argc, char** argv)
                     Eigen::MatrixXi T, F;
                     if (igl::readMESH(mesh.string(), V, T, F))
                     {
-                        reset_simulation_model(V, F, T, true);
+                        // per-element materials are read from a .material file next to the mesh
+                        pd::material_field_t materials{};
+                        std::filesystem::path material{mesh};
+                        material.replace_extension(".material");
+                        if (std::filesystem::exists(material))
+                            pd::read_material_field(
+                                material.string(),
+                                static_cast<std::size_t>(T.rows()),
+                                materials);
+
+                        reset_simulation_model(V, F, T, true, std::move(materials));
                     }
                 }
             }
@@ -128,8 +178,32 @@ int main(int argc, char** argv)
             {
                 std::string const filename = igl::file_dialog_save();
                 std::filesystem::path const mesh{filename};
-                igl::writeMESH(mesh.string(), model.positions(), model.elements(), model.faces());
+                igl::writeMESH(
+                    mesh.string(),
+                    model.input_ordered_positions(),
+                    model.input_ordered_elements(),
+                    model.input_ordered_faces());
             }
+            if (ImGui::Button("Load snapshot", ImVec2((w - p) / 2.f, 0)))
+            {
+                std::string const filename = igl::file_dialog_open();
+                std::filesystem::path const snapshot{filename};
+                if (std::filesystem::exists(snapshot) &&
+                    std::filesystem::is_regular_file(snapshot) &&
+                    pd::load_snapshot(snapshot.string(), model, &solver))
+                {
+                    // load_snapshot() already set the model of the solver
+                    reset_model_state();
+                }
+            }
+            ImGui::SameLine();
+            if (ImGui::Button("Save snapshot", ImVec2((w - p) / 2.f, 0)))
+            {
+                std::string const filename = igl::file_dialog_save();
+                if (!filename.empty())
+                    pd::save_snapshot(filename, model, &solver);
+            }
+            ImGui::Checkbox("Reorder vertices on load (RCM)", &should_reorder_vertices);
         }
         if (ImGui::CollapsingHeader("Geometry", ImGuiTreeNodeFlags_DefaultOpen))
         {
@@ -209,9 +283,10 @@ int main(int argc, char** argv)
                 if (ImGui::Button("Tetrahedralize", ImVec2((w - p) / 2.f, 0)))
                 {
                     model.tetrahedralize(model.positions(), model.faces());
-                    viewer.data().clear();
-                    viewer.data().set_mesh(model.positions(), model.faces());
-                    viewer.core().align_camera_center(model.positions());
+                    if (should_reorder_vertices)
+                        model.reorder_vertices();
+                    solver.set_dirty();
+                    reset_model_state();
                 }
                 ImGui::TreePop();
             }
@@ -226,7 +301,7 @@ int main(int argc, char** argv)
         {
             if (ImGui::TreeNode("Constraints"))
             {
-                static std::array<bool, 5u> is_constraint_type_active;
+                static std::array<bool, 7u> is_constraint_type_active;
                 if (ImGui::TreeNode("Edge length##Constraints"))
                 {
                     ImGui::InputFloat(
@@ -272,8 +347,34 @@ int main(int argc, char** argv)
                     ImGui::Checkbox("Active##ShapeTargeting", &is_constraint_type_active[3]);
                     if (ImGui::Button("Set Shape Target", ImVec2((w - p) / 2.f, 0))) {
                         if (is_constraint_type_active[3])
-                            model.set_target_shape();
+                            model.set_shape_targets(model.positions());
                     }
+
+                    // keyframes capture the stretches of the current pose, at regular intervals
+                    static float keyframe_interval = 1.f;
+                    ImGui::InputFloat("Keyframe interval##ShapeTargeting", &keyframe_interval);
+                    keyframe_interval = std::max(keyframe_interval, 0.01f);
+                    if (ImGui::Button("Add Keyframe", ImVec2((w - p) / 2.f, 0)))
+                    {
+                        double const time = shape_target_animation.empty() ?
+                                                0. :
+                                                shape_target_animation.end_time() +
+                                                    static_cast<double>(keyframe_interval);
+                        shape_target_animation.add_keyframe(time, model, model.positions());
+                    }
+                    ImGui::SameLine();
+                    if (ImGui::Button("Clear Keyframes", ImVec2((w - p) / 2.f, 0)))
+                    {
+                        shape_target_animation.clear();
+                        physics_params.shape_target_animation_time = 0.f;
+                    }
+                    ImGui::Checkbox(
+                        "Play keyframes##ShapeTargeting",
+                        &physics_params.is_shape_target_animation_playing);
+                    ImGui::Text(
+                        "%zu keyframes of %zu targets",
+                        shape_target_animation.keyframe_count(),
+                        shape_target_animation.target_count());
                     ImGui::TreePop();
                 }
                 static float sigma_min = 0.99f;
@@ -297,7 +398,46 @@ int main(int argc, char** argv)
                         &sigma_max,
                         0.01f,
                         0.1f);
-                    ImGui::Checkbox("Active##StrainLimit", &is_constraint_type_active[3]);
+                    ImGui::Checkbox("Active##StrainLimit", &is_constraint_type_active[4]);
+                    ImGui::TreePop();
+                }
+                static float triangle_sigma_min = 0.99f;
+                static float triangle_sigma_max = 1.01f;
+                if (ImGui::TreeNode("Triangle Strain##Constraints"))
+                {
+                    ImGui::BulletText("Valid for triangle (cloth) models");
+                    ImGui::InputFloat(
+                        "wi##TriangleStrain",
+                        &physics_params.triangle_strain_constraint_wi,
+                        10.f,
+                        100.f,
+                        "%.1f");
+                    ImGui::InputFloat(
+                        "Minimum singular value##TriangleStrain",
+                        &triangle_sigma_min,
+                        0.01f,
+                        0.1f);
+                    ImGui::InputFloat(
+                        "Maximum singular value##TriangleStrain",
+                        &triangle_sigma_max,
+                        0.01f,
+                        0.1f);
+                    ImGui::Checkbox("Active##TriangleStrain", &is_constraint_type_active[5]);
+                    ImGui::TreePop();
+                }
+                static bool is_bending_isometric = true;
+                if (ImGui::TreeNode("Bending##Constraints"))
+                {
+                    ImGui::BulletText("Valid for triangle (cloth) models");
+                    ImGui::BulletText("Isometric bending has no projection,\nfor flat rest shapes");
+                    ImGui::InputFloat(
+                        "wi##Bending",
+                        &physics_params.bending_constraint_wi,
+                        10.f,
+                        100.f,
+                        "%.1f");
+                    ImGui::Checkbox("Isometric##Bending", &is_bending_isometric);
+                    ImGui::Checkbox("Active##Bending", &is_constraint_type_active[6]);
                     ImGui::TreePop();
                 }
 
@@ -317,6 +457,7 @@ int main(int argc, char** argv)
                     model.immobilize();
                     model.constraints().clear();
                     solver.set_dirty();
+                    subspace_solver.set_dirty();
                     if (is_constraint_type_active[0])
                     {
                         model.constrain_edge_lengths(physics_params.edge_constraint_wi);
@@ -342,6 +483,22 @@ int main(int argc, char** argv)
                             sigma_max,
                             physics_params.strain_limit_constraint_wi);
                     }
+                    if (is_constraint_type_active[5])
+                    {
+                        model.constrain_triangle_strain(
+                            triangle_sigma_min,
+                            triangle_sigma_max,
+                            physics_params.triangle_strain_constraint_wi);
+                    }
+                    if (is_constraint_type_active[6] && is_bending_isometric)
+                    {
+                        model.constrain_isometric_bending(physics_params.bending_constraint_wi);
+                    }
+                    else if (is_constraint_type_active[6])
+                    {
+                        model.constrain_bending(physics_params.bending_constraint_wi);
+                    }
+                    model.sort_constraints_by_locality();
                 }
                 std::string const constraint_count = std::to_string(model.constraints().size());
                 ImGui::BulletText(std::string("Constraints: " + constraint_count).c_str());
@@ -351,7 +508,70 @@ int main(int argc, char** argv)
             ImGui::InputInt("Solver iterations", &physics_params.solver_iterations);
             ImGui::InputFloat("mass per particle", &physics_params.mass_per_particle, 1, 10, 1);
             ImGui::Checkbox("Gravity", &physics_params.is_gravity_active);
+            ImGui::Checkbox(
+                "Mixed precision (float local step)",
+                &physics_params.is_mixed_precision_active);
+            ImGui::Checkbox("Sleep regions at rest", &physics_params.is_sleeping_active);
+            if (physics_params.is_sleeping_active)
+            {
+                std::string const sleeping_regions =
+                    std::to_string(solver.sleeping_region_count()) + " / " +
+                    std::to_string(solver.region_count());
+                ImGui::BulletText(std::string("Sleeping regions: " + sleeping_regions).c_str());
+            }
+            ImGui::Combo(
+                "Global solver",
+                &physics_params.global_solver,
+                "Cholesky\0Multigrid CG\0Domain decomposition CG\0Chebyshev Jacobi\0");
+            if (physics_params.global_solver == 2)
+                ImGui::InputInt("Subdomains", &physics_params.subdomain_count);
+            if (physics_params.global_solver == 3)
+                ImGui::InputFloat(
+                    "Spectral radius",
+                    &physics_params.chebyshev_rho,
+                    0.001f,
+                    0.01f,
+                    "%.4f");
+            ImGui::Checkbox("Subspace (reduced model)", &physics_params.is_subspace_active);
+            if (physics_params.is_subspace_active)
+            {
+                ImGui::InputInt("Handles", &physics_params.subspace_handle_count);
+                ImGui::InputInt("Samples per type", &physics_params.subspace_sample_count);
+                ImGui::BulletText("Collisions and dragging are\nignored in the subspace");
+            }
+            ImGui::Checkbox("Floor", &physics_params.is_floor_active);
+            if (physics_params.is_floor_active)
+                ImGui::InputFloat("Floor height", &physics_params.floor_height, 0.1f, 1.f, "%.2f");
+            ImGui::Checkbox("Self collisions", &physics_params.is_self_collision_active);
+            ImGui::InputFloat(
+                "Collision thickness",
+                &physics_params.collision_thickness,
+                0.001f,
+                0.01f,
+                "%.3f");
             ImGui::Checkbox("Simulate", &viewer.core().is_animating);
+            ImGui::Checkbox("Export frames to frames/", &physics_params.is_frame_export_active);
+            if (ImGui::TreeNode("Threads"))
+            {
+                // defaults come from PD_THREAD_COUNT and PD_THREAD_CORES
+                static int thread_count = pd::thread_pool().concurrency();
+                static bool is_pinned   = !pd::thread_pool().options().cores.empty();
+                ImGui::InputInt("Threads", &thread_count);
+                ImGui::Checkbox("Pin workers to cores 1, 2, ...", &is_pinned);
+                if (ImGui::Button("Apply##Threads", ImVec2((w - p) / 2.f, 0)))
+                {
+                    pd::thread_pool_options_t options{};
+                    options.thread_count = std::max(thread_count, 1);
+                    if (is_pinned)
+                    {
+                        // the workers take cores 1, 2, ..., leaving core 0 to the main thread
+                        for (int core = 1; core < options.thread_count; ++core)
+                            options.cores.push_back(core);
+                    }
+                    pd::set_thread_pool_options(options);
+                }
+                ImGui::TreePop();
+            }
         }
 
         if (ImGui::CollapsingHeader("Picking", ImGuiTreeNodeFlags_DefaultOpen))
@@ -360,9 +580,14 @@ int main(int argc, char** argv)
             ImGui::BulletText(
                 "Hold CTRL and hold left mouse\n"
                 "button while dragging your\n"
-                "mouse to apply external\n"
-                "forces to the model");
-            ImGui::InputFloat("Dragging force", &picking_state.force, 1.f, 10.f, "%.3f");
+                "mouse to drag the model");
+            ImGui::BulletText("Hold ALT and left click points\non the model to tear them out");
+            ImGui::InputFloat(
+                "Dragging stiffness",
+                &picking_state.stiffness,
+                1000.f,
+                100000.f,
+                "%.0f");
         }
 
         if (ImGui::CollapsingHeader("Visualization", ImGuiTreeNodeFlags_DefaultOpen))
@@ -377,7 +602,14 @@ int main(int argc, char** argv)
     };
 
     viewer.callback_pre_draw =
-        ui::pre_draw_handler_t{is_model_ready, &physics_params, &solver, &fext};
+        ui::pre_draw_handler_t{
+            is_model_ready,
+            &physics_params,
+            &solver,
+            &fext,
+            &surface_bvh,
+            &shape_target_animation,
+            &subspace_solver};
 
     viewer.launch();
 
@@ -0,0 +1,161 @@
+#include "pd/bending_constraint.h"
+
+#include <Eigen/Geometry>
+#include <cassert>
+
+namespace pd {
+
+namespace {
+
+double cotangent(Eigen::Vector3d const& a, Eigen::Vector3d const& b)
+{
+    return a.dot(b) / a.cross(b).norm();
+}
+
+} // namespace
+
+packed_hinge_t packed_hinge_t::pack(
+    std::vector<std::uint32_t> const& indices,
+    scalar_type wi,
+    Eigen::MatrixXd const& p)
+{
+    assert(indices.size() == 4u);
+
+    packed_hinge_t hinge{};
+    std::array<Eigen::Vector3d, 4u> x;
+    for (std::size_t k = 0u; k < 4u; ++k)
+    {
+        hinge.offsets[k] = 3u * indices[k];
+        x[k]             = p.row(indices[k]).transpose();
+    }
+
+    // interior angles at the edge's vertices v1 and v2, in both triangles of the hinge
+    scalar_type const cot_1_3 = cotangent(x[1] - x[0], x[2] - x[0]);
+    scalar_type const cot_2_3 = cotangent(x[0] - x[1], x[2] - x[1]);
+    scalar_type const cot_1_4 = cotangent(x[1] - x[0], x[3] - x[0]);
+    scalar_type const cot_2_4 = cotangent(x[0] - x[1], x[3] - x[1]);
+
+    hinge.K << cot_2_3 + cot_2_4, cot_1_3 + cot_1_4, -(cot_1_3 + cot_2_3), -(cot_1_4 + cot_2_4);
+
+    scalar_type const A1 = 0.5 * (x[1] - x[0]).cross(x[2] - x[0]).norm();
+    scalar_type const A2 = 0.5 * (x[1] - x[0]).cross(x[3] - x[0]).norm();
+    hinge.weight         = wi * 3. / (A1 + A2);
+
+    hinge.h0 = hinge.K(0) * x[0] + hinge.K(1) * x[1] + hinge.K(2) * x[2] + hinge.K(3) * x[3];
+
+    // flush the round-off of flat hinges, relative to the hinge's size
+    scalar_type const scale = (x[1] - x[0]).norm();
+    if (hinge.h0.norm() <= Eigen::NumTraits<scalar_type>::dummy_precision() * scale)
+        hinge.h0.setZero();
+
+    return hinge;
+}
+
+std::vector<Eigen::Triplet<packed_hinge_t::scalar_type>> packed_hinge_t::triplets() const
+{
+    std::array<Eigen::Triplet<scalar_type>, 16u * 3u> triplets;
+    std::size_t t = 0u;
+    for (std::size_t a = 0u; a < 4u; ++a)
+        for (std::size_t c = 0u; c < 4u; ++c)
+            for (int d = 0; d < 3; ++d)
+                triplets[t++] = {
+                    static_cast<int>(offsets[a]) + d,
+                    static_cast<int>(offsets[c]) + d,
+                    weight * K(a) * K(c)};
+
+    return std::vector<Eigen::Triplet<scalar_type>>{triplets.begin(), triplets.end()};
+}
+
+std::size_t packed_hinge_t::hash() const
+{
+    std::size_t seed = std::hash<scalar_type>{}(weight);
+    detail::hash_combine_coefficients(seed, K);
+    return seed;
+}
+
+bending_constraint_t::bending_constraint_t(
+    std::initializer_list<index_type> indices,
+    scalar_type wi,
+    positions_type const& p)
+    : base_type(indices, wi),
+      packed_(packed_hinge_t::pack(this->indices(), wi, p)),
+      rest_curvature_(packed_.h0.norm())
+{
+}
+
+bending_constraint_t::bending_constraint_t(
+    std::vector<index_type> indices,
+    scalar_type wi,
+    packed_hinge_t const& packed)
+    : base_type(std::move(indices), wi), packed_(packed), rest_curvature_(packed_.h0.norm())
+{
+    assert(this->indices().size() == 4u);
+}
+
+void bending_constraint_t::remap_indices(std::vector<index_type> const& index_map)
+{
+    base_type::remap_indices(index_map);
+    for (std::size_t k = 0u; k < 4u; ++k)
+        packed_.offsets[k] = 3u * this->indices()[k];
+}
+
+template <class Scalar>
+Scalar bending_constraint_t::project(
+    Eigen::Matrix<Scalar, Eigen::Dynamic, 1> const& q,
+    Eigen::Matrix<Scalar, Eigen::Dynamic, 1>& b) const
+{
+    using vector3_type = Eigen::Matrix<Scalar, 3, 1>;
+
+    auto const& offsets                 = packed_.offsets;
+    Eigen::Matrix<Scalar, 4, 1> const K = packed_.K.template cast<Scalar>();
+
+    vector3_type h = vector3_type::Zero();
+    for (std::size_t k = 0u; k < 4u; ++k)
+        h += K(k) * q.template block<3, 1>(offsets[k], 0);
+
+    // keep the current bending direction, which is undefined for flat hinges
+    Scalar const length = h.norm();
+    vector3_type const p =
+        length > Eigen::NumTraits<Scalar>::dummy_precision() ?
+            vector3_type{h * (static_cast<Scalar>(rest_curvature_) / length)} :
+            vector3_type::Zero();
+
+    // wi * (Ai*Si)^T * Bi * pi is weight * K(k) * p for vertex k
+    Scalar const weight   = static_cast<Scalar>(packed_.weight);
+    vector3_type const wp = weight * p;
+    for (std::size_t k = 0u; k < 4u; ++k)
+        b.template block<3, 1>(offsets[k], 0) += K(k) * wp;
+
+    return Scalar{0.5} * weight * (h - p).squaredNorm();
+}
+
+bending_constraint_t::scalar_type
+bending_constraint_t::project_wi_SiT_AiT_Bi_pi(q_type const& q, Eigen::VectorXd& b) const
+{
+    return project<scalar_type>(q, b);
+}
+
+float bending_constraint_t::project_wi_SiT_AiT_Bi_pi(q_float_type const& q, Eigen::VectorXf& b) const
+{
+    return project<float>(q, b);
+}
+
+std::vector<Eigen::Triplet<bending_constraint_t::scalar_type>>
+bending_constraint_t::get_wi_SiT_AiT_Ai_Si(positions_type const& p, masses_type const& M) const
+{
+    return packed_.triplets();
+}
+
+bending_constraint_t::scalar_type
+bending_constraint_t::evaluate(positions_type const& p, masses_type const& M) const
+{
+    Eigen::Vector3d h = Eigen::Vector3d::Zero();
+    for (std::size_t k = 0u; k < 4u; ++k)
+        h += packed_.K(k) * p.row(indices()[k]).transpose();
+
+    // the bending energy wi/2 * 3 / (A1 + A2) * (|h| - |h0|)^2 of the projection
+    scalar_type const delta = h.norm() - rest_curvature_;
+    return 0.5 * packed_.weight * delta * delta;
+}
+
+} // namespace pd
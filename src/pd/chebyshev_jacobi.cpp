@@ -0,0 +1,62 @@
+#include "pd/chebyshev_jacobi.h"
+
+#include "pd/parallel.h"
+
+#include <Eigen/LU>
+
+namespace pd {
+
+void jacobi_solver_t::compute(sparse_matrix_type const& A)
+{
+    A_ = A;
+    set_update(sparse_matrix_type(A.rows(), A.cols()));
+}
+
+bool jacobi_solver_t::set_update(sparse_matrix_type const& C)
+{
+    A_plus_C_ = A_ + C;
+
+    // the diagonal blocks of the symmetric positive definite A + C are symmetric
+    // positive definite, and invertible in closed form
+    auto const N = A_plus_C_.rows() / 3;
+    inverse_blocks_.resize(static_cast<std::size_t>(N));
+    parallel_for(0, N, [&](std::ptrdiff_t v) {
+        Eigen::Matrix3d block = Eigen::Matrix3d::Zero();
+        for (int d = 0; d < 3; ++d)
+        {
+            auto const row = 3 * v + d;
+            for (row_major_matrix_type::InnerIterator it(A_plus_C_, row); it; ++it)
+                if (it.col() >= 3 * v && it.col() < 3 * v + 3)
+                    block(d, it.col() - 3 * v) = it.value();
+        }
+        inverse_blocks_[static_cast<std::size_t>(v)] = block.inverse();
+    });
+    return true;
+}
+
+int jacobi_solver_t::solve(
+    vector_type const& b,
+    vector_type& x,
+    convergence_criteria_t const& criteria) const
+{
+    vector_type x_next(x.rows());
+    parallel_for(0, static_cast<std::ptrdiff_t>(inverse_blocks_.size()), [&](std::ptrdiff_t v) {
+        Eigen::Vector3d r;
+        for (int d = 0; d < 3; ++d)
+        {
+            auto const row = 3 * v + d;
+            scalar_type Ax_i{0.};
+            for (row_major_matrix_type::InnerIterator it(A_plus_C_, row); it; ++it)
+                Ax_i += it.value() * x(it.col());
+            r(d) = b(row) - Ax_i;
+        }
+
+        x_next.segment<3>(3 * v) =
+            x.segment<3>(3 * v) + inverse_blocks_[static_cast<std::size_t>(v)] * r;
+    });
+
+    x = std::move(x_next);
+    return 1;
+}
+
+} // namespace pd
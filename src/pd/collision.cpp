@@ -0,0 +1,278 @@
+#include "pd/collision.h"
+
+#include "pd/half_space_constraint.h"
+#include "pd/parallel.h"
+
+#include <Eigen/Dense>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace pd {
+
+std::uint64_t spatial_hash_t::key(cell_type const& cell)
+{
+    // 21 bits per coordinate are exact for |cell| < 2^20
+    std::uint64_t constexpr offset = std::uint64_t{1u} << 20u;
+    std::uint64_t constexpr mask   = (std::uint64_t{1u} << 21u) - 1u;
+    auto const x = (static_cast<std::uint64_t>(cell.x()) + offset) & mask;
+    auto const y = (static_cast<std::uint64_t>(cell.y()) + offset) & mask;
+    auto const z = (static_cast<std::uint64_t>(cell.z()) + offset) & mask;
+    return (x << 42u) | (y << 21u) | z;
+}
+
+spatial_hash_t::cell_type spatial_hash_t::cell_of(Eigen::Vector3d const& x) const
+{
+    return (x / cell_size_).array().floor().cast<int>();
+}
+
+std::vector<int> const* spatial_hash_t::faces_in(cell_type const& cell) const
+{
+    auto const it = cells_.find(key(cell));
+    return it == cells_.end() ? nullptr : &it->second;
+}
+
+std::vector<int>
+spatial_hash_t::faces_in(Eigen::Vector3d const& lower, Eigen::Vector3d const& upper) const
+{
+    cell_type const min = cell_of(lower);
+    cell_type const max = cell_of(upper);
+
+    std::vector<int> faces;
+    for (int i = min.x(); i <= max.x(); ++i)
+    {
+        for (int j = min.y(); j <= max.y(); ++j)
+        {
+            for (int k = min.z(); k <= max.z(); ++k)
+            {
+                auto const* cell_faces = faces_in(cell_type{i, j, k});
+                if (cell_faces != nullptr)
+                    faces.insert(faces.end(), cell_faces->begin(), cell_faces->end());
+            }
+        }
+    }
+
+    std::sort(faces.begin(), faces.end());
+    faces.erase(std::unique(faces.begin(), faces.end()), faces.end());
+    return faces;
+}
+
+void spatial_hash_t::insert(int f, range_t const& range)
+{
+    for (int i = range.min.x(); i <= range.max.x(); ++i)
+        for (int j = range.min.y(); j <= range.max.y(); ++j)
+            for (int k = range.min.z(); k <= range.max.z(); ++k)
+                cells_[key(cell_type{i, j, k})].push_back(f);
+}
+
+void spatial_hash_t::erase(int f, range_t const& range)
+{
+    for (int i = range.min.x(); i <= range.max.x(); ++i)
+    {
+        for (int j = range.min.y(); j <= range.max.y(); ++j)
+        {
+            for (int k = range.min.z(); k <= range.max.z(); ++k)
+            {
+                auto const it = cells_.find(key(cell_type{i, j, k}));
+                if (it == cells_.end())
+                    continue;
+
+                auto& faces = it->second;
+                auto const face = std::find(faces.begin(), faces.end(), f);
+                if (face != faces.end())
+                {
+                    *face = faces.back();
+                    faces.pop_back();
+                }
+                if (faces.empty())
+                    cells_.erase(it);
+            }
+        }
+    }
+}
+
+void spatial_hash_t::update(
+    Eigen::MatrixXd const& p0,
+    Eigen::MatrixXd const& p,
+    Eigen::MatrixXi const& F,
+    scalar_type margin)
+{
+    auto const face_count = static_cast<std::size_t>(F.rows());
+
+    std::vector<range_t> ranges(face_count);
+    std::vector<char> has_moved(face_count, 1);
+    bool const is_incremental = ranges_.size() == face_count;
+    parallel_for(0, static_cast<std::ptrdiff_t>(face_count), [&](std::ptrdiff_t f) {
+        Eigen::Vector3d lower = p0.row(F(f, 0)).transpose();
+        Eigen::Vector3d upper = lower;
+        for (int j = 0; j < 3; ++j)
+        {
+            for (auto const* x : {&p0, &p})
+            {
+                lower = lower.cwiseMin(x->row(F(f, j)).transpose());
+                upper = upper.cwiseMax(x->row(F(f, j)).transpose());
+            }
+        }
+        lower.array() -= margin;
+        upper.array() += margin;
+
+        auto& range = ranges[static_cast<std::size_t>(f)];
+        range.min   = cell_of(lower);
+        range.max   = cell_of(upper);
+        if (is_incremental)
+        {
+            auto const& previous = ranges_[static_cast<std::size_t>(f)];
+            has_moved[static_cast<std::size_t>(f)] =
+                range.min != previous.min || range.max != previous.max;
+        }
+    });
+
+    if (!is_incremental)
+        cells_.clear();
+
+    rehashed_face_count_ = 0u;
+    for (std::size_t f = 0u; f < face_count; ++f)
+    {
+        if (!has_moved[f])
+            continue;
+
+        if (is_incremental)
+            erase(static_cast<int>(f), ranges_[f]);
+        insert(static_cast<int>(f), ranges[f]);
+        ++rehashed_face_count_;
+    }
+
+    ranges_ = std::move(ranges);
+}
+
+collision_detector_t::contacts_type
+collision_detector_t::detect(deformable_mesh_t const& mesh, Eigen::MatrixXd const& p)
+{
+    contacts_type contacts{};
+
+    if (is_floor_active_)
+    {
+        Eigen::Vector3d const up{0., 1., 0.};
+        for (auto i = 0; i < p.rows(); ++i)
+        {
+            if (mesh.is_fixed(i) || p(i, 1) >= floor_height_ + thickness_)
+                continue;
+
+            auto const vi = static_cast<half_space_constraint_t::index_type>(i);
+            contacts.push_back(
+                std::make_unique<half_space_constraint_t>(
+                    std::initializer_list<half_space_constraint_t::index_type>{vi},
+                    contact_wi_,
+                    up,
+                    floor_height_));
+        }
+    }
+
+    if (is_self_collision_active_ && mesh.faces().rows() > 0)
+        detect_self_collisions(mesh, p, contacts);
+
+    return contacts;
+}
+
+void collision_detector_t::detect_self_collisions(
+    deformable_mesh_t const& mesh,
+    Eigen::MatrixXd const& p,
+    contacts_type& contacts)
+{
+    auto const& F  = mesh.faces();
+    auto const& p0 = mesh.positions(); // positions at the start of the step
+
+    if (spatial_hash_.cell_size() <= scalar_type{0.})
+    {
+        // cells of about two surface edges hold a handful of faces each
+        scalar_type total_edge_length{0.};
+        for (auto f = 0; f < F.rows(); ++f)
+            for (int e = 0; e < 3; ++e)
+                total_edge_length += (p0.row(F(f, e)) - p0.row(F(f, (e + 1) % 3))).norm();
+
+        scalar_type const mean_edge_length = total_edge_length / (3. * F.rows());
+        spatial_hash_.set_cell_size(std::max(2. * mean_edge_length, 4. * thickness_));
+    }
+    spatial_hash_.update(p0, p, F, thickness_);
+
+    std::vector<int> surface_vertices{F.data(), F.data() + F.size()};
+    std::sort(surface_vertices.begin(), surface_vertices.end());
+    surface_vertices.erase(
+        std::unique(surface_vertices.begin(), surface_vertices.end()),
+        surface_vertices.end());
+
+    struct contact_t
+    {
+        Eigen::Vector3d n    = Eigen::Vector3d::Zero();
+        scalar_type d        = scalar_type{0.};
+        scalar_type distance = std::numeric_limits<scalar_type>::max();
+    };
+
+    // narrow phase, each vertex keeps its closest face
+    std::vector<contact_t> closest(surface_vertices.size());
+    auto const count = static_cast<std::ptrdiff_t>(surface_vertices.size());
+    parallel_for(0, count, [&](std::ptrdiff_t s) {
+        int const vi = surface_vertices[static_cast<std::size_t>(s)];
+        if (mesh.is_fixed(vi))
+            return;
+
+        Eigen::Vector3d const x  = p.row(vi).transpose();
+        Eigen::Vector3d const x0 = p0.row(vi).transpose();
+        auto const faces         = spatial_hash_.faces_in(x0.cwiseMin(x), x0.cwiseMax(x));
+
+        auto& contact = closest[static_cast<std::size_t>(s)];
+        for (int const f : faces)
+        {
+            if (F(f, 0) == vi || F(f, 1) == vi || F(f, 2) == vi)
+                continue;
+
+            // The contact plane is the face's plane at the start of the step, where
+            // the surface does not intersect itself. Planes of the predicted faces
+            // may already be crossed by both sides of a contact.
+            Eigen::Vector3d const a     = p0.row(F(f, 0)).transpose();
+            Eigen::Vector3d const b     = p0.row(F(f, 1)).transpose();
+            Eigen::Vector3d const c     = p0.row(F(f, 2)).transpose();
+            Eigen::Vector3d const cross = (b - a).cross(c - a);
+            scalar_type const area2     = cross.norm();
+            if (area2 <= scalar_type{0.})
+                continue;
+
+            Eigen::Vector3d n          = cross / area2;
+            scalar_type const distance = n.dot(x - a);
+            scalar_type const side     = n.dot(x0 - a) >= 0. ? 1. : -1.;
+            if (side * distance >= thickness_ || std::abs(distance) >= contact.distance)
+                continue;
+
+            // the vertex must project into the face
+            Eigen::Vector3d const y = x - distance * n;
+            scalar_type const u     = (c - b).cross(y - b).dot(n);
+            scalar_type const v     = (a - c).cross(y - c).dot(n);
+            scalar_type const w     = (b - a).cross(y - a).dot(n);
+            if (u < 0. || v < 0. || w < 0.)
+                continue;
+
+            n *= side;
+            contact.n        = n;
+            contact.d        = n.dot(a) + thickness_;
+            contact.distance = std::abs(distance);
+        }
+    });
+
+    using index_type = half_space_constraint_t::index_type;
+    for (std::size_t s = 0u; s < surface_vertices.size(); ++s)
+    {
+        auto const& contact = closest[s];
+        if (contact.distance == std::numeric_limits<scalar_type>::max())
+            continue;
+
+        auto const vi = static_cast<index_type>(surface_vertices[s]);
+        contacts.push_back(
+            std::make_unique<half_space_constraint_t>(
+                std::initializer_list<index_type>{vi},
+                contact_wi_,
+                contact.n,
+                contact.d));
+    }
+}
+
+} // namespace pd
@@ -0,0 +1,431 @@
+#include "pd/communicator.h"
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+#if defined(PD_WITH_MPI)
+#include <mpi.h>
+#endif
+
+namespace pd {
+
+void local_transport_t::send(
+    int source,
+    int destination,
+    int tag,
+    std::vector<double> const& data)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        mailboxes_[mailbox_key_type{source, destination, tag}].push_back(data);
+    }
+    condition_.notify_all();
+}
+
+void local_transport_t::receive(int source, int destination, int tag, std::vector<double>& data)
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    auto& mailbox = mailboxes_[mailbox_key_type{source, destination, tag}];
+    condition_.wait(lock, [&]() { return !mailbox.empty(); });
+    data = std::move(mailbox.front());
+    mailbox.pop_front();
+}
+
+double local_transport_t::all_reduce_sum(int rank, double value)
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    unsigned const generation                      = reduce_generation_;
+    reduce_values_[static_cast<std::size_t>(rank)] = value;
+    if (++reduce_arrived_ == size_)
+    {
+        // the last rank to arrive sums in rank order, publishes the sum and releases
+        // the others
+        double sum = reduce_values_.front();
+        for (std::size_t r = 1u; r < reduce_values_.size(); ++r)
+            sum += reduce_values_[r];
+        reduce_result_  = sum;
+        reduce_arrived_ = 0;
+        ++reduce_generation_;
+        condition_.notify_all();
+        return reduce_result_;
+    }
+
+    condition_.wait(lock, [&]() { return reduce_generation_ != generation; });
+    return reduce_result_;
+}
+
+void run_local_ranks(int size, std::function<void(communicator_t&)> const& f)
+{
+    local_transport_t transport(size);
+
+    std::vector<std::thread> ranks;
+    ranks.reserve(static_cast<std::size_t>(size));
+    for (int rank = 0; rank < size; ++rank)
+    {
+        ranks.emplace_back([&transport, &f, rank]() {
+            local_communicator_t communicator(transport, rank);
+            f(communicator);
+        });
+    }
+    for (auto& rank : ranks)
+        rank.join();
+}
+
+#if !defined(_WIN32)
+
+namespace {
+
+struct message_header_t
+{
+    std::int64_t tag;
+    std::uint64_t count; ///< Number of doubles following the header
+};
+
+[[noreturn]] void terminate_rank(int rank, char const* what)
+{
+    std::fprintf(stderr, "rank %d: %s\n", rank, what);
+    std::fflush(stderr);
+    std::_Exit(EXIT_FAILURE);
+}
+
+} // namespace
+
+socket_communicator_t::socket_communicator_t(int rank, std::vector<int> sockets)
+    : rank_(rank), peers_(sockets.size())
+{
+    for (std::size_t r = 0u; r < sockets.size(); ++r)
+    {
+        peers_[r].socket = sockets[r];
+        if (sockets[r] >= 0)
+            ::fcntl(sockets[r], F_SETFL, ::fcntl(sockets[r], F_GETFL) | O_NONBLOCK);
+    }
+}
+
+socket_communicator_t::~socket_communicator_t()
+{
+    for (auto const& peer : peers_)
+        if (peer.socket >= 0)
+            ::close(peer.socket);
+}
+
+void socket_communicator_t::send(int destination, int tag, buffer_type const& data)
+{
+    message_header_t const header{tag, static_cast<std::uint64_t>(data.size())};
+    std::vector<char> bytes(sizeof(header) + sizeof(double) * data.size());
+    std::memcpy(bytes.data(), &header, sizeof(header));
+    if (!data.empty())
+        std::memcpy(bytes.data() + sizeof(header), data.data(), sizeof(double) * data.size());
+
+    auto const& peer    = peers_[static_cast<std::size_t>(destination)];
+    std::size_t written = 0u;
+    while (written < bytes.size())
+    {
+        auto const count =
+            ::send(peer.socket, bytes.data() + written, bytes.size() - written, MSG_NOSIGNAL);
+        if (count > 0)
+        {
+            written += static_cast<std::size_t>(count);
+            continue;
+        }
+        if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+            terminate_rank(rank_, std::strerror(errno));
+
+        // the destination may itself be sending to us, read its messages meanwhile
+        poll_peers(destination);
+    }
+}
+
+void socket_communicator_t::receive(int source, int tag, buffer_type& data)
+{
+    auto& peer = peers_[static_cast<std::size_t>(source)];
+    for (;;)
+    {
+        auto const it = std::find_if(
+            peer.messages.begin(),
+            peer.messages.end(),
+            [tag](message_t const& message) { return message.tag == tag; });
+        if (it != peer.messages.end())
+        {
+            data = std::move(it->data);
+            peer.messages.erase(it);
+            return;
+        }
+        if (peer.is_closed)
+            terminate_rank(rank_, "receive from a rank which closed its connection");
+
+        poll_peers(-1);
+    }
+}
+
+double socket_communicator_t::all_reduce_sum(double value)
+{
+    int constexpr reduce_tag = -1;
+    int constexpr result_tag = -2;
+
+    buffer_type buffer{value};
+    if (rank_ != 0)
+    {
+        send(0, reduce_tag, buffer);
+        receive(0, result_tag, buffer);
+        return buffer.front();
+    }
+
+    double sum = value;
+    for (int source = 1; source < size(); ++source)
+    {
+        receive(source, reduce_tag, buffer);
+        sum += buffer.front();
+    }
+    buffer.assign(1u, sum);
+    for (int destination = 1; destination < size(); ++destination)
+        send(destination, result_tag, buffer);
+
+    return sum;
+}
+
+bool socket_communicator_t::poll_peers(int destination)
+{
+    std::vector<pollfd> fds;
+    std::vector<std::size_t> fd_peers;
+    for (std::size_t r = 0u; r < peers_.size(); ++r)
+    {
+        auto const& peer   = peers_[r];
+        bool const is_open = peer.socket >= 0 && !peer.is_closed;
+        bool const is_destination = static_cast<int>(r) == destination;
+        if (!is_open && !is_destination)
+            continue;
+
+        short events = is_open ? POLLIN : 0;
+        if (is_destination)
+            events |= POLLOUT;
+        fds.push_back(pollfd{peer.socket, events, 0});
+        fd_peers.push_back(r);
+    }
+    if (fds.empty())
+        terminate_rank(rank_, "every other rank closed its connection");
+
+    if (::poll(fds.data(), fds.size(), -1) < 0)
+    {
+        if (errno == EINTR)
+            return false;
+        terminate_rank(rank_, std::strerror(errno));
+    }
+
+    bool can_send = false;
+    for (std::size_t i = 0u; i < fds.size(); ++i)
+    {
+        auto& peer = peers_[fd_peers[i]];
+        if ((fds[i].revents & (POLLIN | POLLHUP | POLLERR)) != 0 && !peer.is_closed)
+            read_messages(peer);
+        if (static_cast<int>(fd_peers[i]) == destination && (fds[i].revents & POLLOUT) != 0)
+            can_send = true;
+    }
+    return can_send;
+}
+
+void socket_communicator_t::read_messages(peer_t& peer)
+{
+    std::array<char, 1u << 16u> chunk;
+    for (;;)
+    {
+        auto const count = ::recv(peer.socket, chunk.data(), chunk.size(), 0);
+        if (count > 0)
+        {
+            peer.incoming.insert(peer.incoming.end(), chunk.data(), chunk.data() + count);
+            continue;
+        }
+        if (count == 0)
+        {
+            // the peer finished, the messages it sent before remain receivable
+            peer.is_closed = true;
+            break;
+        }
+        if (errno == EINTR)
+            continue;
+        if (errno == EAGAIN || errno == EWOULDBLOCK)
+            break;
+
+        terminate_rank(rank_, std::strerror(errno));
+    }
+
+    std::size_t offset = 0u;
+    while (peer.incoming.size() - offset >= sizeof(message_header_t))
+    {
+        message_header_t header{};
+        std::memcpy(&header, peer.incoming.data() + offset, sizeof(header));
+        std::size_t const size = sizeof(header) + sizeof(double) * header.count;
+        if (peer.incoming.size() - offset < size)
+            break;
+
+        message_t message{static_cast<int>(header.tag), buffer_type(header.count)};
+        if (header.count > 0u)
+        {
+            std::memcpy(
+                message.data.data(),
+                peer.incoming.data() + offset + sizeof(header),
+                sizeof(double) * header.count);
+        }
+        peer.messages.push_back(std::move(message));
+        offset += size;
+    }
+    peer.incoming.erase(peer.incoming.begin(), peer.incoming.begin() + offset);
+}
+
+bool run_local_processes(int size, std::function<bool(communicator_t&)> const& f)
+{
+    // sockets[r][s] is rank r's end of the connection between ranks r and s
+    std::vector<std::vector<int>> sockets(
+        static_cast<std::size_t>(size),
+        std::vector<int>(static_cast<std::size_t>(size), -1));
+    auto const close_sockets = [&](int except_rank) {
+        for (int r = 0; r < size; ++r)
+        {
+            if (r == except_rank)
+                continue;
+            for (auto& socket : sockets[static_cast<std::size_t>(r)])
+            {
+                if (socket >= 0)
+                    ::close(socket);
+                socket = -1;
+            }
+        }
+    };
+
+    bool is_connected = true;
+    for (int r = 0; r < size && is_connected; ++r)
+    {
+        for (int s = r + 1; s < size && is_connected; ++s)
+        {
+            int pair[2];
+            is_connected = ::socketpair(AF_UNIX, SOCK_STREAM, 0, pair) == 0;
+            if (!is_connected)
+                break;
+            sockets[static_cast<std::size_t>(r)][static_cast<std::size_t>(s)] = pair[0];
+            sockets[static_cast<std::size_t>(s)][static_cast<std::size_t>(r)] = pair[1];
+        }
+    }
+    if (!is_connected)
+    {
+        close_sockets(-1);
+        return false;
+    }
+
+    // buffered output would otherwise be written once by every process
+    std::fflush(nullptr);
+
+    std::vector<pid_t> processes;
+    for (int rank = 0; rank < size; ++rank)
+    {
+        pid_t const process = ::fork();
+        if (process < 0)
+            break;
+        if (process == 0)
+        {
+            close_sockets(rank);
+            bool is_success = false;
+            {
+                socket_communicator_t communicator(rank, sockets[static_cast<std::size_t>(rank)]);
+                is_success = f(communicator);
+            }
+            std::fflush(nullptr);
+            std::_Exit(is_success ? EXIT_SUCCESS : EXIT_FAILURE);
+        }
+        processes.push_back(process);
+    }
+
+    // ranks whose peers failed to start see their connections close
+    close_sockets(-1);
+
+    bool is_success = processes.size() == static_cast<std::size_t>(size);
+    for (pid_t const process : processes)
+    {
+        int status = 0;
+        while (::waitpid(process, &status, 0) < 0 && errno == EINTR)
+            ;
+        is_success = is_success && WIFEXITED(status) && WEXITSTATUS(status) == EXIT_SUCCESS;
+    }
+    return is_success;
+}
+
+#endif // !_WIN32
+
+#if defined(PD_WITH_MPI)
+
+struct mpi_communicator_t::pending_send_t
+{
+    std::vector<double> data;
+    MPI_Request request;
+};
+
+mpi_communicator_t::mpi_communicator_t()
+{
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank_);
+    MPI_Comm_size(MPI_COMM_WORLD, &size_);
+}
+
+mpi_communicator_t::~mpi_communicator_t()
+{
+    complete_sends();
+}
+
+void mpi_communicator_t::send(int destination, int tag, buffer_type const& data)
+{
+    // keep the buffer alive until the send completed, such that send() does not block
+    auto pending = std::make_unique<pending_send_t>(pending_send_t{data, MPI_REQUEST_NULL});
+    MPI_Isend(
+        pending->data.data(),
+        static_cast<int>(pending->data.size()),
+        MPI_DOUBLE,
+        destination,
+        tag,
+        MPI_COMM_WORLD,
+        &pending->request);
+    pending_sends_.push_back(std::move(pending));
+}
+
+void mpi_communicator_t::receive(int source, int tag, buffer_type& data)
+{
+    MPI_Status status;
+    MPI_Probe(source, tag, MPI_COMM_WORLD, &status);
+    int count = 0;
+    MPI_Get_count(&status, MPI_DOUBLE, &count);
+    data.resize(static_cast<std::size_t>(count));
+    MPI_Recv(data.data(), count, MPI_DOUBLE, source, tag, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+}
+
+double mpi_communicator_t::all_reduce_sum(double value)
+{
+    std::vector<double> values(static_cast<std::size_t>(size_));
+    MPI_Allgather(&value, 1, MPI_DOUBLE, values.data(), 1, MPI_DOUBLE, MPI_COMM_WORLD);
+    double sum = values.front();
+    for (std::size_t r = 1u; r < values.size(); ++r)
+        sum += values[r];
+    // every halo sent before the reduction has been received by now
+    complete_sends();
+    return sum;
+}
+
+void mpi_communicator_t::complete_sends()
+{
+    for (auto& pending : pending_sends_)
+        MPI_Wait(&pending->request, MPI_STATUS_IGNORE);
+
+    pending_sends_.clear();
+}
+
+#endif // PD_WITH_MPI
+
+} // namespace pd
@@ -1,21 +1,299 @@
 #include "pd/deformable_mesh.h"
 
 #include "pd/deformation_gradient_constraint.h"
+#include "pd/bending_constraint.h"
 #include "pd/corotated_deformation_gradient_constraint.h"
 #include "pd/shape_targeting_constraint.h"
 #include "pd/edge_length_constraint.h"
+#include "pd/isometric_bending_constraint.h"
+#include "pd/parallel.h"
 #include "pd/positional_constraint.h"
 #include "pd/strain_constraint.h"
+#include "pd/triangle_strain_constraint.h"
 
+#include <algorithm>
 #include <array>
-#include <igl/barycenter.h>
+#include <cassert>
 #include <igl/boundary_facets.h>
 #include <igl/copyleft/tetgen/cdt.h>
 #include <igl/copyleft/tetgen/tetrahedralize.h>
+#include <igl/edge_flaps.h>
 #include <igl/edges.h>
 #include <igl/winding_number.h>
+#include <type_traits>
 
 namespace pd {
+namespace detail {
+
+/**
+ * Computes the reverse Cuthill-McKee ordering of the graph whose edges connect
+ * vertices sharing a cell (row of C). Returns the old vertex index of each new vertex.
+ */
+std::vector<int> reverse_cuthill_mckee(int vertex_count, Eigen::MatrixXi const& C)
+{
+    std::vector<std::vector<int>> adjacency(static_cast<std::size_t>(vertex_count));
+    for (auto c = 0; c < C.rows(); ++c)
+    {
+        for (auto i = 0; i < C.cols(); ++i)
+        {
+            for (auto j = 0; j < C.cols(); ++j)
+            {
+                if (i != j)
+                    adjacency[C(c, i)].push_back(C(c, j));
+            }
+        }
+    }
+    for (auto& neighbours : adjacency)
+    {
+        std::sort(neighbours.begin(), neighbours.end());
+        neighbours.erase(std::unique(neighbours.begin(), neighbours.end()), neighbours.end());
+    }
+
+    auto const degree = [&](int v) {
+        return adjacency[v].size();
+    };
+
+    std::vector<int> by_degree(static_cast<std::size_t>(vertex_count));
+    std::iota(by_degree.begin(), by_degree.end(), 0);
+    std::stable_sort(by_degree.begin(), by_degree.end(), [&](int a, int b) {
+        return degree(a) < degree(b);
+    });
+
+    std::vector<int> order;
+    order.reserve(static_cast<std::size_t>(vertex_count));
+    std::vector<bool> visited(static_cast<std::size_t>(vertex_count), false);
+    std::vector<int> neighbours;
+    // each connected component is traversed breadth first from its vertex of minimum degree,
+    // visiting unvisited neighbours in order of increasing degree
+    for (int const start : by_degree)
+    {
+        if (visited[start])
+            continue;
+
+        visited[start]           = true;
+        std::size_t const offset = order.size();
+        order.push_back(start);
+        for (std::size_t k = offset; k < order.size(); ++k)
+        {
+            neighbours.clear();
+            for (int const n : adjacency[order[k]])
+            {
+                if (!visited[n])
+                    neighbours.push_back(n);
+            }
+            std::stable_sort(neighbours.begin(), neighbours.end(), [&](int a, int b) {
+                return degree(a) < degree(b);
+            });
+            for (int const n : neighbours)
+            {
+                visited[n] = true;
+                order.push_back(n);
+            }
+        }
+    }
+
+    std::reverse(order.begin(), order.end());
+    return order;
+}
+
+/**
+ * Renumbers the vertex indices of each cell and sorts cells by their smallest vertex
+ * index. Stores the old cell index of each new cell in old_cell_index, if given.
+ */
+Eigen::MatrixXi renumber_cells(
+    Eigen::MatrixXi const& C,
+    std::vector<int> const& new_index,
+    std::vector<int>* old_cell_index = nullptr)
+{
+    Eigen::MatrixXi R(C.rows(), C.cols());
+    for (auto c = 0; c < C.rows(); ++c)
+        for (auto i = 0; i < C.cols(); ++i)
+            R(c, i) = new_index[C(c, i)];
+
+    std::vector<int> cells(static_cast<std::size_t>(C.rows()));
+    std::iota(cells.begin(), cells.end(), 0);
+    std::stable_sort(cells.begin(), cells.end(), [&](int a, int b) {
+        return R.row(a).minCoeff() < R.row(b).minCoeff();
+    });
+
+    Eigen::MatrixXi sorted(C.rows(), C.cols());
+    for (std::size_t c = 0u; c < cells.size(); ++c)
+        sorted.row(c) = R.row(cells[c]);
+
+    if (old_cell_index != nullptr)
+        *old_cell_index = std::move(cells);
+
+    return sorted;
+}
+
+/**
+ * Returns the hinges (v1, v2, v3, v4) of the interior edges (v1, v2) of the triangle
+ * mesh F, where v3 and v4 are the vertices opposite to the edge in its two faces.
+ */
+std::vector<std::array<std::uint32_t, 4u>> interior_hinges(Eigen::MatrixXi const& F)
+{
+    Eigen::MatrixXi E, EF, EI;
+    Eigen::VectorXi EMAP;
+    igl::edge_flaps(F, E, EMAP, EF, EI);
+
+    std::vector<std::array<std::uint32_t, 4u>> hinges;
+    hinges.reserve(static_cast<std::size_t>(E.rows()));
+    for (auto e = 0; e < E.rows(); ++e)
+    {
+        // boundary edges have no hinge
+        if (EF(e, 0) < 0 || EF(e, 1) < 0)
+            continue;
+
+        hinges.push_back(
+            {static_cast<std::uint32_t>(E(e, 0)),
+             static_cast<std::uint32_t>(E(e, 1)),
+             static_cast<std::uint32_t>(F(EF(e, 0), EI(e, 0))),
+             static_cast<std::uint32_t>(F(EF(e, 1), EI(e, 1)))});
+    }
+    return hinges;
+}
+
+/**
+ * Appends the constraints make(i) for i in [0, count) to constraints. Constructors
+ * precompute the constraints' rest state, so they run in parallel.
+ */
+template <class MakeConstraint>
+void append_constraints(
+    deformable_mesh_t::constraints_type& constraints,
+    std::ptrdiff_t count,
+    MakeConstraint const& make)
+{
+    auto const first = constraints.size();
+    constraints.resize(first + static_cast<std::size_t>(count));
+    parallel_for(0, count, [&](std::ptrdiff_t i) {
+        constraints[first + static_cast<std::size_t>(i)] = make(i);
+    });
+}
+
+/**
+ * Whether constraints of this type are built on one element, such that they follow
+ * their element in topology edits
+ */
+bool is_element_constraint(constraint_t const& constraint, Eigen::Index element_size)
+{
+    auto const type = constraint.type();
+    auto const size = static_cast<Eigen::Index>(constraint.indices().size());
+    bool const is_element_type =
+        type == constraint_type_t::deformation_gradient ||
+        type == constraint_type_t::corotated_deformation_gradient ||
+        type == constraint_type_t::shape_targeting || type == constraint_type_t::strain ||
+        type == constraint_type_t::triangle_strain;
+    return is_element_type && size == element_size;
+}
+
+std::vector<std::uint32_t> sorted_indices(std::vector<std::uint32_t> indices)
+{
+    std::sort(indices.begin(), indices.end());
+    return indices;
+}
+
+std::vector<std::uint32_t> sorted_indices(Eigen::MatrixXi const& E, int e)
+{
+    std::vector<std::uint32_t> indices(static_cast<std::size_t>(E.cols()));
+    for (auto i = 0; i < E.cols(); ++i)
+        indices[i] = static_cast<std::uint32_t>(E(e, i));
+    return sorted_indices(std::move(indices));
+}
+
+/**
+ * The elements of E incident to each of the vertex_count vertices
+ */
+std::vector<std::vector<int>> incident_elements(int vertex_count, Eigen::MatrixXi const& E)
+{
+    std::vector<std::vector<int>> incident(static_cast<std::size_t>(vertex_count));
+    for (auto e = 0; e < E.rows(); ++e)
+        for (auto i = 0; i < E.cols(); ++i)
+            incident[E(e, i)].push_back(e);
+    return incident;
+}
+
+/**
+ * Whether the elements E contain the edge, face or hinge of a constraint not built on
+ * one element, that is, whether every vertex of it lies in an element sharing
+ * min(|indices|, 3) vertices with it. Hinges span two faces, which share 3 of their
+ * vertices each.
+ */
+bool is_supported(
+    std::vector<std::uint32_t> const& indices,
+    Eigen::MatrixXi const& E,
+    std::vector<std::vector<int>> const& incident)
+{
+    auto const shared = std::min<std::size_t>(indices.size(), 3u);
+    for (auto const vi : indices)
+    {
+        bool const is_vertex_supported =
+            std::any_of(incident[vi].begin(), incident[vi].end(), [&](int e) {
+                std::size_t count = 0u;
+                for (auto i = 0; i < E.cols(); ++i)
+                    count += std::count(
+                        indices.begin(),
+                        indices.end(),
+                        static_cast<std::uint32_t>(E(e, i)));
+                return count >= shared;
+            });
+        if (!is_vertex_supported)
+            return false;
+    }
+    return true;
+}
+
+/**
+ * Outward oriented boundary faces of the tetrahedra T with vertex positions V
+ */
+Eigen::MatrixXi boundary_faces(Eigen::MatrixXi const& T, Eigen::MatrixXd const& V)
+{
+    // the face opposite to each vertex of a tetrahedron
+    int constexpr faces[4][3] = {{1, 2, 3}, {0, 2, 3}, {0, 1, 3}, {0, 1, 2}};
+
+    std::vector<std::pair<std::array<int, 3u>, std::array<int, 4u>>> keyed_faces;
+    keyed_faces.reserve(4u * static_cast<std::size_t>(T.rows()));
+    for (auto t = 0; t < T.rows(); ++t)
+    {
+        for (auto f = 0; f < 4; ++f)
+        {
+            std::array<int, 3u> key{T(t, faces[f][0]), T(t, faces[f][1]), T(t, faces[f][2])};
+            std::array<int, 4u> const face{key[0], key[1], key[2], T(t, f)};
+            std::sort(key.begin(), key.end());
+            keyed_faces.emplace_back(key, face);
+        }
+    }
+    std::sort(keyed_faces.begin(), keyed_faces.end(), [](auto const& a, auto const& b) {
+        return a.first < b.first;
+    });
+
+    std::vector<Eigen::RowVector3i> boundary;
+    for (std::size_t i = 0u; i < keyed_faces.size();)
+    {
+        std::size_t j = i + 1u;
+        while (j < keyed_faces.size() && keyed_faces[j].first == keyed_faces[i].first)
+            ++j;
+
+        if (j == i + 1u)
+        {
+            auto const& [a, b, c, d] = keyed_faces[i].second;
+            Eigen::RowVector3d const ab = V.row(b) - V.row(a);
+            Eigen::RowVector3d const ac = V.row(c) - V.row(a);
+            Eigen::RowVector3d const ad = V.row(d) - V.row(a);
+            if (ab.cross(ac).dot(ad) < 0.)
+                boundary.emplace_back(a, b, c);
+            else
+                boundary.emplace_back(a, c, b);
+        }
+        i = j;
+    }
+
+    Eigen::MatrixXi F(static_cast<Eigen::Index>(boundary.size()), 3);
+    for (std::size_t f = 0u; f < boundary.size(); ++f)
+        F.row(f) = boundary[f];
+    return F;
+}
+
+} // namespace detail
 
 void deformable_mesh_t::tetrahedralize(Eigen::MatrixXd const& V, Eigen::MatrixXi const& F)
 {
@@ -29,11 +307,16 @@ void deformable_mesh_t::tetrahedralize(Eigen::MatrixXd const& V, Eigen::MatrixXi
     TT = TT.rowwise().reverse().eval();
     TF = TF.rowwise().reverse().eval();
 
-    Eigen::MatrixXd BC;
-    igl::barycenter(TV, TT, BC);
-
-    Eigen::VectorXd W;
-    igl::winding_number(V, F, BC, W);
+    // keep the tetrahedra inside the surface, whose barycenters have winding number 1.
+    // Every barycenter's winding number sums over all faces, so they are computed in
+    // parallel on the shared thread pool instead of libigl's own threads.
+    Eigen::VectorXd W(TT.rows());
+    parallel_for(0, TT.rows(), [&](std::ptrdiff_t t) {
+        Eigen::RowVector3d barycenter = Eigen::RowVector3d::Zero();
+        for (auto j = 0; j < 4; ++j)
+            barycenter += TV.row(TT(t, j));
+        W(t) = igl::winding_number(V, F, (barycenter / 4.).eval());
+    });
 
     Eigen::MatrixXi IT((W.array() > 0.5).count(), 4);
     std::size_t k = 0u;
@@ -53,6 +336,250 @@ void deformable_mesh_t::tetrahedralize(Eigen::MatrixXd const& V, Eigen::MatrixXi
     this->E_ = IT;
     this->F_ = G;
     this->constraints_.clear();
+    this->input_index_.clear();
+    this->vertex_index_.clear();
+    this->materials_ = material_field_t{};
+}
+
+void deformable_mesh_t::reorder_vertices()
+{
+    auto const N = static_cast<int>(p_.rows());
+    if (N == 0)
+        return;
+
+    // triangle meshes store their faces as elements, so the elements suffice
+    // to describe connectivity whenever there are any
+    Eigen::MatrixXi const& cells = E_.rows() > 0 ? E_ : F_;
+
+    std::vector<int> const old_index = detail::reverse_cuthill_mckee(N, cells);
+    std::vector<int> new_index(static_cast<std::size_t>(N));
+    for (int v = 0; v < N; ++v)
+        new_index[old_index[v]] = v;
+
+    auto const permute_rows = [&](auto const& M) {
+        std::decay_t<decltype(M)> P(M.rows(), M.cols());
+        for (int v = 0; v < N; ++v)
+            P.row(v) = M.row(old_index[v]);
+        return P;
+    };
+
+    p0_ = permute_rows(p0_);
+    p_  = permute_rows(p_);
+    v_  = permute_rows(v_);
+    m_  = permute_rows(m_);
+
+    std::vector<bool> fixed(fixed_.size());
+    for (int v = 0; v < N; ++v)
+        fixed[v] = fixed_[old_index[v]];
+    fixed_ = std::move(fixed);
+
+    std::vector<int> old_element_index;
+    E_ = detail::renumber_cells(E_, new_index, &old_element_index);
+    F_ = detail::renumber_cells(F_, new_index);
+    materials_.permute(old_element_index);
+
+    // compose with any previous reordering to keep mapping back to the input numbering
+    std::vector<int> input_index(static_cast<std::size_t>(N));
+    for (int v = 0; v < N; ++v)
+        input_index[v] = vertex_to_input_index(old_index[v]);
+    input_index_ = std::move(input_index);
+    vertex_index_.assign(static_cast<std::size_t>(N), 0);
+    for (int v = 0; v < N; ++v)
+        vertex_index_[input_index_[v]] = v;
+
+    constraints_.clear();
+}
+
+void deformable_mesh_t::sort_constraints_by_locality()
+{
+    auto const min_index = [](std::unique_ptr<constraint_t> const& c) {
+        auto const& indices = c->indices();
+        return *std::min_element(indices.begin(), indices.end());
+    };
+    std::stable_sort(
+        constraints_.begin(),
+        constraints_.end(),
+        [&](std::unique_ptr<constraint_t> const& a, std::unique_ptr<constraint_t> const& b) {
+            return min_index(a) < min_index(b);
+        });
+}
+
+void deformable_mesh_t::remove_elements(std::vector<int> const& elements)
+{
+    if (elements.empty())
+        return;
+
+    auto const N = static_cast<int>(p_.rows());
+    std::vector<bool> is_removed(static_cast<std::size_t>(E_.rows()), false);
+    std::vector<bool> is_affected(static_cast<std::size_t>(N), false);
+    std::vector<std::vector<std::uint32_t>> removed_elements;
+    for (auto const e : elements)
+    {
+        assert(e >= 0 && e < E_.rows());
+        if (is_removed[e])
+            continue;
+
+        is_removed[e] = true;
+        removed_elements.push_back(detail::sorted_indices(E_, e));
+        for (auto i = 0; i < E_.cols(); ++i)
+            is_affected[E_(e, i)] = true;
+    }
+    std::sort(removed_elements.begin(), removed_elements.end());
+
+    elements_type E(E_.rows() - static_cast<Eigen::Index>(removed_elements.size()), E_.cols());
+    for (auto e = 0, k = 0; e < E_.rows(); ++e)
+        if (!is_removed[e])
+            E.row(k++) = E_.row(e);
+    E_ = std::move(E);
+    materials_.remove(is_removed);
+
+    auto const incident = detail::incident_elements(N, E_);
+    auto const is_lost  = [&](std::unique_ptr<constraint_t> const& constraint) {
+        auto const& indices = constraint->indices();
+        bool const is_touched =
+            std::any_of(indices.begin(), indices.end(), [&](auto vi) { return is_affected[vi]; });
+        if (!is_touched || constraint->type() == constraint_type_t::positional)
+            return false;
+
+        if (detail::is_element_constraint(*constraint, E_.cols()))
+            return std::binary_search(
+                removed_elements.begin(),
+                removed_elements.end(),
+                detail::sorted_indices(indices));
+
+        return !detail::is_supported(indices, E_, incident);
+    };
+    constraints_.erase(
+        std::remove_if(constraints_.begin(), constraints_.end(), is_lost),
+        constraints_.end());
+
+    update_faces();
+}
+
+int deformable_mesh_t::split_vertex(int vi, std::vector<int> const& elements)
+{
+    auto const N = static_cast<int>(p_.rows());
+    assert(vi >= 0 && vi < N);
+
+    auto const append_row = [&](auto& M) {
+        M.conservativeResize(N + 1, Eigen::NoChange);
+        M.row(N) = M.row(vi);
+    };
+    append_row(p0_);
+    append_row(p_);
+    append_row(v_);
+    // the copies share the vertex's mass, which keeps the total mass
+    m_.conservativeResize(N + 1);
+    m_(vi) *= scalar_type{0.5};
+    m_(N) = m_(vi);
+    fixed_.push_back(fixed_[vi]);
+    if (!input_index_.empty())
+    {
+        // the new vertex is appended to the input numbering as well
+        input_index_.push_back(static_cast<int>(vertex_index_.size()));
+        vertex_index_.push_back(N);
+    }
+
+    std::vector<std::vector<std::uint32_t>> moved_elements;
+    for (auto const e : elements)
+    {
+        assert(e >= 0 && e < E_.rows());
+        moved_elements.push_back(detail::sorted_indices(E_, e));
+        for (auto i = 0; i < E_.cols(); ++i)
+            if (E_(e, i) == vi)
+                E_(e, i) = N;
+    }
+    std::sort(moved_elements.begin(), moved_elements.end());
+
+    auto const incident = detail::incident_elements(N + 1, E_);
+    std::vector<constraint_t::index_type> index_map(static_cast<std::size_t>(N + 1));
+    std::iota(index_map.begin(), index_map.end(), 0u);
+    index_map[vi] = static_cast<constraint_t::index_type>(N);
+
+    std::vector<bool> is_lost(constraints_.size(), false);
+    auto const constraint_count = constraints_.size();
+    for (std::size_t c = 0u; c < constraint_count; ++c)
+    {
+        auto const& indices = constraints_[c]->indices();
+        if (std::find(indices.begin(), indices.end(), vi) == indices.end())
+            continue;
+
+        if (detail::is_element_constraint(*constraints_[c], E_.cols()))
+        {
+            bool const is_moved = std::binary_search(
+                moved_elements.begin(),
+                moved_elements.end(),
+                detail::sorted_indices(indices));
+            if (is_moved)
+                constraints_[c] = constraints_[c]->remapped(index_map);
+            continue;
+        }
+
+        // positional constraints pin both copies
+        auto split = constraints_[c]->remapped(index_map);
+        bool const is_kept =
+            constraints_[c]->type() == constraint_type_t::positional ||
+            detail::is_supported(indices, E_, incident);
+        bool const is_split =
+            split->type() == constraint_type_t::positional ||
+            detail::is_supported(split->indices(), E_, incident);
+
+        if (is_split && is_kept)
+            constraints_.push_back(std::move(split));
+        else if (is_split)
+            constraints_[c] = std::move(split);
+        else if (!is_kept)
+            is_lost[c] = true;
+    }
+
+    std::size_t kept = 0u;
+    for (std::size_t c = 0u; c < constraints_.size(); ++c)
+        if (c >= is_lost.size() || !is_lost[c])
+            constraints_[kept++] = std::move(constraints_[c]);
+    constraints_.resize(kept);
+
+    update_faces();
+    return N;
+}
+
+void deformable_mesh_t::update_faces()
+{
+    if (E_.cols() == 4)
+        F_ = detail::boundary_faces(E_, p0_);
+    else if (E_.cols() == 3)
+        F_ = E_;
+}
+
+deformable_mesh_t::positions_type deformable_mesh_t::input_ordered_positions() const
+{
+    if (input_index_.empty())
+        return p_;
+
+    positions_type P(p_.rows(), p_.cols());
+    for (auto v = 0; v < p_.rows(); ++v)
+        P.row(input_index_[v]) = p_.row(v);
+
+    return P;
+}
+
+deformable_mesh_t::faces_type deformable_mesh_t::input_ordered_faces() const
+{
+    faces_type F = F_;
+    for (auto f = 0; f < F.rows(); ++f)
+        for (auto i = 0; i < F.cols(); ++i)
+            F(f, i) = vertex_to_input_index(F(f, i));
+
+    return F;
+}
+
+deformable_mesh_t::elements_type deformable_mesh_t::input_ordered_elements() const
+{
+    elements_type E = E_;
+    for (auto e = 0; e < E.rows(); ++e)
+        for (auto i = 0; i < E.cols(); ++i)
+            E(e, i) = vertex_to_input_index(E(e, i));
+
+    return E;
 }
 
 void deformable_mesh_t::constrain_edge_lengths(scalar_type wi)
@@ -63,21 +590,15 @@ void deformable_mesh_t::constrain_edge_lengths(scalar_type wi)
     Eigen::MatrixXi E;
     igl::edges(elements, E);
 
-    for (auto i = 0u; i < E.rows(); ++i)
-    {
+    detail::append_constraints(this->constraints(), E.rows(), [&](std::ptrdiff_t i) {
         auto const edge = E.row(i);
-        auto const e0   = edge(0);
-        auto const e1   = edge(1);
-
-        auto constraint = std::make_unique<edge_length_constraint_t>(
+        return std::make_unique<edge_length_constraint_t>(
             std::initializer_list<std::uint32_t>{
-                static_cast<std::uint32_t>(e0),
-                static_cast<std::uint32_t>(e1)},
+                static_cast<std::uint32_t>(edge(0)),
+                static_cast<std::uint32_t>(edge(1))},
             wi,
             positions);
-
-        this->constraints().push_back(std::move(constraint));
-    }
+    });
 }
 
 void deformable_mesh_t::add_positional_constraint(int vi, scalar_type wi)
@@ -94,20 +615,19 @@ void deformable_mesh_t::constrain_deformation_gradient(scalar_type wi)
     auto const& positions = this->p0();
     auto const& elements  = this->elements();
 
-    for (auto i = 0u; i < elements.rows(); ++i)
-    {
+    detail::append_constraints(this->constraints(), elements.rows(), [&](std::ptrdiff_t i) {
         auto const element = elements.row(i);
-        auto constraint    = std::make_unique<deformation_gradient_constraint_t>(
+        auto const e       = static_cast<std::size_t>(i);
+        return std::make_unique<deformation_gradient_constraint_t>(
             std::initializer_list<std::uint32_t>{
                 static_cast<std::uint32_t>(element(0)),
                 static_cast<std::uint32_t>(element(1)),
                 static_cast<std::uint32_t>(element(2)),
                 static_cast<std::uint32_t>(element(3))},
-            wi,
-            positions);
-
-        this->constraints().push_back(std::move(constraint));
-    }
+            wi * materials_.stiffness(e),
+            positions,
+            materials_(e));
+    });
 }
 
 void deformable_mesh_t::constrain_corotated_deformation_gradient(scalar_type wi)
@@ -115,20 +635,19 @@ void deformable_mesh_t::constrain_corotated_deformation_gradient(scalar_type wi)
     auto const& positions = this->p0();
     auto const& elements  = this->elements();
 
-    for (auto i = 0u; i < elements.rows(); ++i)
-    {
+    detail::append_constraints(this->constraints(), elements.rows(), [&](std::ptrdiff_t i) {
         auto const element = elements.row(i);
-        auto constraint    = std::make_unique<corotated_deformation_gradient_constraint_t>(
+        auto const e       = static_cast<std::size_t>(i);
+        return std::make_unique<corotated_deformation_gradient_constraint_t>(
             std::initializer_list<std::uint32_t>{
                 static_cast<std::uint32_t>(element(0)),
                 static_cast<std::uint32_t>(element(1)),
                 static_cast<std::uint32_t>(element(2)),
                 static_cast<std::uint32_t>(element(3))},
-            wi,
-            positions);
-
-        this->constraints().push_back(std::move(constraint));
-    }
+            wi * materials_.stiffness(e),
+            positions,
+            materials_(e));
+    });
 }
 
 void deformable_mesh_t::constrain_shape_targeting(scalar_type wi)
@@ -136,34 +655,57 @@ void deformable_mesh_t::constrain_shape_targeting(scalar_type wi)
     auto const& positions = this->p0();
     auto const& elements  = this->elements();
 
-    for (auto i = 0u; i < elements.rows(); ++i)
-    {
+    detail::append_constraints(this->constraints(), elements.rows(), [&](std::ptrdiff_t i) {
         auto const element = elements.row(i);
-        auto constraint    = std::make_unique<shape_targeting_constraint_t>(
+        auto const e       = static_cast<std::size_t>(i);
+        return std::make_unique<shape_targeting_constraint_t>(
             std::initializer_list<std::uint32_t>{
                 static_cast<std::uint32_t>(element(0)),
                 static_cast<std::uint32_t>(element(1)),
                 static_cast<std::uint32_t>(element(2)),
                 static_cast<std::uint32_t>(element(3))},
-            wi,
-            positions);
+            wi * materials_.stiffness(e),
+            positions,
+            materials_(e));
+    });
+}
 
-        this->constraints().push_back(std::move(constraint));
-    }
+deformable_mesh_t::scalar_type deformable_mesh_t::elastic_potential() const
+{
+    auto const count = static_cast<std::ptrdiff_t>(constraints_.size());
+    return parallel_sum(0, count, scalar_type{0.}, [this](std::ptrdiff_t i) {
+        return constraints_[static_cast<std::size_t>(i)]->evaluate(p_, m_);
+    });
 }
 
-void deformable_mesh_t::set_target_shape()
+std::size_t deformable_mesh_t::set_shape_targets(std::vector<Eigen::Matrix3d> const& targets)
 {
-    auto const& positions = this->positions();
-    auto const& elements  = this->elements();
-    for (auto& constraint : this->constraints())
-    {
-        // cast to shape_targeting_constraint_t
-        auto shape_targeting_constraint = dynamic_cast<shape_targeting_constraint_t*>(constraint.get());
-        shape_targeting_constraint->set_shape_target(positions);
+    return set_shape_targets([&](std::size_t k) {
+        assert(k < targets.size());
+        return targets[k];
+    });
+}
 
-    }
+std::size_t deformable_mesh_t::set_shape_targets(shape_target_function_type const& target)
+{
+    auto const shape_targeting = shape_targeting_constraints(constraints_);
+
+    auto const count = static_cast<std::ptrdiff_t>(shape_targeting.size());
+    parallel_for(0, count, [&](std::ptrdiff_t k) {
+        shape_targeting[k]->set_shape_target(target(static_cast<std::size_t>(k)));
+    });
+    return shape_targeting.size();
+}
 
+std::size_t deformable_mesh_t::set_shape_targets(positions_type const& pose)
+{
+    auto const shape_targeting = shape_targeting_constraints(constraints_);
+
+    auto const count = static_cast<std::ptrdiff_t>(shape_targeting.size());
+    parallel_for(0, count, [&](std::ptrdiff_t k) {
+        shape_targeting[k]->set_shape_target(pose);
+    });
+    return shape_targeting.size();
 }
 
 
@@ -172,10 +714,9 @@ void deformable_mesh_t::constrain_strain(scalar_type min, scalar_type max, scala
     auto const& positions = this->p0();
     auto const& elements  = this->elements();
 
-    for (auto i = 0u; i < elements.rows(); ++i)
-    {
+    detail::append_constraints(this->constraints(), elements.rows(), [&](std::ptrdiff_t i) {
         auto const element = elements.row(i);
-        auto constraint    = std::make_unique<strain_constraint_t>(
+        return std::make_unique<strain_constraint_t>(
             std::initializer_list<std::uint32_t>{
                 static_cast<std::uint32_t>(element(0)),
                 static_cast<std::uint32_t>(element(1)),
@@ -185,9 +726,57 @@ void deformable_mesh_t::constrain_strain(scalar_type min, scalar_type max, scala
             positions,
             min,
             max);
+    });
+}
 
-        this->constraints().push_back(std::move(constraint));
-    }
+void deformable_mesh_t::constrain_triangle_strain(
+    scalar_type min,
+    scalar_type max,
+    scalar_type wi)
+{
+    auto const& positions = this->p0();
+    auto const& faces     = this->faces();
+
+    detail::append_constraints(this->constraints(), faces.rows(), [&](std::ptrdiff_t i) {
+        auto const face = faces.row(i);
+        return std::make_unique<triangle_strain_constraint_t>(
+            std::initializer_list<std::uint32_t>{
+                static_cast<std::uint32_t>(face(0)),
+                static_cast<std::uint32_t>(face(1)),
+                static_cast<std::uint32_t>(face(2))},
+            wi,
+            positions,
+            min,
+            max);
+    });
+}
+
+void deformable_mesh_t::constrain_bending(scalar_type wi)
+{
+    auto const& positions = this->p0();
+    auto const hinges     = detail::interior_hinges(this->faces());
+    auto const count      = static_cast<std::ptrdiff_t>(hinges.size());
+    detail::append_constraints(this->constraints(), count, [&](std::ptrdiff_t i) {
+        auto const& hinge = hinges[static_cast<std::size_t>(i)];
+        return std::make_unique<bending_constraint_t>(
+            std::initializer_list<std::uint32_t>{hinge[0], hinge[1], hinge[2], hinge[3]},
+            wi,
+            positions);
+    });
+}
+
+void deformable_mesh_t::constrain_isometric_bending(scalar_type wi)
+{
+    auto const& positions = this->p0();
+    auto const hinges     = detail::interior_hinges(this->faces());
+    auto const count      = static_cast<std::ptrdiff_t>(hinges.size());
+    detail::append_constraints(this->constraints(), count, [&](std::ptrdiff_t i) {
+        auto const& hinge = hinges[static_cast<std::size_t>(i)];
+        return std::make_unique<isometric_bending_constraint_t>(
+            std::initializer_list<std::uint32_t>{hinge[0], hinge[1], hinge[2], hinge[3]},
+            wi,
+            positions);
+    });
 }
 
-} // namespace pd
\ No newline at end of file
+} // namespace pd
@@ -0,0 +1,290 @@
+#include "pd/distributed_solver.h"
+
+#include "pd/domain_decomposition.h"
+
+#include <algorithm>
+#include <cmath>
+#include <set>
+
+namespace pd {
+
+mesh_partition_t partition_mesh(deformable_mesh_t const& mesh, int rank_count, int rank)
+{
+    using index_type = constraint_t::index_type;
+
+    auto const& constraints = mesh.constraints();
+    auto const N            = static_cast<int>(mesh.positions().rows());
+
+    // vertices sharing a constraint are adjacent
+    std::vector<std::vector<int>> adjacency(static_cast<std::size_t>(N));
+    for (auto const& constraint : constraints)
+        for (auto const vi : constraint->indices())
+            for (auto const vj : constraint->indices())
+                if (vi != vj)
+                    adjacency[vi].push_back(static_cast<int>(vj));
+    for (auto& neighbours : adjacency)
+    {
+        std::sort(neighbours.begin(), neighbours.end());
+        neighbours.erase(std::unique(neighbours.begin(), neighbours.end()), neighbours.end());
+    }
+
+    std::vector<int> const order = detail::breadth_first_order(adjacency);
+    std::vector<int> owner(static_cast<std::size_t>(N));
+    for (int i = 0; i < N; ++i)
+        owner[static_cast<std::size_t>(order[static_cast<std::size_t>(i)])] =
+            static_cast<int>((static_cast<long long>(i) * rank_count) / N);
+
+    // ghosts of rank r are the vertices of constraints touching r which r does not own
+    std::vector<std::set<int>> ghosts(static_cast<std::size_t>(rank_count));
+    std::vector<std::size_t> local_constraints;
+    for (std::size_t c = 0u; c < constraints.size(); ++c)
+    {
+        auto const& indices = constraints[c]->indices();
+        for (auto const vi : indices)
+        {
+            int const r = owner[vi];
+            for (auto const vj : indices)
+                if (owner[vj] != r)
+                    ghosts[static_cast<std::size_t>(r)].insert(static_cast<int>(vj));
+        }
+
+        bool const touches_rank = std::any_of(indices.begin(), indices.end(), [&](index_type vi) {
+            return owner[vi] == rank;
+        });
+        if (touches_rank)
+            local_constraints.push_back(c);
+    }
+
+    mesh_partition_t partition{};
+    for (int v = 0; v < N; ++v)
+        if (owner[static_cast<std::size_t>(v)] == rank)
+            partition.global_index.push_back(v);
+    partition.owned_count = static_cast<int>(partition.global_index.size());
+    auto const& rank_ghosts = ghosts[static_cast<std::size_t>(rank)];
+    partition.global_index.insert(partition.global_index.end(), rank_ghosts.begin(), rank_ghosts.end());
+
+    auto const L = static_cast<int>(partition.global_index.size());
+    std::vector<index_type> local_index(static_cast<std::size_t>(N), index_type{0u});
+    std::vector<bool> is_local(static_cast<std::size_t>(N), false);
+    for (int i = 0; i < L; ++i)
+    {
+        auto const v                           = static_cast<std::size_t>(partition.global_index[i]);
+        local_index[v]                         = static_cast<index_type>(i);
+        is_local[v]                            = true;
+    }
+
+    // halos are ordered by global vertex index on both sides
+    for (int neighbour = 0; neighbour < rank_count; ++neighbour)
+    {
+        if (neighbour == rank)
+            continue;
+
+        mesh_partition_t::halo_t halo{neighbour, {}, {}};
+        for (int const v : ghosts[static_cast<std::size_t>(neighbour)])
+            if (owner[static_cast<std::size_t>(v)] == rank)
+                halo.send.push_back(static_cast<int>(local_index[static_cast<std::size_t>(v)]));
+        for (int const v : rank_ghosts)
+            if (owner[static_cast<std::size_t>(v)] == neighbour)
+                halo.receive.push_back(static_cast<int>(local_index[static_cast<std::size_t>(v)]));
+
+        if (!halo.send.empty() || !halo.receive.empty())
+            partition.halos.push_back(std::move(halo));
+    }
+
+    auto const local_cells = [&](Eigen::MatrixXi const& C) {
+        std::vector<int> rows;
+        for (int c = 0; c < C.rows(); ++c)
+        {
+            bool is_cell_local = true;
+            for (int j = 0; j < C.cols(); ++j)
+                is_cell_local = is_cell_local && is_local[static_cast<std::size_t>(C(c, j))];
+            if (is_cell_local)
+                rows.push_back(c);
+        }
+
+        Eigen::MatrixXi local(static_cast<Eigen::Index>(rows.size()), C.cols());
+        for (std::size_t r = 0u; r < rows.size(); ++r)
+            for (int j = 0; j < C.cols(); ++j)
+                local(static_cast<Eigen::Index>(r), j) =
+                    static_cast<int>(local_index[static_cast<std::size_t>(C(rows[r], j))]);
+        return local;
+    };
+
+    deformable_mesh_t::positions_type positions(L, 3);
+    deformable_mesh_t::masses_type masses(L);
+    for (int i = 0; i < L; ++i)
+    {
+        positions.row(i) = mesh.positions().row(partition.global_index[i]);
+        masses(i)        = mesh.mass()(partition.global_index[i]);
+    }
+
+    partition.mesh = deformable_mesh_t{
+        positions,
+        local_cells(mesh.faces()),
+        local_cells(mesh.elements()),
+        masses};
+    for (int i = 0; i < L; ++i)
+    {
+        partition.mesh.velocity().row(i) = mesh.velocity().row(partition.global_index[i]);
+        partition.mesh.fixed()[static_cast<std::size_t>(i)] =
+            mesh.is_fixed(partition.global_index[i]);
+    }
+    for (auto const c : local_constraints)
+        partition.mesh.constraints().push_back(constraints[c]->remapped(local_index));
+
+    return partition;
+}
+
+void distributed_solver_t::exchange_halo(vector_type& x) const
+{
+    int constexpr tag = 0;
+
+    communicator_t::buffer_type buffer;
+    for (auto const& halo : partition_.halos)
+    {
+        buffer.resize(3u * halo.send.size());
+        for (std::size_t i = 0u; i < halo.send.size(); ++i)
+            for (int d = 0; d < 3; ++d)
+                buffer[3u * i + d] = x(3 * halo.send[i] + d);
+        communicator_.send(halo.rank, tag, buffer);
+    }
+    for (auto const& halo : partition_.halos)
+    {
+        communicator_.receive(halo.rank, tag, buffer);
+        for (std::size_t i = 0u; i < halo.receive.size(); ++i)
+            for (int d = 0; d < 3; ++d)
+                x(3 * halo.receive[i] + d) = buffer[3u * i + d];
+    }
+}
+
+distributed_solver_t::scalar_type
+distributed_solver_t::dot(vector_type const& a, vector_type const& b) const
+{
+    auto const n = 3 * partition_.owned_count;
+    return communicator_.all_reduce_sum(a.head(n).dot(b.head(n)));
+}
+
+void distributed_solver_t::prepare(scalar_type dt)
+{
+    dt_ = dt;
+
+    auto const& mesh      = partition_.mesh;
+    auto const& positions = mesh.positions();
+    auto const& mass      = mesh.mass();
+    auto const L          = static_cast<int>(positions.rows());
+    auto const n          = 3 * partition_.owned_count;
+
+    // the rows of owned vertices are complete, all constraints touching them are local
+    std::vector<Eigen::Triplet<scalar_type>> triplets;
+    for (auto const& constraint : mesh.constraints())
+    {
+        auto const SiT_AiT_Ai_Si = constraint->get_wi_SiT_AiT_Ai_Si(positions, mass);
+        for (auto const& triplet : SiT_AiT_Ai_Si)
+            if (triplet.row() < n)
+                triplets.push_back(triplet);
+    }
+
+    auto const dt2_inv = scalar_type{1.} / (dt * dt);
+    for (int i = 0; i < n; ++i)
+        triplets.emplace_back(i, i, mass(i / 3) * dt2_inv);
+
+    A_.resize(n, 3 * L);
+    A_.setFromTriplets(triplets.begin(), triplets.end());
+
+    Eigen::SparseMatrix<scalar_type> const A = A_;
+    owned_block_.compute(A.leftCols(n));
+    inverse_diagonal_ = A_.diagonal().cwiseInverse();
+}
+
+int distributed_solver_t::conjugate_gradient(vector_type const& b, vector_type& x) const
+{
+    auto const n = 3 * partition_.owned_count;
+
+    auto const scaled_norm = [&](vector_type const& v) {
+        vector_type const scaled = inverse_diagonal_.cwiseProduct(v);
+        return std::sqrt(dot(scaled, scaled));
+    };
+
+    scalar_type const threshold = convergence_criteria_.tolerance * scaled_norm(b);
+
+    exchange_halo(x);
+    vector_type r = b - A_ * x;
+    if (scaled_norm(r) <= threshold)
+        return 0;
+
+    vector_type p = vector_type::Zero(x.rows());
+    vector_type z = owned_block_.solve(r);
+    p.head(n)     = z;
+    exchange_halo(p);
+    scalar_type rz = dot(r, z);
+
+    int iterations = 0;
+    while (iterations < convergence_criteria_.max_iterations)
+    {
+        vector_type const Ap    = A_ * p;
+        scalar_type const alpha = rz / dot(p, Ap);
+        x.head(n) += alpha * p.head(n);
+        r -= alpha * Ap;
+        ++iterations;
+
+        if (scaled_norm(r) <= threshold)
+            break;
+
+        z                        = owned_block_.solve(r);
+        scalar_type const rz_new = dot(r, z);
+        p.head(n)                = z + (rz_new / rz) * p.head(n);
+        rz                       = rz_new;
+        exchange_halo(p);
+    }
+
+    exchange_halo(x);
+    return iterations;
+}
+
+void distributed_solver_t::step(Eigen::MatrixXd const& fext, int num_iterations)
+{
+    auto& mesh              = partition_.mesh;
+    auto& positions         = mesh.positions();
+    auto& velocities        = mesh.velocity();
+    auto const& mass        = mesh.mass();
+    auto const& constraints = mesh.constraints();
+    auto const L            = static_cast<int>(positions.rows());
+    auto const n            = 3 * partition_.owned_count;
+
+    auto const dt      = dt_;
+    auto const dt2_inv = scalar_type{1.} / (dt * dt);
+
+    // sn of owned vertices, ghosts receive the owners' values
+    vector_type sn(3 * L);
+    vector_type masses(n);
+    for (int i = 0; i < partition_.owned_count; ++i)
+    {
+        Eigen::Vector3d const a = fext.row(i).transpose() / mass(i);
+        sn.segment<3>(3 * i) = positions.row(i).transpose() + dt * velocities.row(i).transpose() +
+                               dt * dt * a;
+        masses.segment<3>(3 * i) = dt2_inv * mass(i) * sn.segment<3>(3 * i);
+    }
+    exchange_halo(sn);
+
+    vector_type q = sn;
+    vector_type b(3 * L);
+    global_solver_iterations_ = 0;
+    for (int k = 0; k < num_iterations; ++k)
+    {
+        b.setZero();
+        for (auto const& constraint : constraints)
+            constraint->project_wi_SiT_AiT_Bi_pi(q, b);
+
+        vector_type const b_owned = b.head(n) + masses;
+        global_solver_iterations_ += conjugate_gradient(b_owned, q);
+    }
+
+    for (int i = 0; i < L; ++i)
+    {
+        Eigen::RowVector3d const qi = q.segment<3>(3 * i).transpose();
+        velocities.row(i)           = (qi - positions.row(i)) / dt;
+        positions.row(i)            = qi;
+    }
+}
+
+} // namespace pd
@@ -0,0 +1,151 @@
+#include "pd/domain_decomposition.h"
+
+#include "pd/parallel.h"
+
+#include <algorithm>
+#include <queue>
+
+namespace pd {
+namespace detail {
+
+// Each component is traversed from the last vertex of a first traversal,
+// which lies at its periphery, such that the levels of the traversal form thin slabs.
+std::vector<int> breadth_first_order(std::vector<std::vector<int>> const& adjacency)
+{
+    auto const n = adjacency.size();
+
+    std::vector<int> order;
+    order.reserve(n);
+    std::vector<bool> visited(n, false);
+    std::vector<bool> scratch(n, false);
+
+    auto const traverse = [&](int source, std::vector<bool>& marks, std::vector<int>& visit) {
+        std::queue<int> queue;
+        queue.push(source);
+        marks[static_cast<std::size_t>(source)] = true;
+        while (!queue.empty())
+        {
+            int const v = queue.front();
+            queue.pop();
+            visit.push_back(v);
+            for (int const u : adjacency[static_cast<std::size_t>(v)])
+            {
+                if (marks[static_cast<std::size_t>(u)])
+                    continue;
+                marks[static_cast<std::size_t>(u)] = true;
+                queue.push(u);
+            }
+        }
+    };
+
+    for (std::size_t s = 0u; s < n; ++s)
+    {
+        if (visited[s])
+            continue;
+
+        std::vector<int> component;
+        traverse(static_cast<int>(s), scratch, component);
+        traverse(component.back(), visited, order);
+    }
+    return order;
+}
+
+} // namespace detail
+
+void schwarz_preconditioner_t::compute(sparse_matrix_type const& A)
+{
+    auto const n         = static_cast<int>(A.rows() / 3);
+    auto const adjacency = detail::vertex_adjacency(A);
+    auto const order     = detail::breadth_first_order(adjacency);
+    int const K          = std::max(1, std::min(subdomain_count_, n));
+
+    partition_.assign(static_cast<std::size_t>(n), 0);
+    subdomains_.clear();
+    subdomains_.resize(static_cast<std::size_t>(K));
+    for (int i = 0; i < n; ++i)
+    {
+        int const k = static_cast<int>((static_cast<long long>(i) * K) / n);
+        partition_[static_cast<std::size_t>(order[static_cast<std::size_t>(i)])] = k;
+        subdomains_[static_cast<std::size_t>(k)].vertices.push_back(
+            order[static_cast<std::size_t>(i)]);
+    }
+
+    parallel_for(0, K, [&](std::ptrdiff_t k) {
+        auto& subdomain = subdomains_[static_cast<std::size_t>(k)];
+        auto& vertices  = subdomain.vertices;
+
+        // grow the subdomain by overlap layers of neighbours
+        std::vector<int> local_index(static_cast<std::size_t>(n), -1);
+        for (std::size_t v = 0u; v < vertices.size(); ++v)
+            local_index[static_cast<std::size_t>(vertices[v])] = static_cast<int>(v);
+
+        std::size_t layer_begin = 0u;
+        for (int layer = 0; layer < overlap_; ++layer)
+        {
+            std::size_t const layer_end = vertices.size();
+            for (std::size_t v = layer_begin; v < layer_end; ++v)
+            {
+                for (int const u : adjacency[static_cast<std::size_t>(vertices[v])])
+                {
+                    if (local_index[static_cast<std::size_t>(u)] != -1)
+                        continue;
+                    local_index[static_cast<std::size_t>(u)] = static_cast<int>(vertices.size());
+                    vertices.push_back(u);
+                }
+            }
+            layer_begin = layer_end;
+        }
+
+        // A_k = R_k * A * R_k^T
+        std::vector<Eigen::Triplet<scalar_type>> triplets;
+        for (std::size_t v = 0u; v < vertices.size(); ++v)
+        {
+            for (int d = 0; d < 3; ++d)
+            {
+                int const column = 3 * vertices[v] + d;
+                for (sparse_matrix_type::InnerIterator it(A, column); it; ++it)
+                {
+                    int const row = static_cast<int>(it.row());
+                    int const u   = local_index[static_cast<std::size_t>(row / 3)];
+                    if (u == -1)
+                        continue;
+                    triplets.emplace_back(3 * u + row % 3, 3 * static_cast<int>(v) + d, it.value());
+                }
+            }
+        }
+
+        auto const size = static_cast<int>(3u * vertices.size());
+        sparse_matrix_type Ak(size, size);
+        Ak.setFromTriplets(triplets.begin(), triplets.end());
+        subdomain.ldlt = std::make_unique<Eigen::SimplicialLDLT<sparse_matrix_type>>(Ak);
+    });
+}
+
+schwarz_preconditioner_t::vector_type schwarz_preconditioner_t::solve(vector_type const& r) const
+{
+    auto const K = static_cast<std::ptrdiff_t>(subdomains_.size());
+
+    std::vector<vector_type> corrections(subdomains_.size());
+    parallel_for(0, K, [&](std::ptrdiff_t k) {
+        auto const& subdomain = subdomains_[static_cast<std::size_t>(k)];
+        auto const& vertices  = subdomain.vertices;
+
+        vector_type rk(3 * vertices.size());
+        for (std::size_t v = 0u; v < vertices.size(); ++v)
+            rk.segment<3>(3 * v) = r.segment<3>(3 * vertices[v]);
+
+        corrections[static_cast<std::size_t>(k)] = subdomain.ldlt->solve(rk);
+    });
+
+    // overlapping subdomains write to the same vertices, so we accumulate serially
+    vector_type z = vector_type::Zero(r.rows());
+    for (std::size_t k = 0u; k < subdomains_.size(); ++k)
+    {
+        auto const& vertices = subdomains_[k].vertices;
+        for (std::size_t v = 0u; v < vertices.size(); ++v)
+            z.segment<3>(3 * vertices[v]) += corrections[k].segment<3>(3 * v);
+    }
+    return z;
+}
+
+} // namespace pd
@@ -5,25 +5,31 @@
 
 namespace pd {
 
-void edge_length_constraint_t::project_wi_SiT_AiT_Bi_pi(q_type const& q, Eigen::VectorXd& b) const
+template <class Scalar>
+Scalar edge_length_constraint_t::project(
+    Eigen::Matrix<Scalar, Eigen::Dynamic, 1> const& q,
+    Eigen::Matrix<Scalar, Eigen::Dynamic, 1>& b) const
 {
-    using index_type         = decltype(indices().front());
-    index_type const vi      = indices().at(0);
-    index_type const vj      = indices().at(1);
-    Eigen::Vector3d const p1 = q.block(std::size_t{3u} * vi, 0, 3, 1);
-    Eigen::Vector3d const p2 = q.block(std::size_t{3u} * vj, 0, 3, 1);
-    auto const N             = q.rows() / 3;
-
-    Eigen::Vector3d const spring = p2 - p1;
-    auto const length            = spring.norm();
-    Eigen::Vector3d const n      = spring / length;
-    auto const delta             = scalar_type{0.5} * (length - d_);
+    using vector3_type = Eigen::Matrix<Scalar, 3, 1>;
+
+    using index_type      = decltype(indices().front());
+    index_type const vi   = indices().at(0);
+    index_type const vj   = indices().at(1);
+    vector3_type const p1 = q.block(std::size_t{3u} * vi, 0, 3, 1);
+    vector3_type const p2 = q.block(std::size_t{3u} * vj, 0, 3, 1);
+    auto const N          = q.rows() / 3;
+
+    vector3_type const spring = p2 - p1;
+    auto const length         = spring.norm();
+    vector3_type const n      = spring / length;
+    auto const delta          = Scalar{0.5} * (length - static_cast<Scalar>(d_));
 
     // find the position p1 which results in ||p2 - p1|| = rest length
-    Eigen::Vector3d const pi1 = p1 + delta * n;
-    Eigen::Vector3d const pi2 = p2 - delta * n;
+    vector3_type const pi1 = p1 + delta * n;
+    vector3_type const pi2 = p2 - delta * n;
 
-    constexpr scalar_type half{0.5};
+    Scalar const wi = static_cast<Scalar>(this->wi());
+    constexpr Scalar half{0.5};
     constexpr std::size_t three{3};
     // the product wi * (Ai*Si)^T * (Ai*Si) only yields non-zero 
     // entries at coordinates [3vi, 3vi+3[ and [3vj, 3vj+3[.
@@ -31,13 +37,27 @@ void edge_length_constraint_t::project_wi_SiT_AiT_Bi_pi(q_type const& q, Eigen::
     // which result in mean subtraction in every dimension.
     // Thus, we subtract the mean in every dimension directly 
     // instead of performing the matrix multiplication.
-    b(three * vi + 0) += wi() * half * (pi1.x() - pi2.x());
-    b(three * vi + 1) += wi() * half * (pi1.y() - pi2.y());
-    b(three * vi + 2) += wi() * half * (pi1.z() - pi2.z());
+    b(three * vi + 0) += wi * half * (pi1.x() - pi2.x());
+    b(three * vi + 1) += wi * half * (pi1.y() - pi2.y());
+    b(three * vi + 2) += wi * half * (pi1.z() - pi2.z());
+
+    b(three * vj + 0) += wi * half * (pi2.x() - pi1.x());
+    b(three * vj + 1) += wi * half * (pi2.y() - pi1.y());
+    b(three * vj + 2) += wi * half * (pi2.z() - pi1.z());
+
+    // Ai*Si*q - Bi*pi is -delta * n at vi and delta * n at vj
+    return wi * delta * delta;
+}
+
+edge_length_constraint_t::scalar_type
+edge_length_constraint_t::project_wi_SiT_AiT_Bi_pi(q_type const& q, Eigen::VectorXd& b) const
+{
+    return project<scalar_type>(q, b);
+}
 
-    b(three * vj + 0) += wi() * half * (pi2.x() - pi1.x());
-    b(three * vj + 1) += wi() * half * (pi2.y() - pi1.y());
-    b(three * vj + 2) += wi() * half * (pi2.z() - pi1.z());
+float edge_length_constraint_t::project_wi_SiT_AiT_Bi_pi(q_float_type const& q, Eigen::VectorXf& b) const
+{
+    return project<float>(q, b);
 }
 
 std::vector<Eigen::Triplet<edge_length_constraint_t::scalar_type>>
@@ -76,4 +96,15 @@ edge_length_constraint_t::get_wi_SiT_AiT_Ai_Si(positions_type const& p, masses_t
     return std::vector<Eigen::Triplet<scalar_type>>{triplets.begin(), triplets.end()};
 }
 
+edge_length_constraint_t::scalar_type
+edge_length_constraint_t::evaluate(positions_type const& p, masses_type const& M) const
+{
+    auto const e0 = indices().at(0);
+    auto const e1 = indices().at(1);
+
+    scalar_type const length = (p.row(e0) - p.row(e1)).norm();
+    scalar_type const delta  = 0.5 * (length - d_);
+    return wi() * delta * delta;
+}
+
 } // namespace pd
@@ -0,0 +1,65 @@
+#include "pd/half_space_constraint.h"
+
+#include <algorithm>
+#include <array>
+
+namespace pd {
+
+template <class Scalar>
+Scalar half_space_constraint_t::project(
+    Eigen::Matrix<Scalar, Eigen::Dynamic, 1> const& q,
+    Eigen::Matrix<Scalar, Eigen::Dynamic, 1>& b) const
+{
+    using vector3_type = Eigen::Matrix<Scalar, 3, 1>;
+
+    // Ai = identity3x3, Bi = identity3x3 like positional constraints, but pi is
+    // the closest point of the half-space, that is, p itself if the vertex is
+    // outside of the plane and its projection onto the plane otherwise.
+    std::size_t const vi = static_cast<std::size_t>(indices().at(0));
+    std::size_t constexpr three{3u};
+    vector3_type const p = q.template block<3, 1>(three * vi, 0);
+    vector3_type const n = n_.template cast<Scalar>();
+
+    Scalar const penetration = std::min(n.dot(p) - static_cast<Scalar>(d_), Scalar{0.});
+    vector3_type const pi    = p - penetration * n;
+
+    Scalar const wi = static_cast<Scalar>(this->wi());
+    b.template block<3, 1>(three * vi, 0) += wi * pi;
+
+    return Scalar{0.5} * wi * penetration * penetration;
+}
+
+half_space_constraint_t::scalar_type
+half_space_constraint_t::project_wi_SiT_AiT_Bi_pi(q_type const& q, Eigen::VectorXd& b) const
+{
+    return project<scalar_type>(q, b);
+}
+
+float half_space_constraint_t::project_wi_SiT_AiT_Bi_pi(q_float_type const& q, Eigen::VectorXf& b) const
+{
+    return project<float>(q, b);
+}
+
+std::vector<Eigen::Triplet<half_space_constraint_t::scalar_type>>
+half_space_constraint_t::get_wi_SiT_AiT_Ai_Si(positions_type const& p, masses_type const& M) const
+{
+    int const vi = static_cast<int>(indices().at(0));
+
+    std::array<Eigen::Triplet<scalar_type>, 3u> triplets;
+    triplets[0] = {3 * vi + 0, 3 * vi + 0, wi()};
+    triplets[1] = {3 * vi + 1, 3 * vi + 1, wi()};
+    triplets[2] = {3 * vi + 2, 3 * vi + 2, wi()};
+
+    return std::vector<Eigen::Triplet<scalar_type>>{triplets.begin(), triplets.end()};
+}
+
+half_space_constraint_t::scalar_type
+half_space_constraint_t::evaluate(positions_type const& p, masses_type const& M) const
+{
+    auto const vi = indices().at(0);
+    scalar_type const penetration =
+        std::min(n_.dot(p.row(vi).transpose()) - d_, scalar_type{0.});
+    return 0.5 * wi() * penetration * penetration;
+}
+
+} // namespace pd
@@ -0,0 +1,91 @@
+#include "pd/isometric_bending_constraint.h"
+
+#include <cassert>
+
+namespace pd {
+
+isometric_bending_constraint_t::isometric_bending_constraint_t(
+    std::initializer_list<index_type> indices,
+    scalar_type wi,
+    positions_type const& p)
+    : base_type(indices, wi),
+      packed_(packed_hinge_t::pack(this->indices(), wi, p)),
+      is_rest_flat_(packed_.h0.isZero(0.))
+{
+}
+
+isometric_bending_constraint_t::isometric_bending_constraint_t(
+    std::vector<index_type> indices,
+    scalar_type wi,
+    packed_hinge_t const& packed)
+    : base_type(std::move(indices), wi), packed_(packed), is_rest_flat_(packed_.h0.isZero(0.))
+{
+    assert(this->indices().size() == 4u);
+}
+
+void isometric_bending_constraint_t::remap_indices(std::vector<index_type> const& index_map)
+{
+    base_type::remap_indices(index_map);
+    for (std::size_t k = 0u; k < 4u; ++k)
+        packed_.offsets[k] = 3u * this->indices()[k];
+}
+
+template <class Scalar>
+Scalar isometric_bending_constraint_t::project(
+    Eigen::Matrix<Scalar, Eigen::Dynamic, 1> const& q,
+    Eigen::Matrix<Scalar, Eigen::Dynamic, 1>& b) const
+{
+    using vector3_type = Eigen::Matrix<Scalar, 3, 1>;
+
+    auto const& offsets                 = packed_.offsets;
+    Eigen::Matrix<Scalar, 4, 1> const K = packed_.K.template cast<Scalar>();
+    Scalar const weight                 = static_cast<Scalar>(packed_.weight);
+    vector3_type const h0               = packed_.h0.template cast<Scalar>();
+
+    // there is no projection, pi = h0 is constant
+    if (!is_rest_flat_)
+    {
+        vector3_type const wh0 = weight * h0;
+        for (std::size_t k = 0u; k < 4u; ++k)
+            b.template block<3, 1>(offsets[k], 0) += K(k) * wh0;
+    }
+
+    // the objective term is the only per-iteration work
+    vector3_type h = vector3_type::Zero();
+    for (std::size_t k = 0u; k < 4u; ++k)
+        h += K(k) * q.template block<3, 1>(offsets[k], 0);
+
+    return Scalar{0.5} * weight * (h - h0).squaredNorm();
+}
+
+isometric_bending_constraint_t::scalar_type
+isometric_bending_constraint_t::project_wi_SiT_AiT_Bi_pi(q_type const& q, Eigen::VectorXd& b) const
+{
+    return project<scalar_type>(q, b);
+}
+
+float isometric_bending_constraint_t::project_wi_SiT_AiT_Bi_pi(
+    q_float_type const& q,
+    Eigen::VectorXf& b) const
+{
+    return project<float>(q, b);
+}
+
+std::vector<Eigen::Triplet<isometric_bending_constraint_t::scalar_type>>
+isometric_bending_constraint_t::get_wi_SiT_AiT_Ai_Si(positions_type const& p, masses_type const& M)
+    const
+{
+    return packed_.triplets();
+}
+
+isometric_bending_constraint_t::scalar_type
+isometric_bending_constraint_t::evaluate(positions_type const& p, masses_type const& M) const
+{
+    Eigen::Vector3d h = Eigen::Vector3d::Zero();
+    for (std::size_t k = 0u; k < 4u; ++k)
+        h += packed_.K(k) * p.row(indices()[k]).transpose();
+
+    return 0.5 * packed_.weight * (h - packed_.h0).squaredNorm();
+}
+
+} // namespace pd
@@ -0,0 +1,118 @@
+#include "pd/low_rank_update.h"
+
+#include "pd/parallel.h"
+
+#include <algorithm>
+#include <unordered_map>
+
+namespace pd {
+namespace {
+
+/**
+ * Sorted rows touched by the triplets
+ */
+std::vector<Eigen::Index> touched_rows(low_rank_update_t::triplets_type const& triplets)
+{
+    std::vector<Eigen::Index> rows;
+    rows.reserve(2u * triplets.size());
+    for (auto const& triplet : triplets)
+    {
+        rows.push_back(triplet.row());
+        rows.push_back(triplet.col());
+    }
+    std::sort(rows.begin(), rows.end());
+    rows.erase(std::unique(rows.begin(), rows.end()), rows.end());
+    return rows;
+}
+
+} // namespace
+
+void low_rank_update_t::compute(
+    linear_solver_t const& solver,
+    triplets_type const& triplets,
+    Eigen::Index n,
+    convergence_criteria_t const& criteria)
+{
+    clear();
+
+    rows_ = touched_rows(triplets);
+    if (rows_.empty())
+        return;
+
+    // the columns of Z = A^-1 * U are independent solves
+    auto const m           = static_cast<Eigen::Index>(rows_.size());
+    bool const is_Z_stored = n * m <= max_stored_entries;
+    if (is_Z_stored)
+        Z_.resize(n, m);
+
+    G_.resize(m, m);
+    parallel_for(0, m, [&](std::ptrdiff_t j) {
+        vector_type e = vector_type::Zero(n);
+        e(rows_[static_cast<std::size_t>(j)]) = scalar_type{1.};
+        vector_type z = vector_type::Zero(n);
+        solver.solve(e, z, criteria);
+
+        for (Eigen::Index i = 0; i < m; ++i)
+            G_(i, j) = z(rows_[static_cast<std::size_t>(i)]);
+        if (is_Z_stored)
+            Z_.col(j) = z;
+    });
+
+    compute_capacitance(triplets);
+}
+
+bool low_rank_update_t::update(triplets_type const& triplets)
+{
+    if (touched_rows(triplets) != rows_)
+        return false;
+
+    if (!rows_.empty())
+        compute_capacitance(triplets);
+    return true;
+}
+
+void low_rank_update_t::compute_capacitance(triplets_type const& triplets)
+{
+    auto const m = static_cast<Eigen::Index>(rows_.size());
+    std::unordered_map<Eigen::Index, Eigen::Index> local_row;
+    for (Eigen::Index i = 0; i < m; ++i)
+        local_row[rows_[static_cast<std::size_t>(i)]] = i;
+
+    W_ = Eigen::MatrixXd::Zero(m, m);
+    for (auto const& triplet : triplets)
+        W_(local_row[triplet.row()], local_row[triplet.col()]) += triplet.value();
+
+    capacitance_.compute(Eigen::MatrixXd::Identity(m, m) + W_ * G_);
+}
+
+int low_rank_update_t::solve(
+    linear_solver_t const& solver,
+    vector_type const& b,
+    vector_type& x,
+    convergence_criteria_t const& criteria) const
+{
+    int iterations = solver.solve(b, x, criteria);
+    if (rows_.empty())
+        return iterations;
+
+    auto const m = static_cast<Eigen::Index>(rows_.size());
+    vector_type y_D(m);
+    for (Eigen::Index i = 0; i < m; ++i)
+        y_D(i) = x(rows_[static_cast<std::size_t>(i)]);
+
+    vector_type const s = capacitance_.solve(W_ * y_D);
+    if (Z_.cols() == m)
+    {
+        x -= Z_ * s;
+        return iterations;
+    }
+
+    // x = A^-1 * (b - U * s), warm started from y
+    vector_type b_corrected = b;
+    for (Eigen::Index i = 0; i < m; ++i)
+        b_corrected(rows_[static_cast<std::size_t>(i)]) -= s(i);
+    iterations += solver.solve(b_corrected, x, criteria);
+    return iterations;
+}
+
+} // namespace pd
@@ -0,0 +1,85 @@
+#include "pd/material.h"
+
+#include <cassert>
+#include <fstream>
+#include <sstream>
+
+namespace pd {
+
+material_field_t::material_field_t(
+    Eigen::VectorXd const& young_moduli,
+    Eigen::VectorXd const& poisson_ratios)
+{
+    assert(young_moduli.rows() == poisson_ratios.rows());
+
+    parameters_.reserve(static_cast<std::size_t>(young_moduli.rows()));
+    for (auto e = 0; e < young_moduli.rows(); ++e)
+        parameters_.emplace_back(material_t{young_moduli(e), poisson_ratios(e)});
+}
+
+void material_field_t::permute(std::vector<int> const& old_index)
+{
+    if (empty())
+        return;
+
+    assert(old_index.size() == parameters_.size());
+
+    std::vector<lame_parameters_t> parameters(parameters_.size());
+    for (std::size_t e = 0u; e < old_index.size(); ++e)
+        parameters[e] = parameters_[old_index[e]];
+    parameters_ = std::move(parameters);
+}
+
+void material_field_t::remove(std::vector<bool> const& is_removed)
+{
+    if (empty())
+        return;
+
+    assert(is_removed.size() == parameters_.size());
+
+    std::size_t kept = 0u;
+    for (std::size_t e = 0u; e < parameters_.size(); ++e)
+        if (!is_removed[e])
+            parameters_[kept++] = parameters_[e];
+    parameters_.resize(kept);
+}
+
+bool read_material_field(
+    std::string const& filename,
+    std::size_t element_count,
+    material_field_t& field)
+{
+    std::ifstream file(filename);
+    if (!file)
+        return false;
+
+    std::vector<lame_parameters_t> parameters;
+    parameters.reserve(element_count);
+    std::string line;
+    while (std::getline(file, line))
+    {
+        std::istringstream stream(line);
+        material_t material{};
+        if (!(stream >> material.young_modulus))
+            continue; // skip blank lines
+
+        if (!(stream >> material.poisson_ratio) || material.young_modulus <= 0. ||
+            material.poisson_ratio <= -1. || material.poisson_ratio >= 0.5)
+            return false;
+
+        parameters.emplace_back(material);
+    }
+
+    if (parameters.size() == 1u)
+    {
+        lame_parameters_t const uniform = parameters.front();
+        parameters.assign(element_count, uniform);
+    }
+    if (parameters.size() != element_count)
+        return false;
+
+    field = material_field_t{std::move(parameters)};
+    return true;
+}
+
+} // namespace pd
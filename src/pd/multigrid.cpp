@@ -0,0 +1,171 @@
+#include "pd/multigrid.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace pd {
+namespace detail {
+
+/**
+ * Groups the vertices of the 3N x 3N matrix A into aggregates of neighbouring
+ * vertices, where vertices i and j are neighbours if the 3x3 block A_ij is non-zero.
+ * Returns the aggregate of each vertex and stores the number of aggregates in count.
+ */
+std::vector<int> aggregate_vertices(Eigen::SparseMatrix<double> const& A, int& count)
+{
+    auto const n         = static_cast<std::size_t>(A.rows() / 3);
+    auto const adjacency = vertex_adjacency(A);
+
+    std::vector<int> aggregate(n, -1);
+    count = 0;
+
+    // 1. vertices whose neighbourhood is untouched seed an aggregate with their neighbours
+    for (std::size_t i = 0u; i < n; ++i)
+    {
+        if (aggregate[i] != -1)
+            continue;
+
+        auto const& neighbours = adjacency[i];
+        bool const is_free     = std::all_of(neighbours.begin(), neighbours.end(), [&](int j) {
+            return aggregate[static_cast<std::size_t>(j)] == -1;
+        });
+        if (!is_free)
+            continue;
+
+        aggregate[i] = count;
+        for (int const j : neighbours)
+            aggregate[static_cast<std::size_t>(j)] = count;
+        ++count;
+    }
+
+    // 2. remaining vertices join an aggregate from step 1 they are adjacent to
+    std::vector<int> const seeded = aggregate;
+    for (std::size_t i = 0u; i < n; ++i)
+    {
+        if (aggregate[i] != -1)
+            continue;
+
+        for (int const j : adjacency[i])
+        {
+            if (seeded[static_cast<std::size_t>(j)] != -1)
+            {
+                aggregate[i] = seeded[static_cast<std::size_t>(j)];
+                break;
+            }
+        }
+    }
+
+    // 3. isolated leftovers form aggregates with their unaggregated neighbours
+    for (std::size_t i = 0u; i < n; ++i)
+    {
+        if (aggregate[i] != -1)
+            continue;
+
+        aggregate[i] = count;
+        for (int const j : adjacency[i])
+            if (aggregate[static_cast<std::size_t>(j)] == -1)
+                aggregate[static_cast<std::size_t>(j)] = count;
+        ++count;
+    }
+
+    return aggregate;
+}
+
+/**
+ * Gershgorin bound on the spectral radius of D^-1 * A
+ */
+double jacobi_spectral_radius_bound(
+    Eigen::SparseMatrix<double> const& A,
+    Eigen::VectorXd const& inverse_diagonal)
+{
+    // A is symmetric, so summing columns is the same as summing rows
+    double rho = 0.;
+    for (int k = 0; k < A.outerSize(); ++k)
+    {
+        double sum = 0.;
+        for (Eigen::SparseMatrix<double>::InnerIterator it(A, k); it; ++it)
+            sum += std::abs(it.value());
+        rho = std::max(rho, sum * std::abs(inverse_diagonal(k)));
+    }
+    return rho;
+}
+
+} // namespace detail
+
+void multigrid_preconditioner_t::compute(sparse_matrix_type const& A)
+{
+    levels_.clear();
+
+    sparse_matrix_type Al = A;
+    while (Al.rows() / 3 > coarsest_vertex_count_)
+    {
+        int const n = static_cast<int>(Al.rows() / 3);
+        int count   = 0;
+        std::vector<int> const aggregate = detail::aggregate_vertices(Al, count);
+        if (count >= n)
+            break;
+
+        level_t level{};
+        level.inverse_diagonal = Al.diagonal().cwiseInverse();
+        level.omega = (4. / 3.) / detail::jacobi_spectral_radius_bound(Al, level.inverse_diagonal);
+
+        std::vector<Eigen::Triplet<scalar_type>> triplets;
+        triplets.reserve(static_cast<std::size_t>(Al.rows()));
+        for (int i = 0; i < n; ++i)
+            for (int d = 0; d < 3; ++d)
+                triplets.emplace_back(3 * i + d, 3 * aggregate[static_cast<std::size_t>(i)] + d, 1.);
+
+        sparse_matrix_type tentative(Al.rows(), 3 * count);
+        tentative.setFromTriplets(triplets.begin(), triplets.end());
+
+        // P = (I - omega * D^-1 * A) * tentative
+        vector_type const scaling       = level.omega * level.inverse_diagonal;
+        sparse_matrix_type const DinvAP = scaling.asDiagonal() * (Al * tentative);
+        level.P                         = tentative - DinvAP;
+        level.PT = level.P.transpose();
+
+        sparse_matrix_type const coarse = level.PT * (Al * level.P);
+        level.A                         = std::move(Al);
+        Al                              = coarse;
+        levels_.push_back(std::move(level));
+    }
+
+    coarsest_A_ = std::move(Al);
+    coarsest_solver_.compute(coarsest_A_);
+}
+
+multigrid_preconditioner_t::vector_type
+multigrid_preconditioner_t::solve(vector_type const& b) const
+{
+    vector_type x;
+    v_cycle(0u, b, x);
+    return x;
+}
+
+void multigrid_preconditioner_t::v_cycle(std::size_t l, vector_type const& b, vector_type& x)
+    const
+{
+    if (l == levels_.size())
+    {
+        x = coarsest_solver_.solve(b);
+        return;
+    }
+
+    auto const& level = levels_[l];
+    auto const smooth = [&]() {
+        for (int s = 0; s < smoothing_steps_; ++s)
+            x += level.omega * level.inverse_diagonal.cwiseProduct(b - level.A * x);
+    };
+
+    x.setZero(b.rows());
+    smooth();
+
+    vector_type const coarse_residual = level.PT * (b - level.A * x);
+    vector_type coarse_correction;
+    v_cycle(l + 1u, coarse_residual, coarse_correction);
+    x += level.P * coarse_correction;
+
+    smooth();
+}
+
+} // namespace pd
@@ -4,7 +4,10 @@
 
 namespace pd {
 
-void positional_constraint_t::project_wi_SiT_AiT_Bi_pi(q_type const& q, Eigen::VectorXd& b) const
+template <class Scalar>
+Scalar positional_constraint_t::project(
+    Eigen::Matrix<Scalar, Eigen::Dynamic, 1> const& q,
+    Eigen::Matrix<Scalar, Eigen::Dynamic, 1>& b) const
 {
     // Ai = identity3x3, Bi = identity3x3, Si = zeros3x3N + identity3x3 at block(3*vi, 0, 3, 3)
     // We precompute the non-zero entries of (Ai*Si)^T * (Bi*pi) which only occur 
@@ -13,7 +16,22 @@ void positional_constraint_t::project_wi_SiT_AiT_Bi_pi(q_type const& q, Eigen::V
     // is simply the goal position p0.
     std::size_t const vi = static_cast<std::size_t>(indices().at(0));
     std::size_t constexpr three{3u};
-    b.block(three * vi, 0, 3, 1) += wi() * p0_;
+    b.block(three * vi, 0, 3, 1) += static_cast<Scalar>(wi()) * p0_.template cast<Scalar>();
+
+    Scalar const dist2 = (q.template block<3, 1>(three * vi, 0) - p0_.template cast<Scalar>())
+                             .squaredNorm();
+    return Scalar{0.5} * static_cast<Scalar>(wi()) * dist2;
+}
+
+positional_constraint_t::scalar_type
+positional_constraint_t::project_wi_SiT_AiT_Bi_pi(q_type const& q, Eigen::VectorXd& b) const
+{
+    return project<scalar_type>(q, b);
+}
+
+float positional_constraint_t::project_wi_SiT_AiT_Bi_pi(q_float_type const& q, Eigen::VectorXf& b) const
+{
+    return project<float>(q, b);
 }
 
 std::vector<Eigen::Triplet<positional_constraint_t::scalar_type>>
@@ -33,4 +51,11 @@ positional_constraint_t::get_wi_SiT_AiT_Ai_Si(positions_type const& p, masses_ty
     return std::vector<Eigen::Triplet<scalar_type>>{triplets.begin(), triplets.end()};
 }
 
+positional_constraint_t::scalar_type
+positional_constraint_t::evaluate(positions_type const& p, masses_type const& M) const
+{
+    auto const vi = indices().at(0);
+    return 0.5 * wi() * (p.row(vi).transpose() - p0_).squaredNorm();
+}
+
 } // namespace pd
\ No newline at end of file
@@ -0,0 +1,167 @@
+#include "pd/shape_target_animation.h"
+
+#include "pd/parallel.h"
+#include "pd/shape_targeting_constraint.h"
+
+#include <Eigen/Eigenvalues>
+#include <algorithm>
+#include <cassert>
+
+namespace pd {
+namespace detail {
+
+/**
+ * Packs the logarithm of the symmetric positive semi-definite S. Vanishing stretches
+ * are clamped, such that degenerate tetrahedra have a finite logarithm.
+ */
+shape_target_animation_t::packed_stretch_type pack_log_stretch(Eigen::Matrix3d const& S)
+{
+    double constexpr min_stretch = 1e-6;
+
+    Eigen::SelfAdjointEigenSolver<Eigen::Matrix3d> eigen;
+    eigen.computeDirect(S);
+    Eigen::Vector3d const log_sigma = eigen.eigenvalues().cwiseMax(min_stretch).array().log();
+    Eigen::Matrix3d const& V        = eigen.eigenvectors();
+    Eigen::Matrix3d const L         = V * log_sigma.asDiagonal() * V.transpose();
+
+    return {
+        static_cast<float>(L(0, 0)),
+        static_cast<float>(L(1, 1)),
+        static_cast<float>(L(2, 2)),
+        static_cast<float>(L(0, 1)),
+        static_cast<float>(L(0, 2)),
+        static_cast<float>(L(1, 2))};
+}
+
+/**
+ * Computes exp(L) of the symmetric L = (1 - alpha) * L1 + alpha * L2
+ */
+Eigen::Matrix3d interpolate_log_stretch(
+    shape_target_animation_t::packed_stretch_type const& L1,
+    shape_target_animation_t::packed_stretch_type const& L2,
+    float alpha)
+{
+    std::array<double, 6u> l;
+    for (std::size_t i = 0u; i < 6u; ++i)
+        l[i] = static_cast<double>(L1[i] + alpha * (L2[i] - L1[i]));
+
+    Eigen::Matrix3d L;
+    L << l[0], l[3], l[4], l[3], l[1], l[5], l[4], l[5], l[2];
+
+    Eigen::SelfAdjointEigenSolver<Eigen::Matrix3d> eigen;
+    eigen.computeDirect(L);
+    Eigen::Vector3d const sigma = eigen.eigenvalues().array().exp();
+    Eigen::Matrix3d const& V    = eigen.eigenvectors();
+    return V * sigma.asDiagonal() * V.transpose();
+}
+
+} // namespace detail
+
+void shape_target_animation_t::add_keyframe(
+    scalar_type time,
+    deformable_mesh_t const& model,
+    positions_type const& pose)
+{
+    auto const shape_targeting = shape_targeting_constraints(model.constraints());
+
+    keyframe_t keyframe{time, std::vector<packed_stretch_type>(shape_targeting.size())};
+    auto const count = static_cast<std::ptrdiff_t>(shape_targeting.size());
+    parallel_for(0, count, [&](std::ptrdiff_t k) {
+        keyframe.log_stretches[k] = detail::pack_log_stretch(shape_targeting[k]->stretch(pose));
+    });
+    insert(std::move(keyframe));
+}
+
+void shape_target_animation_t::add_keyframe(
+    scalar_type time,
+    std::vector<Eigen::Matrix3d> const& stretches)
+{
+    keyframe_t keyframe{time, std::vector<packed_stretch_type>(stretches.size())};
+    auto const count = static_cast<std::ptrdiff_t>(stretches.size());
+    parallel_for(0, count, [&](std::ptrdiff_t k) {
+        keyframe.log_stretches[k] = detail::pack_log_stretch(stretches[k]);
+    });
+    insert(std::move(keyframe));
+}
+
+void shape_target_animation_t::insert(keyframe_t keyframe)
+{
+    // keyframes of a different model are discarded
+    if (!empty() && keyframe.log_stretches.size() != target_count())
+        keyframes_.clear();
+
+    auto const it = std::lower_bound(
+        keyframes_.begin(),
+        keyframes_.end(),
+        keyframe.time,
+        [](keyframe_t const& k, scalar_type time) { return k.time < time; });
+    if (it != keyframes_.end() && it->time == keyframe.time)
+        *it = std::move(keyframe);
+    else
+        keyframes_.insert(it, std::move(keyframe));
+}
+
+void shape_target_animation_t::bracket(
+    scalar_type time,
+    keyframe_t const*& first,
+    keyframe_t const*& second,
+    float& alpha) const
+{
+    assert(!empty());
+
+    auto const it = std::upper_bound(
+        keyframes_.begin(),
+        keyframes_.end(),
+        time,
+        [](scalar_type time, keyframe_t const& k) { return time < k.time; });
+
+    if (it == keyframes_.begin() || it == keyframes_.end())
+    {
+        first  = it == keyframes_.begin() ? &keyframes_.front() : &keyframes_.back();
+        second = first;
+        alpha  = 0.f;
+        return;
+    }
+
+    first  = &*(it - 1);
+    second = &*it;
+    alpha  = static_cast<float>((time - first->time) / (second->time - first->time));
+}
+
+Eigen::Matrix3d shape_target_animation_t::stretch(scalar_type time, std::size_t k) const
+{
+    keyframe_t const* first  = nullptr;
+    keyframe_t const* second = nullptr;
+    float alpha              = 0.f;
+    bracket(time, first, second, alpha);
+    return detail::interpolate_log_stretch(
+        first->log_stretches[k],
+        second->log_stretches[k],
+        alpha);
+}
+
+std::size_t shape_target_animation_t::apply(scalar_type time, deformable_mesh_t& model) const
+{
+    if (empty())
+        return 0u;
+
+    auto const shape_targeting = shape_targeting_constraints(model.constraints());
+    if (shape_targeting.size() != target_count())
+        return 0u;
+
+    keyframe_t const* first  = nullptr;
+    keyframe_t const* second = nullptr;
+    float alpha              = 0.f;
+    bracket(time, first, second, alpha);
+
+    auto const count = static_cast<std::ptrdiff_t>(shape_targeting.size());
+    parallel_for(0, count, [&](std::ptrdiff_t k) {
+        shape_targeting[k]->set_shape_target(detail::interpolate_log_stretch(
+            first->log_stretches[k],
+            second->log_stretches[k],
+            alpha));
+    });
+    return shape_targeting.size();
+}
+
+} // namespace pd
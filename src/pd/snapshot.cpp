@@ -0,0 +1,918 @@
+#include "pd/snapshot.h"
+
+#include "pd/bending_constraint.h"
+#include "pd/corotated_deformation_gradient_constraint.h"
+#include "pd/deformation_gradient_constraint.h"
+#include "pd/edge_length_constraint.h"
+#include "pd/half_space_constraint.h"
+#include "pd/isometric_bending_constraint.h"
+#include "pd/positional_constraint.h"
+#include "pd/shape_targeting_constraint.h"
+#include "pd/solver.h"
+#include "pd/strain_constraint.h"
+#include "pd/triangle_strain_constraint.h"
+
+#include <array>
+#include <cassert>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <random>
+#include <type_traits>
+
+#if defined(_WIN32)
+#include <iterator>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace pd {
+namespace detail {
+
+constexpr std::array<char, 8u> snapshot_magic{'P', 'D', 'S', 'N', 'A', 'P', '\0', '\0'};
+constexpr std::uint32_t snapshot_byte_order_mark = 0x01020304u;
+
+enum class snapshot_section_t : std::uint32_t {
+    mesh          = 1u,
+    constraints   = 2u,
+    factorization = 3u,
+    matrix_factor = 4u, ///< Factorization of the system matrix with a given key
+    materials     = 5u
+};
+
+/**
+ * Read-only view of a whole file, memory mapped where the platform supports it
+ */
+class mapped_file_t
+{
+  public:
+    explicit mapped_file_t(std::string const& filename)
+    {
+#if defined(_WIN32)
+        std::ifstream file(filename, std::ios::binary);
+        if (!file)
+            return;
+        buffer_.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+        data_ = buffer_.data();
+        size_ = buffer_.size();
+#else
+        int const fd = ::open(filename.c_str(), O_RDONLY);
+        if (fd < 0)
+            return;
+
+        struct stat status;
+        if (::fstat(fd, &status) == 0 && status.st_size > 0)
+        {
+            auto const size     = static_cast<std::size_t>(status.st_size);
+            void* const mapping = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (mapping != MAP_FAILED)
+            {
+                data_ = static_cast<char const*>(mapping);
+                size_ = size;
+                ::madvise(mapping, size_, MADV_SEQUENTIAL);
+            }
+        }
+        ::close(fd);
+#endif
+    }
+
+    ~mapped_file_t()
+    {
+#if !defined(_WIN32)
+        if (data_ != nullptr)
+            ::munmap(const_cast<char*>(data_), size_);
+#endif
+    }
+
+    mapped_file_t(mapped_file_t const&) = delete;
+    mapped_file_t& operator=(mapped_file_t const&) = delete;
+
+    char const* data() const { return data_; }
+    std::size_t size() const { return size_; }
+
+  private:
+    char const* data_ = nullptr;
+    std::size_t size_ = 0u;
+#if defined(_WIN32)
+    std::vector<char> buffer_;
+#endif
+};
+
+class snapshot_writer_t
+{
+  public:
+    explicit snapshot_writer_t(std::ofstream& file) : file_(file) {}
+
+    template <class T>
+    void write(T const& value)
+    {
+        static_assert(std::is_arithmetic_v<T>);
+        file_.write(reinterpret_cast<char const*>(&value), sizeof(T));
+    }
+
+    template <class Scalar>
+    void write(Scalar const* data, std::size_t count)
+    {
+        static_assert(std::is_arithmetic_v<Scalar>);
+        file_.write(reinterpret_cast<char const*>(data), sizeof(Scalar) * count);
+    }
+
+    /**
+     * Writes the coefficients of a dense matrix, preceded by its dimensions if they
+     * are dynamic
+     */
+    template <class Derived>
+    void write_matrix(Eigen::PlainObjectBase<Derived> const& M)
+    {
+        if (Derived::RowsAtCompileTime == Eigen::Dynamic)
+            write(static_cast<std::uint64_t>(M.rows()));
+        if (Derived::ColsAtCompileTime == Eigen::Dynamic)
+            write(static_cast<std::uint64_t>(M.cols()));
+        write(M.data(), static_cast<std::size_t>(M.size()));
+    }
+
+    void begin_section(snapshot_section_t section)
+    {
+        write(static_cast<std::uint32_t>(section));
+        write(std::uint32_t{0u});
+        size_position_ = file_.tellp();
+        write(std::uint64_t{0u});
+    }
+
+    void end_section()
+    {
+        auto const end = file_.tellp();
+        auto const size =
+            static_cast<std::uint64_t>(end - size_position_) - sizeof(std::uint64_t);
+        for (auto padding = (8u - size % 8u) % 8u; padding > 0u; --padding)
+            write(std::uint8_t{0u});
+
+        auto const padded_end = file_.tellp();
+        file_.seekp(size_position_);
+        write(size);
+        file_.seekp(padded_end);
+    }
+
+  private:
+    std::ofstream& file_;
+    std::streampos size_position_{};
+};
+
+/**
+ * Bounds checked cursor over a mapped snapshot. Reads past the end fail and leave
+ * the reader in a failed state.
+ */
+class snapshot_reader_t
+{
+  public:
+    snapshot_reader_t(char const* data, std::size_t size) : data_(data), size_(size) {}
+
+    bool ok() const { return ok_; }
+    bool at_end() const { return position_ == size_; }
+    std::size_t position() const { return position_; }
+
+    bool read(void* destination, std::size_t bytes)
+    {
+        if (!ok_ || bytes > size_ - position_)
+            return ok_ = false;
+
+        if (bytes > 0u)
+            std::memcpy(destination, data_ + position_, bytes);
+        position_ += bytes;
+        return true;
+    }
+
+    template <class T>
+    T read()
+    {
+        static_assert(std::is_arithmetic_v<T>);
+        T value{};
+        read(&value, sizeof(T));
+        return value;
+    }
+
+    template <class Derived>
+    bool read_matrix(Eigen::PlainObjectBase<Derived>& M)
+    {
+        using scalar_type = typename Derived::Scalar;
+
+        Eigen::Index rows = Derived::RowsAtCompileTime;
+        Eigen::Index cols = Derived::ColsAtCompileTime;
+        if (Derived::RowsAtCompileTime == Eigen::Dynamic)
+            rows = static_cast<Eigen::Index>(read<std::uint64_t>());
+        if (Derived::ColsAtCompileTime == Eigen::Dynamic)
+            cols = static_cast<Eigen::Index>(read<std::uint64_t>());
+
+        // reject sizes larger than the remaining bytes before allocating
+        std::size_t const remaining = size_ - position_;
+        if (!ok_ || rows < 0 || cols < 0 ||
+            (rows > 0 && static_cast<std::size_t>(cols) >
+                              remaining / sizeof(scalar_type) / static_cast<std::size_t>(rows)))
+            return ok_ = false;
+
+        M.resize(rows, cols);
+        return read(M.data(), sizeof(scalar_type) * static_cast<std::size_t>(M.size()));
+    }
+
+    void seek(std::size_t position)
+    {
+        if (position > size_)
+            ok_ = false;
+        else
+            position_ = position;
+    }
+
+  private:
+    char const* data_;
+    std::size_t size_;
+    std::size_t position_ = 0u;
+    bool ok_              = true;
+};
+
+void write_packed(snapshot_writer_t& writer, packed_tet_t const& packed)
+{
+    writer.write(packed.V0);
+    writer.write(packed.weight);
+    writer.write_matrix(packed.G);
+}
+
+bool read_packed(snapshot_reader_t& reader, packed_tet_t& packed)
+{
+    packed.V0     = reader.read<double>();
+    packed.weight = reader.read<double>();
+    return reader.read_matrix(packed.G);
+}
+
+void write_packed(snapshot_writer_t& writer, packed_triangle_t const& packed)
+{
+    writer.write(packed.A0);
+    writer.write(packed.weight);
+    writer.write_matrix(packed.G);
+}
+
+bool read_packed(snapshot_reader_t& reader, packed_triangle_t& packed)
+{
+    packed.A0     = reader.read<double>();
+    packed.weight = reader.read<double>();
+    return reader.read_matrix(packed.G);
+}
+
+void write_packed(snapshot_writer_t& writer, packed_hinge_t const& packed)
+{
+    writer.write_matrix(packed.K);
+    writer.write(packed.weight);
+    writer.write_matrix(packed.h0);
+}
+
+bool read_packed(snapshot_reader_t& reader, packed_hinge_t& packed)
+{
+    bool const is_K_read = reader.read_matrix(packed.K);
+    packed.weight        = reader.read<double>();
+    return is_K_read && reader.read_matrix(packed.h0);
+}
+
+/**
+ * The offsets of packed records are not stored, they follow from the indices
+ */
+void write_lame_parameters(snapshot_writer_t& writer, lame_parameters_t const& lame)
+{
+    writer.write(lame.mu);
+    writer.write(lame.lambda);
+}
+
+lame_parameters_t read_lame_parameters(snapshot_reader_t& reader)
+{
+    lame_parameters_t lame{};
+    lame.mu     = reader.read<double>();
+    lame.lambda = reader.read<double>();
+    return lame;
+}
+
+template <class Packed>
+void set_offsets(Packed& packed, std::vector<std::uint32_t> const& indices)
+{
+    for (std::size_t a = 0u; a < packed.offsets.size(); ++a)
+        packed.offsets[a] = 3u * indices[a];
+}
+
+void write_constraint(snapshot_writer_t& writer, constraint_t const& constraint)
+{
+    auto const& indices = constraint.indices();
+    writer.write(static_cast<std::uint32_t>(constraint.type()));
+    writer.write(static_cast<std::uint32_t>(indices.size()));
+    writer.write(constraint.wi());
+    writer.write(indices.data(), indices.size());
+
+    // the type tag determines the concrete type, no RTTI involved
+    switch (constraint.type())
+    {
+        case constraint_type_t::edge_length:
+            writer.write(static_cast<edge_length_constraint_t const&>(constraint).rest_length());
+            break;
+        case constraint_type_t::positional:
+            writer.write_matrix(static_cast<positional_constraint_t const&>(constraint).target());
+            break;
+        case constraint_type_t::deformation_gradient: {
+            auto const& c = static_cast<deformation_gradient_constraint_t const&>(constraint);
+            write_packed(writer, c.packed());
+            write_lame_parameters(writer, c.lame_parameters());
+            break;
+        }
+        case constraint_type_t::corotated_deformation_gradient: {
+            auto const& c =
+                static_cast<corotated_deformation_gradient_constraint_t const&>(constraint);
+            write_packed(writer, c.packed());
+            write_lame_parameters(writer, c.lame_parameters());
+            break;
+        }
+        case constraint_type_t::shape_targeting: {
+            auto const& c = static_cast<shape_targeting_constraint_t const&>(constraint);
+            write_packed(writer, c.packed());
+            writer.write_matrix(c.shape_target());
+            write_lame_parameters(writer, c.lame_parameters());
+            break;
+        }
+        case constraint_type_t::strain: {
+            auto const& c = static_cast<strain_constraint_t const&>(constraint);
+            write_packed(writer, c.packed());
+            writer.write(c.sigma_min());
+            writer.write(c.sigma_max());
+            break;
+        }
+        case constraint_type_t::triangle_strain: {
+            auto const& c = static_cast<triangle_strain_constraint_t const&>(constraint);
+            write_packed(writer, c.packed());
+            writer.write(c.sigma_min());
+            writer.write(c.sigma_max());
+            break;
+        }
+        case constraint_type_t::bending:
+            write_packed(writer, static_cast<bending_constraint_t const&>(constraint).packed());
+            break;
+        case constraint_type_t::isometric_bending:
+            write_packed(
+                writer,
+                static_cast<isometric_bending_constraint_t const&>(constraint).packed());
+            break;
+        case constraint_type_t::half_space: {
+            auto const& c = static_cast<half_space_constraint_t const&>(constraint);
+            writer.write_matrix(c.normal());
+            writer.write(c.offset());
+            break;
+        }
+    }
+}
+
+/**
+ * Whether every entry of the index matrix is a vertex index in [0, vertex_count)
+ */
+bool are_vertex_indices(Eigen::MatrixXi const& indices, Eigen::Index vertex_count)
+{
+    return indices.size() == 0 || (indices.minCoeff() >= 0 && indices.maxCoeff() < vertex_count);
+}
+
+/**
+ * Whether the index maps are inverse permutations of each other, or both empty
+ */
+bool are_inverse_permutations(std::vector<int> const& a, std::vector<int> const& b)
+{
+    if (a.size() != b.size())
+        return false;
+
+    auto const n = static_cast<int>(a.size());
+    for (int i = 0; i < n; ++i)
+    {
+        if (a[i] < 0 || a[i] >= n || b[static_cast<std::size_t>(a[i])] != i)
+            return false;
+    }
+    return true;
+}
+
+/**
+ * Reads a constraint written by write_constraint(), null if the record is invalid
+ */
+std::unique_ptr<constraint_t> read_constraint(snapshot_reader_t& reader, std::size_t vertex_count)
+{
+    using index_type  = constraint_t::index_type;
+    using scalar_type = constraint_t::scalar_type;
+
+    auto const type        = static_cast<constraint_type_t>(reader.read<std::uint32_t>());
+    auto const index_count = reader.read<std::uint32_t>();
+    auto const wi          = reader.read<scalar_type>();
+    if (!reader.ok() || index_count > 4u)
+        return nullptr;
+
+    std::vector<index_type> indices(index_count);
+    reader.read(indices.data(), sizeof(index_type) * indices.size());
+    for (auto const i : indices)
+        if (i >= vertex_count)
+            return nullptr;
+
+    auto const has_index_count = [&](std::uint32_t count) {
+        return reader.ok() && index_count == count;
+    };
+
+    switch (type)
+    {
+        case constraint_type_t::edge_length: {
+            auto const rest_length = reader.read<scalar_type>();
+            if (!has_index_count(2u))
+                return nullptr;
+            return std::make_unique<edge_length_constraint_t>(std::move(indices), wi, rest_length);
+        }
+        case constraint_type_t::positional: {
+            Eigen::Vector3d target;
+            if (!reader.read_matrix(target) || !has_index_count(1u))
+                return nullptr;
+            return std::make_unique<positional_constraint_t>(std::move(indices), wi, target);
+        }
+        case constraint_type_t::deformation_gradient:
+        case constraint_type_t::corotated_deformation_gradient: {
+            packed_tet_t packed{};
+            read_packed(reader, packed);
+            auto const lame = read_lame_parameters(reader);
+            if (!has_index_count(4u))
+                return nullptr;
+            set_offsets(packed, indices);
+            if (type == constraint_type_t::deformation_gradient)
+                return std::make_unique<deformation_gradient_constraint_t>(
+                    std::move(indices),
+                    wi,
+                    packed,
+                    lame);
+            return std::make_unique<corotated_deformation_gradient_constraint_t>(
+                std::move(indices),
+                wi,
+                packed,
+                lame);
+        }
+        case constraint_type_t::shape_targeting: {
+            packed_tet_t packed{};
+            Eigen::Matrix3d shape_target;
+            read_packed(reader, packed);
+            reader.read_matrix(shape_target);
+            auto const lame = read_lame_parameters(reader);
+            if (!has_index_count(4u))
+                return nullptr;
+            set_offsets(packed, indices);
+            return std::make_unique<shape_targeting_constraint_t>(
+                std::move(indices),
+                wi,
+                packed,
+                shape_target,
+                lame);
+        }
+        case constraint_type_t::strain: {
+            packed_tet_t packed{};
+            bool const is_packed_read = read_packed(reader, packed);
+            auto const sigma_min      = reader.read<scalar_type>();
+            auto const sigma_max      = reader.read<scalar_type>();
+            if (!is_packed_read || !has_index_count(4u))
+                return nullptr;
+            set_offsets(packed, indices);
+            return std::make_unique<strain_constraint_t>(
+                std::move(indices),
+                wi,
+                packed,
+                sigma_min,
+                sigma_max);
+        }
+        case constraint_type_t::triangle_strain: {
+            packed_triangle_t packed{};
+            bool const is_packed_read = read_packed(reader, packed);
+            auto const sigma_min      = reader.read<scalar_type>();
+            auto const sigma_max      = reader.read<scalar_type>();
+            if (!is_packed_read || !has_index_count(3u))
+                return nullptr;
+            set_offsets(packed, indices);
+            return std::make_unique<triangle_strain_constraint_t>(
+                std::move(indices),
+                wi,
+                packed,
+                sigma_min,
+                sigma_max);
+        }
+        case constraint_type_t::bending:
+        case constraint_type_t::isometric_bending: {
+            packed_hinge_t packed{};
+            if (!read_packed(reader, packed) || !has_index_count(4u))
+                return nullptr;
+            set_offsets(packed, indices);
+            if (type == constraint_type_t::bending)
+                return std::make_unique<bending_constraint_t>(std::move(indices), wi, packed);
+            return std::make_unique<isometric_bending_constraint_t>(
+                std::move(indices),
+                wi,
+                packed);
+        }
+        case constraint_type_t::half_space: {
+            Eigen::Vector3d n;
+            bool const is_n_read = reader.read_matrix(n);
+            auto const d         = reader.read<scalar_type>();
+            if (!is_n_read || !has_index_count(1u))
+                return nullptr;
+            return std::make_unique<half_space_constraint_t>(std::move(indices), wi, n, d);
+        }
+    }
+    return nullptr;
+}
+
+void write_factor(snapshot_writer_t& writer, ldlt_factor_t const& factor)
+{
+    auto const& L = factor.L;
+    writer.write_matrix(factor.permutation);
+    writer.write_matrix(factor.D);
+    writer.write(static_cast<std::uint64_t>(L.rows()));
+    writer.write(static_cast<std::uint64_t>(L.cols()));
+    writer.write(static_cast<std::uint64_t>(L.nonZeros()));
+    writer.write(L.outerIndexPtr(), static_cast<std::size_t>(L.outerSize()) + 1u);
+    writer.write(L.innerIndexPtr(), static_cast<std::size_t>(L.nonZeros()));
+    writer.write(L.valuePtr(), static_cast<std::size_t>(L.nonZeros()));
+}
+
+bool read_factor(snapshot_reader_t& reader, ldlt_factor_t& factor)
+{
+    using storage_index_type = ldlt_factor_t::sparse_matrix_type::StorageIndex;
+
+    if (!reader.read_matrix(factor.permutation) || !reader.read_matrix(factor.D))
+        return false;
+
+    auto const rows     = reader.read<std::uint64_t>();
+    auto const cols     = reader.read<std::uint64_t>();
+    auto const nnz      = reader.read<std::uint64_t>();
+    auto const n        = static_cast<std::uint64_t>(factor.D.size());
+    bool const is_valid = reader.ok() && rows == n && cols == n &&
+                          (factor.permutation.size() == 0 ||
+                           static_cast<std::uint64_t>(factor.permutation.size()) == n) &&
+                          nnz <= (n * n) / 2u;
+    if (!is_valid)
+        return false;
+
+    // the matrix is compressed after makeCompressed(), its arrays are read in place
+    auto& L = factor.L;
+    L.resize(static_cast<Eigen::Index>(rows), static_cast<Eigen::Index>(cols));
+    L.resizeNonZeros(static_cast<Eigen::Index>(nnz));
+    L.makeCompressed();
+    reader.read(L.outerIndexPtr(), sizeof(storage_index_type) * (cols + 1u));
+    reader.read(L.innerIndexPtr(), sizeof(storage_index_type) * nnz);
+    reader.read(L.valuePtr(), sizeof(double) * nnz);
+    if (!reader.ok() || L.outerIndexPtr()[0] != 0 ||
+        L.outerIndexPtr()[cols] != static_cast<storage_index_type>(nnz))
+        return false;
+
+    // the triangular solves index with P and L unchecked, reject out of range indices,
+    // and P must be a permutation, a repeated index would make it singular
+    auto const size = static_cast<storage_index_type>(n);
+    std::vector<bool> is_seen(static_cast<std::size_t>(factor.permutation.size()), false);
+    for (Eigen::Index i = 0; i < factor.permutation.size(); ++i)
+    {
+        auto const j = factor.permutation(i);
+        if (j < 0 || j >= size || is_seen[static_cast<std::size_t>(j)])
+            return false;
+        is_seen[static_cast<std::size_t>(j)] = true;
+    }
+
+    for (storage_index_type j = 0; j < size; ++j)
+    {
+        auto const begin = L.outerIndexPtr()[j];
+        auto const end   = L.outerIndexPtr()[j + 1];
+        if (begin > end || end > L.outerIndexPtr()[size])
+            return false;
+        for (auto k = begin; k < end; ++k)
+            if (L.innerIndexPtr()[k] <= j || L.innerIndexPtr()[k] >= size)
+                return false;
+    }
+    return true;
+}
+
+void write_header(snapshot_writer_t& writer)
+{
+    writer.write(snapshot_magic.data(), snapshot_magic.size());
+    writer.write(snapshot_version);
+    writer.write(snapshot_byte_order_mark);
+}
+
+bool read_header(snapshot_reader_t& reader)
+{
+    std::array<char, 8u> magic{};
+    reader.read(magic.data(), magic.size());
+    auto const version         = reader.read<std::uint32_t>();
+    auto const byte_order_mark = reader.read<std::uint32_t>();
+    return reader.ok() && magic == snapshot_magic && version == snapshot_version &&
+           byte_order_mark == snapshot_byte_order_mark;
+}
+
+/**
+ * Finalizer of splitmix64, a bijection of 64 bit words with good avalanche
+ */
+std::uint64_t mix(std::uint64_t x)
+{
+    x = (x ^ (x >> 30u)) * 0xbf58476d1ce4e5b9ull;
+    x = (x ^ (x >> 27u)) * 0x94d049bb133111ebull;
+    return x ^ (x >> 31u);
+}
+
+} // namespace detail
+
+bool save_snapshot(
+    std::string const& filename,
+    deformable_mesh_t const& model,
+    solver_t const* solver)
+{
+    std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+    if (!file)
+        return false;
+
+    detail::snapshot_writer_t writer(file);
+    detail::write_header(writer);
+
+    writer.begin_section(detail::snapshot_section_t::mesh);
+    writer.write_matrix(model.p0_);
+    writer.write_matrix(model.p_);
+    writer.write_matrix(model.v_);
+    writer.write_matrix(model.m_);
+    writer.write(static_cast<std::uint64_t>(model.fixed_.size()));
+    for (bool const is_fixed : model.fixed_)
+        writer.write(static_cast<std::uint8_t>(is_fixed));
+    writer.write_matrix(model.F_);
+    writer.write_matrix(model.E_);
+    writer.write(static_cast<std::uint64_t>(model.input_index_.size()));
+    writer.write(model.input_index_.data(), model.input_index_.size());
+    writer.write(static_cast<std::uint64_t>(model.vertex_index_.size()));
+    writer.write(model.vertex_index_.data(), model.vertex_index_.size());
+    writer.end_section();
+
+    if (!model.materials_.empty())
+    {
+        writer.begin_section(detail::snapshot_section_t::materials);
+        writer.write(static_cast<std::uint64_t>(model.materials_.size()));
+        for (auto const& lame : model.materials_.parameters())
+            detail::write_lame_parameters(writer, lame);
+        writer.end_section();
+    }
+
+    writer.begin_section(detail::snapshot_section_t::constraints);
+    writer.write(static_cast<std::uint64_t>(model.constraints_.size()));
+    for (auto const& constraint : model.constraints_)
+        detail::write_constraint(writer, *constraint);
+    writer.end_section();
+
+    cholesky_solver_t const* cholesky_solver =
+        solver != nullptr && solver->model() == &model && solver->ready() ?
+            solver->cholesky_solver() :
+            nullptr;
+    if (cholesky_solver != nullptr)
+    {
+        writer.begin_section(detail::snapshot_section_t::factorization);
+        writer.write(solver->dt());
+        detail::write_factor(writer, cholesky_solver->factor());
+        writer.end_section();
+    }
+
+    return static_cast<bool>(file);
+}
+
+bool load_snapshot(std::string const& filename, deformable_mesh_t& model, solver_t* solver)
+{
+    detail::mapped_file_t const mapped_file(filename);
+    if (mapped_file.data() == nullptr)
+        return false;
+
+    detail::snapshot_reader_t reader(mapped_file.data(), mapped_file.size());
+    if (!detail::read_header(reader))
+        return false;
+
+    // read into a new model, such that model is unchanged on failure
+    deformable_mesh_t snapshot{};
+    bool has_mesh   = false;
+    bool has_factor = false;
+    double dt{0.};
+    ldlt_factor_t factor{};
+    while (reader.ok() && !reader.at_end())
+    {
+        auto const section = static_cast<detail::snapshot_section_t>(reader.read<std::uint32_t>());
+        reader.read<std::uint32_t>();
+        auto const size = reader.read<std::uint64_t>();
+        if (!reader.ok() || size > mapped_file.size() - reader.position())
+            return false;
+
+        std::size_t const end = reader.position() + static_cast<std::size_t>((size + 7u) / 8u * 8u);
+        if (section == detail::snapshot_section_t::mesh)
+        {
+            reader.read_matrix(snapshot.p0_);
+            reader.read_matrix(snapshot.p_);
+            reader.read_matrix(snapshot.v_);
+            reader.read_matrix(snapshot.m_);
+
+            auto const N           = snapshot.p0_.rows();
+            auto const fixed_count = reader.read<std::uint64_t>();
+            if (!reader.ok() || snapshot.p0_.cols() != 3 || snapshot.p_.rows() != N ||
+                snapshot.p_.cols() != 3 || snapshot.v_.rows() != N || snapshot.v_.cols() != 3 ||
+                snapshot.m_.rows() != N || fixed_count != static_cast<std::uint64_t>(N))
+                return false;
+
+            std::vector<std::uint8_t> fixed(static_cast<std::size_t>(N));
+            reader.read(fixed.data(), fixed.size());
+            snapshot.fixed_.assign(fixed.begin(), fixed.end());
+
+            reader.read_matrix(snapshot.F_);
+            reader.read_matrix(snapshot.E_);
+            for (auto* index : {&snapshot.input_index_, &snapshot.vertex_index_})
+            {
+                auto const count = reader.read<std::uint64_t>();
+                if (count != 0u && count != static_cast<std::uint64_t>(N))
+                    return false;
+                index->resize(static_cast<std::size_t>(count));
+                reader.read(index->data(), sizeof(int) * index->size());
+            }
+
+            // faces are triangles, elements are tetrahedra or, for triangle meshes, the
+            // faces themselves. Every index must be a vertex, and the index maps must
+            // map back and forth between the input and the current vertex order.
+            auto const& F = snapshot.F_;
+            auto const& E = snapshot.E_;
+            if (!reader.ok() || (F.rows() > 0 && F.cols() != 3) ||
+                (E.rows() > 0 && E.cols() != 3 && E.cols() != 4) ||
+                !detail::are_vertex_indices(F, N) || !detail::are_vertex_indices(E, N) ||
+                !detail::are_inverse_permutations(snapshot.input_index_, snapshot.vertex_index_))
+                return false;
+
+            has_mesh = true;
+        }
+        else if (section == detail::snapshot_section_t::materials)
+        {
+            auto const count = reader.read<std::uint64_t>();
+            if (!has_mesh || count != static_cast<std::uint64_t>(snapshot.E_.rows()))
+                return false;
+
+            std::vector<lame_parameters_t> materials(static_cast<std::size_t>(count));
+            for (auto& lame : materials)
+                lame = detail::read_lame_parameters(reader);
+            snapshot.materials_ = material_field_t{std::move(materials)};
+        }
+        else if (section == detail::snapshot_section_t::constraints)
+        {
+            if (!has_mesh)
+                return false;
+
+            auto const count = reader.read<std::uint64_t>();
+            if (!reader.ok() || count > size)
+                return false;
+
+            auto const vertex_count = static_cast<std::size_t>(snapshot.p0_.rows());
+            snapshot.constraints_.reserve(static_cast<std::size_t>(count));
+            for (std::uint64_t c = 0u; c < count; ++c)
+            {
+                auto constraint = detail::read_constraint(reader, vertex_count);
+                if (constraint == nullptr)
+                    return false;
+                snapshot.constraints_.push_back(std::move(constraint));
+            }
+        }
+        else if (section == detail::snapshot_section_t::factorization)
+        {
+            dt         = reader.read<double>();
+            has_factor = detail::read_factor(reader, factor) &&
+                         factor.D.size() == 3 * snapshot.p0_.rows();
+        }
+        reader.seek(end);
+    }
+
+    if (!reader.ok() || !has_mesh)
+        return false;
+
+    model = std::move(snapshot);
+    if (solver != nullptr)
+    {
+        solver->set_model(&model);
+        if (has_factor)
+            solver->import_factorization(dt, std::move(factor));
+    }
+    return true;
+}
+
+std::uint64_t hash_matrix(Eigen::SparseMatrix<double> const& A)
+{
+    std::uint64_t seed = 0u;
+    auto const combine = [&](std::uint64_t value) {
+        seed = detail::mix(seed ^ (value + 0x9e3779b97f4a7c15ull + (seed << 6u) + (seed >> 2u)));
+    };
+
+    combine(static_cast<std::uint64_t>(A.rows()));
+    combine(static_cast<std::uint64_t>(A.cols()));
+    combine(static_cast<std::uint64_t>(A.nonZeros()));
+    for (Eigen::Index k = 0; k < A.outerSize(); ++k)
+    {
+        for (Eigen::SparseMatrix<double>::InnerIterator it(A, k); it; ++it)
+        {
+            std::uint64_t bits{};
+            double const value = it.value();
+            std::memcpy(&bits, &value, sizeof(bits));
+            combine(static_cast<std::uint64_t>(it.index()));
+            combine(bits);
+        }
+    }
+    return seed;
+}
+
+matrix_key_t get_matrix_key(Eigen::SparseMatrix<double> const& A)
+{
+    return matrix_key_t{
+        hash_matrix(A),
+        static_cast<std::uint64_t>(A.rows()),
+        static_cast<std::uint64_t>(A.nonZeros())};
+}
+
+bool save_factorization(
+    std::string const& filename,
+    matrix_key_t const& key,
+    ldlt_factor_t const& factor)
+{
+    std::string const temporary_filename =
+        filename + ".tmp" + std::to_string(std::random_device{}());
+    {
+        std::ofstream file(temporary_filename, std::ios::binary | std::ios::trunc);
+        if (!file)
+            return false;
+
+        detail::snapshot_writer_t writer(file);
+        detail::write_header(writer);
+        writer.begin_section(detail::snapshot_section_t::matrix_factor);
+        writer.write(key.hash);
+        writer.write(key.dimension);
+        writer.write(key.nonzeros);
+        detail::write_factor(writer, factor);
+        writer.end_section();
+        if (!file.flush())
+        {
+            file.close();
+            std::remove(temporary_filename.c_str());
+            return false;
+        }
+    }
+
+    if (std::rename(temporary_filename.c_str(), filename.c_str()) != 0)
+    {
+        std::remove(temporary_filename.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool load_factorization(
+    std::string const& filename,
+    matrix_key_t const& key,
+    ldlt_factor_t& factor)
+{
+    detail::mapped_file_t const mapped_file(filename);
+    if (mapped_file.data() == nullptr)
+        return false;
+
+    detail::snapshot_reader_t reader(mapped_file.data(), mapped_file.size());
+    if (!detail::read_header(reader))
+        return false;
+
+    while (reader.ok() && !reader.at_end())
+    {
+        auto const section = static_cast<detail::snapshot_section_t>(reader.read<std::uint32_t>());
+        reader.read<std::uint32_t>();
+        auto const size = reader.read<std::uint64_t>();
+        if (!reader.ok() || size > mapped_file.size() - reader.position())
+            return false;
+
+        std::size_t const end = reader.position() + static_cast<std::size_t>((size + 7u) / 8u * 8u);
+        if (section == detail::snapshot_section_t::matrix_factor)
+        {
+            auto const hash      = reader.read<std::uint64_t>();
+            auto const dimension = reader.read<std::uint64_t>();
+            auto const nonzeros  = reader.read<std::uint64_t>();
+            if (!reader.ok() || hash != key.hash || dimension != key.dimension ||
+                nonzeros != key.nonzeros)
+                return false;
+
+            ldlt_factor_t stored_factor{};
+            if (!detail::read_factor(reader, stored_factor) ||
+                static_cast<std::uint64_t>(stored_factor.D.size()) != key.dimension)
+                return false;
+
+            factor = std::move(stored_factor);
+            return true;
+        }
+        reader.seek(end);
+    }
+    return false;
+}
+
+std::string factorization_directory_from_environment()
+{
+    if (char const* directory = std::getenv("PD_FACTORIZATION_DIR"))
+        return directory;
+
+    return {};
+}
+
+} // namespace pd
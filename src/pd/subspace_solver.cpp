@@ -0,0 +1,325 @@
+#include "pd/subspace_solver.h"
+
+#include "pd/parallel.h"
+#include "pd/solver.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <limits>
+#include <map>
+
+namespace pd {
+namespace detail {
+
+/**
+ * Picks count of the given points by farthest point sampling, starting from the first
+ * point. Returns the indices of the picked points and, in covering_radius, the largest
+ * distance of any point to its nearest picked point.
+ */
+std::vector<std::size_t> farthest_point_sampling(
+    std::vector<Eigen::Vector3d> const& points,
+    std::size_t count,
+    double& covering_radius)
+{
+    std::vector<std::size_t> samples;
+    covering_radius = 0.;
+    if (points.empty() || count == 0u)
+        return samples;
+
+    auto const n = static_cast<std::ptrdiff_t>(points.size());
+    std::vector<double> distance(points.size(), std::numeric_limits<double>::max());
+    std::size_t next = 0u;
+    while (true)
+    {
+        samples.push_back(next);
+        Eigen::Vector3d const sample = points[next];
+        parallel_for(0, n, [&](std::ptrdiff_t i) {
+            distance[i] = std::min(distance[i], (points[i] - sample).norm());
+        });
+
+        auto const farthest = std::max_element(distance.begin(), distance.end());
+        covering_radius     = *farthest;
+        if (samples.size() == count || covering_radius == 0.)
+            break;
+        next = static_cast<std::size_t>(std::distance(distance.begin(), farthest));
+    }
+    return samples;
+}
+
+/**
+ * Wendland's C2 function, a smooth radial weight with support [0, 1)
+ */
+inline double wendland(double r)
+{
+    if (r >= 1.)
+        return 0.;
+    double const s = 1. - r;
+    return s * s * s * s * (4. * r + 1.);
+}
+
+} // namespace detail
+
+void subspace_solver_t::build_skinning_subspace()
+{
+    auto const& p = model_->positions();
+    auto const N   = p.rows();
+
+    std::vector<Eigen::Vector3d> points(static_cast<std::size_t>(N));
+    for (auto v = 0; v < N; ++v)
+        points[v] = p.row(v).transpose();
+
+    double covering_radius = 0.;
+    auto const handles     = detail::farthest_point_sampling(
+        points,
+        static_cast<std::size_t>(std::max(handle_count_, 1)),
+        covering_radius);
+    auto const H = static_cast<Eigen::Index>(handles.size());
+
+    // Every vertex lies within the covering radius of a handle, so with twice that
+    // support each vertex has a handle of positive weight, and the normalized weights
+    // are a partition of unity. The subspace then reproduces the rest shape, and every
+    // affine transformation of it.
+    double const support = covering_radius > 0. ? 2. * covering_radius : 1.;
+
+    std::vector<std::vector<Eigen::Triplet<scalar_type>>> rows(static_cast<std::size_t>(N));
+    parallel_for(0, N, [&](std::ptrdiff_t v) {
+        std::vector<std::pair<Eigen::Index, double>> weights;
+        double sum = 0.;
+        for (Eigen::Index j = 0; j < H; ++j)
+        {
+            double const w =
+                detail::wendland((points[v] - points[handles[j]]).norm() / support);
+            if (w > 0.)
+            {
+                weights.emplace_back(j, w);
+                sum += w;
+            }
+        }
+
+        auto& triplets = rows[v];
+        triplets.reserve(weights.size() * 12u);
+        for (auto const& [j, w] : weights)
+        {
+            double const wj = w / sum;
+            for (auto c = 0; c < 3; ++c)
+            {
+                auto const row = static_cast<int>(3 * v + c);
+                for (auto d = 0; d < 3; ++d)
+                    triplets.emplace_back(row, static_cast<int>(12 * j + 3 * c + d), wj * p(v, d));
+                triplets.emplace_back(row, static_cast<int>(12 * j + 9 + c), wj);
+            }
+        }
+    });
+
+    std::vector<Eigen::Triplet<scalar_type>> triplets;
+    for (auto const& row : rows)
+        triplets.insert(triplets.end(), row.begin(), row.end());
+
+    U_.resize(3 * N, 12 * H);
+    U_.setFromTriplets(triplets.begin(), triplets.end());
+}
+
+void subspace_solver_t::build_cubature()
+{
+    auto const& constraints = model_->constraints();
+    auto const& p           = model_->positions();
+
+    // Each constraint type gets its own samples, since constraints of different types
+    // do not stand in for each other. Positional constraints pin single vertices, which
+    // no other pin stands in for, so they are all kept with weight 1, and only the
+    // element and edge energies are sampled.
+    std::map<constraint_type_t, std::vector<std::size_t>> types;
+    for (std::size_t c = 0u; c < constraints.size(); ++c)
+        types[constraints[c]->type()].push_back(c);
+
+    cubature_.clear();
+    local_to_vertex_.clear();
+    std::vector<constraint_t::index_type> index_map(static_cast<std::size_t>(p.rows()));
+    for (auto const& [type, members] : types)
+    {
+        auto const count = static_cast<std::size_t>(std::max(sample_count_, 1));
+        std::vector<std::size_t> samples;
+        std::vector<scalar_type> weights;
+        if (type == constraint_type_t::positional || members.size() <= count)
+        {
+            samples.resize(members.size());
+            for (std::size_t k = 0u; k < members.size(); ++k)
+                samples[k] = k;
+            weights.assign(members.size(), scalar_type{1.});
+        }
+        else
+        {
+            std::vector<Eigen::Vector3d> centroids(members.size());
+            parallel_for(0, static_cast<std::ptrdiff_t>(members.size()), [&](std::ptrdiff_t k) {
+                auto const& indices      = constraints[members[k]]->indices();
+                Eigen::Vector3d centroid = Eigen::Vector3d::Zero();
+                for (auto const vi : indices)
+                    centroid += p.row(vi).transpose();
+                centroids[k] = centroid / static_cast<double>(indices.size());
+            });
+
+            // Each sample stands for the constraints in its Voronoi cell
+            double covering_radius = 0.;
+            samples = detail::farthest_point_sampling(centroids, count, covering_radius);
+
+            std::vector<std::size_t> nearest(members.size());
+            parallel_for(0, static_cast<std::ptrdiff_t>(members.size()), [&](std::ptrdiff_t k) {
+                double min_distance = std::numeric_limits<double>::max();
+                for (std::size_t s = 0u; s < samples.size(); ++s)
+                {
+                    double const distance = (centroids[k] - centroids[samples[s]]).squaredNorm();
+                    if (distance < min_distance)
+                    {
+                        min_distance = distance;
+                        nearest[k]   = s;
+                    }
+                }
+            });
+            weights.assign(samples.size(), scalar_type{0.});
+            for (auto const s : nearest)
+                weights[s] += scalar_type{1.};
+        }
+
+        for (std::size_t s = 0u; s < samples.size(); ++s)
+        {
+            auto const source              = members[samples[s]];
+            auto const& constraint         = *constraints[source];
+            auto const& indices            = constraint.indices();
+            std::size_t const first_vertex = local_to_vertex_.size();
+            for (std::size_t l = 0u; l < indices.size(); ++l)
+            {
+                index_map[indices[l]] = static_cast<constraint_t::index_type>(first_vertex + l);
+                local_to_vertex_.push_back(static_cast<int>(indices[l]));
+            }
+            cubature_.push_back(sample_t{
+                constraint.remapped(index_map),
+                source,
+                weights[s],
+                first_vertex,
+                indices.size()});
+        }
+    }
+
+    // Gather the rows of U of the local vertices
+    Eigen::SparseMatrix<scalar_type, Eigen::RowMajor> const U_rows = U_;
+    std::vector<Eigen::Triplet<scalar_type>> triplets;
+    for (std::size_t l = 0u; l < local_to_vertex_.size(); ++l)
+    {
+        for (auto c = 0; c < 3; ++c)
+        {
+            auto const row = 3 * local_to_vertex_[l] + c;
+            for (decltype(U_rows)::InnerIterator it(U_rows, row); it; ++it)
+                triplets.emplace_back(static_cast<int>(3 * l + c), it.col(), it.value());
+        }
+    }
+    U_local_.resize(3 * static_cast<Eigen::Index>(local_to_vertex_.size()), U_.cols());
+    U_local_.setFromTriplets(triplets.begin(), triplets.end());
+    U_local_transpose_ = U_local_.transpose();
+}
+
+void subspace_solver_t::prepare(scalar_type dt)
+{
+    assert(model_ != nullptr);
+
+    dt_ = dt;
+    if (U_.rows() != 3 * model_->positions().rows())
+        build_skinning_subspace();
+    build_cubature();
+
+    auto const& positions = model_->positions();
+    auto const& mass      = model_->mass();
+    auto const N          = positions.rows();
+
+    vector_type m(3 * N);
+    for (auto i = 0; i < N; ++i)
+        m.segment(3 * i, 3).setConstant(mass(i));
+    sparse_matrix_type const MU = m.asDiagonal() * U_;
+    M_reduced_                  = dense_matrix_type(U_.transpose() * MU);
+
+    // Reduce the constraints' part of the system matrix with the cubature
+    auto const local_count = static_cast<Eigen::Index>(local_to_vertex_.size());
+    Eigen::MatrixXd p_local(local_count, 3);
+    vector_type m_local(local_count);
+    for (Eigen::Index l = 0; l < local_count; ++l)
+    {
+        p_local.row(l) = positions.row(local_to_vertex_[l]);
+        m_local(l)     = mass(local_to_vertex_[l]);
+    }
+    std::vector<Eigen::Triplet<scalar_type>> triplets;
+    for (auto const& sample : cubature_)
+    {
+        auto const SiT_AiT_Ai_Si = sample.constraint->get_wi_SiT_AiT_Ai_Si(p_local, m_local);
+        for (auto const& t : SiT_AiT_Ai_Si)
+            triplets.emplace_back(t.row(), t.col(), sample.weight * t.value());
+    }
+    sparse_matrix_type K_local(3 * local_count, 3 * local_count);
+    K_local.setFromTriplets(triplets.begin(), triplets.end());
+
+    dense_matrix_type const A =
+        M_reduced_ / (dt * dt) + dense_matrix_type(U_local_transpose_ * (K_local * U_local_));
+    A_reduced_.compute(A);
+
+    // Start from the mass weighted least squares fit of the model's state
+    Eigen::LLT<dense_matrix_type> const M_llt(M_reduced_);
+    z_          = M_llt.solve(MU.transpose() * detail::flatten(positions));
+    z_velocity_ = M_llt.solve(MU.transpose() * detail::flatten(model_->velocity()));
+    if (f_reduced_.rows() != U_.cols())
+        f_reduced_ = vector_type::Zero(U_.cols());
+
+    dirty_ = false;
+}
+
+void subspace_solver_t::set_external_forces(Eigen::MatrixXd const& fext)
+{
+    assert(U_.rows() == 3 * fext.rows());
+    f_reduced_ = U_.transpose() * detail::flatten(fext);
+}
+
+void subspace_solver_t::step(int num_iterations)
+{
+    assert(ready());
+
+    auto const dt2_inv = scalar_type{1.} / (dt_ * dt_);
+
+    // (U^T * M * U / dt^2) * zn, with zn the explicit integration in the subspace
+    vector_type const momentum = M_reduced_ * (dt2_inv * (z_ + dt_ * z_velocity_)) + f_reduced_;
+    vector_type const z_previous = z_;
+
+    // Follow the targets the model's constraints were given since the last step
+    auto const& constraints = model_->constraints();
+    auto const sample_count = static_cast<std::ptrdiff_t>(cubature_.size());
+    parallel_for(0, sample_count, [&](std::ptrdiff_t s) {
+        auto& sample = cubature_[s];
+        sample.constraint->copy_targets(*constraints[sample.source]);
+    });
+
+    vector_type q_local;
+    vector_type b_local(U_local_.rows());
+    for (int k = 0; k < num_iterations; ++k)
+    {
+        q_local = U_local_ * z_;
+        b_local.setZero();
+
+        // Samples own disjoint local vertices, so they write disjoint parts of b_local
+        parallel_for(0, sample_count, [&](std::ptrdiff_t s) {
+            auto const& sample = cubature_[s];
+            sample.constraint->project_wi_SiT_AiT_Bi_pi(q_local, b_local);
+            b_local.segment(3 * sample.first_vertex, 3 * sample.vertex_count) *= sample.weight;
+        });
+
+        z_ = A_reduced_.solve(momentum + U_local_transpose_ * b_local);
+    }
+
+    z_velocity_ = (z_ - z_previous) / dt_;
+}
+
+void subspace_solver_t::reconstruct()
+{
+    assert(ready());
+
+    model_->positions() = detail::unflatten(U_ * z_);
+    model_->velocity()  = detail::unflatten(U_ * z_velocity_);
+}
+
+} // namespace pd
@@ -0,0 +1,187 @@
+#include "pd/surface_bvh.h"
+
+#include "pd/parallel.h"
+
+#include <algorithm>
+#include <limits>
+
+namespace pd {
+
+surface_bvh_t::box_type surface_bvh_t::face_box(Eigen::MatrixXd const& V, int f) const
+{
+    box_type box{};
+    for (int j = 0; j < 3; ++j)
+        box.extend(V.row(F_(f, j)).transpose());
+    return box;
+}
+
+void surface_bvh_t::build(Eigen::MatrixXd const& V, Eigen::MatrixXi const& F)
+{
+    F_ = F;
+    nodes_.clear();
+    faces_.resize(static_cast<std::size_t>(F.rows()));
+    for (int f = 0; f < F.rows(); ++f)
+        faces_[static_cast<std::size_t>(f)] = f;
+
+    if (F.rows() == 0)
+        return;
+
+    std::vector<Eigen::Vector3d> centroids(static_cast<std::size_t>(F.rows()));
+    parallel_for(0, F.rows(), [&](std::ptrdiff_t f) {
+        centroids[static_cast<std::size_t>(f)] =
+            (V.row(F(f, 0)) + V.row(F(f, 1)) + V.row(F(f, 2))).transpose() / 3.;
+    });
+
+    struct range_t
+    {
+        int node;
+        int begin;
+        int end;
+    };
+
+    nodes_.reserve(2u * faces_.size() / static_cast<std::size_t>(max_leaf_face_count_) + 1u);
+    nodes_.push_back(node_t{box_type{}, 0, static_cast<int>(F.rows())});
+    std::vector<range_t> stack{{0, 0, static_cast<int>(F.rows())}};
+    while (!stack.empty())
+    {
+        range_t const range = stack.back();
+        stack.pop_back();
+
+        int const count = range.end - range.begin;
+        if (count <= max_leaf_face_count_)
+        {
+            nodes_[static_cast<std::size_t>(range.node)] = node_t{box_type{}, range.begin, count};
+            continue;
+        }
+
+        box_type centroid_box{};
+        for (int i = range.begin; i < range.end; ++i)
+        {
+            auto const f = static_cast<std::size_t>(faces_[static_cast<std::size_t>(i)]);
+            centroid_box.extend(centroids[f]);
+        }
+
+        Eigen::Index axis = 0;
+        centroid_box.sizes().maxCoeff(&axis);
+
+        int const middle = range.begin + count / 2;
+        std::nth_element(
+            faces_.begin() + range.begin,
+            faces_.begin() + middle,
+            faces_.begin() + range.end,
+            [&](int a, int b) {
+                return centroids[static_cast<std::size_t>(a)](axis) <
+                       centroids[static_cast<std::size_t>(b)](axis);
+            });
+
+        int const first = static_cast<int>(nodes_.size());
+        nodes_[static_cast<std::size_t>(range.node)] = node_t{box_type{}, first, 0};
+        nodes_.push_back(node_t{box_type{}, range.begin, 0});
+        nodes_.push_back(node_t{box_type{}, middle, 0});
+        stack.push_back(range_t{first, range.begin, middle});
+        stack.push_back(range_t{first + 1, middle, range.end});
+    }
+
+    refit(V);
+}
+
+void surface_bvh_t::refit(Eigen::MatrixXd const& V)
+{
+    auto const node_count = static_cast<std::ptrdiff_t>(nodes_.size());
+    parallel_for(0, node_count, [&](std::ptrdiff_t i) {
+        auto& node = nodes_[static_cast<std::size_t>(i)];
+        if (node.count == 0)
+            return;
+
+        node.box.setEmpty();
+        for (int k = node.first; k < node.first + node.count; ++k)
+            node.box.extend(face_box(V, faces_[static_cast<std::size_t>(k)]));
+    });
+
+    // children are stored after their parents
+    for (std::ptrdiff_t i = node_count - 1; i >= 0; --i)
+    {
+        auto& node = nodes_[static_cast<std::size_t>(i)];
+        if (node.count != 0)
+            continue;
+
+        node.box = nodes_[static_cast<std::size_t>(node.first)].box.merged(
+            nodes_[static_cast<std::size_t>(node.first + 1)].box);
+    }
+}
+
+surface_bvh_t::ray_hit_t surface_bvh_t::intersect(
+    Eigen::MatrixXd const& V,
+    Eigen::Vector3d const& origin,
+    Eigen::Vector3d const& direction) const
+{
+    ray_hit_t hit{};
+    if (nodes_.empty())
+        return hit;
+
+    hit.t = std::numeric_limits<scalar_type>::max();
+    Eigen::Vector3d const inverse_direction = direction.cwiseInverse();
+
+    // slab test of the ray against a box, clipped to [0, hit.t]
+    auto const is_box_hit = [&](box_type const& box) {
+        Eigen::Vector3d const t0 = (box.min() - origin).cwiseProduct(inverse_direction);
+        Eigen::Vector3d const t1 = (box.max() - origin).cwiseProduct(inverse_direction);
+        scalar_type const t_enter = std::max(t0.cwiseMin(t1).maxCoeff(), scalar_type{0.});
+        scalar_type const t_exit  = std::min(t0.cwiseMax(t1).minCoeff(), hit.t);
+        return t_enter <= t_exit;
+    };
+
+    // Moller-Trumbore ray triangle intersection, for both orientations of the face
+    auto const intersect_face = [&](int f) {
+        Eigen::Vector3d const a  = V.row(F_(f, 0)).transpose();
+        Eigen::Vector3d const e1 = V.row(F_(f, 1)).transpose() - a;
+        Eigen::Vector3d const e2 = V.row(F_(f, 2)).transpose() - a;
+        Eigen::Vector3d const h  = direction.cross(e2);
+        scalar_type const det    = e1.dot(h);
+        if (det == scalar_type{0.})
+            return;
+
+        Eigen::Vector3d const s = origin - a;
+        scalar_type const u     = s.dot(h) / det;
+        if (u < 0. || u > 1.)
+            return;
+
+        Eigen::Vector3d const q = s.cross(e1);
+        scalar_type const v     = direction.dot(q) / det;
+        if (v < 0. || u + v > 1.)
+            return;
+
+        scalar_type const t = e2.dot(q) / det;
+        if (t < 0. || t >= hit.t)
+            return;
+
+        hit.face        = f;
+        hit.t           = t;
+        hit.barycentric = Eigen::Vector3d{1. - u - v, u, v};
+    };
+
+    std::vector<int> stack{0};
+    while (!stack.empty())
+    {
+        auto const& node = nodes_[static_cast<std::size_t>(stack.back())];
+        stack.pop_back();
+        if (!is_box_hit(node.box))
+            continue;
+
+        if (node.count == 0)
+        {
+            stack.push_back(node.first);
+            stack.push_back(node.first + 1);
+            continue;
+        }
+
+        for (int k = node.first; k < node.first + node.count; ++k)
+            intersect_face(faces_[static_cast<std::size_t>(k)]);
+    }
+
+    if (hit.face == -1)
+        hit.t = scalar_type{0.};
+    return hit;
+}
+
+} // namespace pd
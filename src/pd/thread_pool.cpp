@@ -0,0 +1,249 @@
+#include "pd/thread_pool.h"
+
+#include <cassert>
+#include <cstdlib>
+#include <sstream>
+#include <string>
+#include <utility>
+
+#if defined(__linux__)
+    #include <pthread.h>
+    #include <sched.h>
+#endif
+
+namespace pd {
+namespace detail {
+
+thread_local thread_pool_t const* current_thread_pool = nullptr;
+thread_local std::size_t current_worker               = 0u;
+
+std::mutex shared_thread_pool_mutex;
+std::unique_ptr<thread_pool_t> shared_thread_pool;
+std::atomic<thread_pool_t*> shared_thread_pool_pointer{nullptr}; ///< Lock free access
+
+/**
+ * Pins the thread to the core. Pinning is best effort, cores the process may not run
+ * on are ignored.
+ */
+void pin_to_core(std::thread& thread, int core)
+{
+#if defined(__linux__)
+    cpu_set_t cores;
+    CPU_ZERO(&cores);
+    CPU_SET(core, &cores);
+    pthread_setaffinity_np(thread.native_handle(), sizeof(cpu_set_t), &cores);
+#else
+    (void)thread;
+    (void)core;
+#endif
+}
+
+} // namespace detail
+
+thread_pool_options_t thread_pool_options_t::from_environment()
+{
+    thread_pool_options_t options{};
+    if (char const* thread_count = std::getenv("PD_THREAD_COUNT"))
+        options.thread_count = std::max(std::atoi(thread_count), 0);
+
+    if (char const* cores = std::getenv("PD_THREAD_CORES"))
+    {
+        std::istringstream stream{cores};
+        std::string core;
+        while (std::getline(stream, core, ','))
+        {
+            if (!core.empty())
+                options.cores.push_back(std::atoi(core.c_str()));
+        }
+    }
+    return options;
+}
+
+thread_pool_t::thread_pool_t(thread_pool_options_t options) : options_(std::move(options))
+{
+    int thread_count = options_.thread_count;
+    if (thread_count <= 0)
+        thread_count = std::max(static_cast<int>(std::thread::hardware_concurrency()), 1);
+
+    // the caller of a parallel loop is its first thread
+    auto const worker_count = static_cast<std::size_t>(thread_count - 1);
+    workers_.reserve(worker_count);
+    for (std::size_t w = 0u; w < worker_count; ++w)
+        workers_.push_back(std::make_unique<worker_t>());
+
+    for (std::size_t w = 0u; w < worker_count; ++w)
+    {
+        workers_[w]->thread = std::thread([this, w]() { work(w); });
+        if (!options_.cores.empty())
+            detail::pin_to_core(workers_[w]->thread, options_.cores[w % options_.cores.size()]);
+    }
+}
+
+thread_pool_t::~thread_pool_t()
+{
+    {
+        std::lock_guard<std::mutex> lock(sleep_mutex_);
+        stop_ = true;
+    }
+    wake_.notify_all();
+    for (auto& worker : workers_)
+        worker->thread.join();
+}
+
+void thread_pool_t::run_chunks(
+    std::ptrdiff_t chunk_count,
+    std::function<void(std::ptrdiff_t)> const& chunk)
+{
+    // the chunks reference this frame, which is only left once all of them are done
+    std::atomic<std::ptrdiff_t> remaining{chunk_count - 1};
+    for (std::ptrdiff_t c = 1; c < chunk_count; ++c)
+    {
+        push([&chunk, &remaining, c]() {
+            chunk(c);
+            remaining.fetch_sub(1, std::memory_order_acq_rel);
+        });
+    }
+    chunk(0);
+
+    task_type task;
+    while (remaining.load(std::memory_order_acquire) > 0)
+    {
+        if (try_take_chunk(task))
+        {
+            task();
+            task = nullptr;
+        }
+        else
+        {
+            std::this_thread::yield();
+        }
+    }
+}
+
+void thread_pool_t::push(task_type task)
+{
+    auto const worker = detail::current_thread_pool == this ?
+                            detail::current_worker :
+                            next_worker_.fetch_add(1u, std::memory_order_relaxed) % workers_.size();
+    {
+        std::lock_guard<std::mutex> lock(sleep_mutex_);
+        ++pending_;
+    }
+    {
+        std::lock_guard<std::mutex> lock(workers_[worker]->mutex);
+        workers_[worker]->tasks.push_back(std::move(task));
+    }
+    wake_.notify_one();
+}
+
+void thread_pool_t::push_background(task_type task)
+{
+    {
+        std::lock_guard<std::mutex> lock(sleep_mutex_);
+        ++pending_;
+    }
+    {
+        std::lock_guard<std::mutex> lock(background_mutex_);
+        background_tasks_.push_back(std::move(task));
+    }
+    wake_.notify_one();
+}
+
+bool thread_pool_t::try_take_chunk(task_type& task)
+{
+    auto const count     = workers_.size();
+    bool const is_worker = detail::current_thread_pool == this;
+    auto const first     = is_worker ? detail::current_worker :
+                                       next_worker_.load(std::memory_order_relaxed) % count;
+    if (is_worker)
+    {
+        auto& own = *workers_[first];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.tasks.empty())
+        {
+            task = std::move(own.tasks.back());
+            own.tasks.pop_back();
+            --pending_;
+            return true;
+        }
+    }
+    for (std::size_t k = is_worker ? 1u : 0u; k < count; ++k)
+    {
+        auto& victim = *workers_[(first + k) % count];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.tasks.empty())
+        {
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            --pending_;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool thread_pool_t::try_take_background(task_type& task)
+{
+    std::lock_guard<std::mutex> lock(background_mutex_);
+    if (background_tasks_.empty())
+        return false;
+
+    task = std::move(background_tasks_.front());
+    background_tasks_.pop_front();
+    --pending_;
+    return true;
+}
+
+void thread_pool_t::work(std::size_t worker)
+{
+    detail::current_thread_pool = this;
+    detail::current_worker      = worker;
+
+    task_type task;
+    while (true)
+    {
+        if (try_take_chunk(task) || try_take_background(task))
+        {
+            task();
+            task = nullptr;
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(sleep_mutex_);
+        wake_.wait(lock, [this]() { return stop_ || pending_.load() > 0u; });
+        if (stop_ && pending_.load() == 0u)
+            return;
+    }
+}
+
+thread_pool_t& thread_pool()
+{
+    if (auto* pool = detail::shared_thread_pool_pointer.load(std::memory_order_acquire))
+        return *pool;
+
+    std::lock_guard<std::mutex> lock(detail::shared_thread_pool_mutex);
+    if (!detail::shared_thread_pool)
+    {
+        detail::shared_thread_pool =
+            std::make_unique<thread_pool_t>(thread_pool_options_t::from_environment());
+        detail::shared_thread_pool_pointer.store(
+            detail::shared_thread_pool.get(),
+            std::memory_order_release);
+    }
+    return *detail::shared_thread_pool;
+}
+
+void set_thread_pool_options(thread_pool_options_t const& options)
+{
+    assert(detail::current_thread_pool == nullptr);
+
+    std::lock_guard<std::mutex> lock(detail::shared_thread_pool_mutex);
+    detail::shared_thread_pool_pointer.store(nullptr, std::memory_order_release);
+    detail::shared_thread_pool.reset();
+    detail::shared_thread_pool = std::make_unique<thread_pool_t>(options);
+    detail::shared_thread_pool_pointer.store(
+        detail::shared_thread_pool.get(),
+        std::memory_order_release);
+}
+
+} // namespace pd
@@ -0,0 +1,37 @@
+#include "pd/triangle_strain_constraint.h"
+
+namespace pd {
+
+triangle_strain_constraint_t::triangle_strain_constraint_t(
+    std::initializer_list<index_type> indices,
+    scalar_type wi,
+    positions_type const& p,
+    scalar_type sigma_min,
+    scalar_type sigma_max)
+    : base_type(indices, wi, p, triangle_strain_projection_t{sigma_min, sigma_max})
+{
+}
+
+triangle_strain_constraint_t::triangle_strain_constraint_t(
+    std::vector<index_type> indices,
+    scalar_type wi,
+    packed_triangle_t const& packed,
+    scalar_type sigma_min,
+    scalar_type sigma_max)
+    : base_type(
+          std::move(indices),
+          wi,
+          packed,
+          triangle_strain_projection_t{sigma_min, sigma_max})
+{
+}
+
+triangle_strain_constraint_t::scalar_type
+triangle_strain_constraint_t::evaluate(positions_type const& p, masses_type const& M) const
+{
+    Eigen::Matrix<scalar_type, 3, 2> const F = deformed_shape(p) * DmInv();
+    Eigen::Matrix<scalar_type, 3, 2> const P = policy().project(F);
+    return 0.5 * packed().weight * (F - P).squaredNorm();
+}
+
+} // namespace pd
@@ -13,16 +13,7 @@ int main(int argc, char** argv)
     };
 
     auto const compute_total_strain = [](pd::deformable_mesh_t const& mesh) {
-        double const total_strain = std::accumulate(
-            mesh.constraints().begin(),
-            mesh.constraints().end(),
-            0.,
-            [&](double const sum, std::unique_ptr<pd::constraint_t> const& constraint) {
-                double const C = constraint->evaluate(mesh.positions(), mesh.mass());
-                return sum + C;
-            });
-
-        return total_strain;
+        return mesh.elastic_potential();
     };
 
     std::vector<double> y{};
@@ -81,6 +72,7 @@ int main(int argc, char** argv)
 
     std::vector<double> y1{};
     std::vector<double> y2{};
+    std::vector<double> y3{};
     std::vector<int> x1{};
     std::vector<int> x2{};
     for (std::size_t i = 0u; i < 20u; ++i)
@@ -120,6 +112,23 @@ int main(int argc, char** argv)
         auto const solver_total_time =
             std::chrono::duration_cast<std::chrono::microseconds>(now - before).count();
 
+        // local step of the tetrahedra alone, i.e. the packed per-tet gather, 3x3 kernel
+        // and scatter, such that the throughput counts tetrahedra only
+        std::vector<pd::constraint_t const*> tets;
+        for (auto const& constraint : mesh.constraints())
+            if (constraint->type() == pd::constraint_type_t::deformation_gradient)
+                tets.push_back(constraint.get());
+
+        Eigen::VectorXd const q = pd::detail::flatten(mesh.positions());
+        Eigen::VectorXd b(q.rows());
+        b.setZero();
+        before = std::chrono::high_resolution_clock::now();
+        for (auto const* constraint : tets)
+            constraint->project_wi_SiT_AiT_Bi_pi(q, b);
+        now = std::chrono::high_resolution_clock::now();
+        auto const local_step_time =
+            std::chrono::duration_cast<std::chrono::microseconds>(now - before).count();
+
         double const time_for_prefactorization = static_cast<double>(prefactorization_duration);
         double const average_time_per_iteration =
             static_cast<double>(solver_total_time) / static_cast<double>(num_iterations);
@@ -127,6 +136,9 @@ int main(int argc, char** argv)
 
         y1.push_back(time_for_prefactorization);
         y2.push_back(average_time_per_iteration);
+        y3.push_back(
+            static_cast<double>(tets.size()) * 1e6 /
+            static_cast<double>(std::max(local_step_time, decltype(local_step_time){1})));
         x1.push_back(num_vertices);
         x2.push_back(mesh.constraints().size());
     }
@@ -163,6 +175,14 @@ int main(int argc, char** argv)
     axes5->grid(true);
     axes5->plot(x2, y2);
 
+    auto fig6  = matplot::figure();
+    auto axes6 = fig6->current_axes();
+    fig6->title("Local Step Throughput w.r.t. Vertex Count");
+    axes6->xlabel("Number of vertices");
+    axes6->ylabel("Tetrahedra per second");
+    axes6->grid(true);
+    axes6->plot(x1, y3);
+
     matplot::show();
 
     return 0;
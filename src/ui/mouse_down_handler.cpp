@@ -13,29 +13,35 @@ bool mouse_down_handler_t::operator()(igl::opengl::glfw::Viewer& viewer, int but
     if (static_cast<button_type>(button) != button_type::Left)
         return false;
 
-    bool const process_pick = modifier == GLFW_MOD_CONTROL || modifier == GLFW_MOD_SHIFT;
+    bool const process_pick =
+        modifier == GLFW_MOD_CONTROL || modifier == GLFW_MOD_SHIFT || modifier == GLFW_MOD_ALT;
 
-    int fid;
     double const x = static_cast<double>(viewer.current_mouse_x);
     double const y = viewer.core().viewport(3) - static_cast<double>(viewer.current_mouse_y);
-    picking_state->mouse_x = viewer.current_mouse_x;
-    picking_state->mouse_y = viewer.current_mouse_y;
-
-    Eigen::Vector3f bc{};
-
-    bool const hit = igl::unproject_onto_mesh(
-        Eigen::Vector2f(x, y),
-        viewer.core().view,
-        viewer.core().proj,
-        viewer.core().viewport,
-        model->positions(),
-        model->faces(),
-        fid,
-        bc);
-
-    if (!hit)
+
+    // cast the ray through the mouse from the near to the far plane
+    auto const unproject = [&](float z) {
+        return igl::unproject(
+                   Eigen::Vector3f(x, y, z),
+                   viewer.core().view,
+                   viewer.core().proj,
+                   viewer.core().viewport)
+            .cast<double>()
+            .eval();
+    };
+    Eigen::Vector3d const ray_begin = unproject(0.f);
+    Eigen::Vector3d const ray_end   = unproject(1.f);
+
+    if (surface_bvh->face_count() != model->faces().rows())
+        surface_bvh->build(model->positions(), model->faces());
+
+    auto const hit = surface_bvh->intersect(model->positions(), ray_begin, ray_end - ray_begin);
+    if (hit.face == -1)
         return false;
 
+    int const fid             = hit.face;
+    Eigen::Vector3d const& bc = hit.barycentric;
+
     Eigen::Vector3i const face{
         model->faces()(fid, 0),
         model->faces()(fid, 1),
@@ -53,14 +59,48 @@ bool mouse_down_handler_t::operator()(igl::opengl::glfw::Viewer& viewer, int but
 
     if (modifier == GLFW_MOD_CONTROL)
     {
+        // drag the vertex by a transient attachment, which the solver applies as a
+        // low rank update of its factorization instead of refactorizing
+        if (picking_state->attachment != nullptr)
+            solver->remove_transient_constraint(picking_state->attachment);
+
+        auto attachment = std::make_unique<pd::positional_constraint_t>(
+            std::initializer_list<pd::positional_constraint_t::index_type>{closest_vertex},
+            static_cast<double>(picking_state->stiffness),
+            model->positions());
         picking_state->is_picking = true;
         picking_state->vertex     = closest_vertex;
+        picking_state->attachment = attachment.get();
+        solver->add_transient_constraint(std::move(attachment));
     }
     if (modifier == GLFW_MOD_SHIFT)
     {
         model->toggle_fixed(closest_vertex, physics_params->mass_per_particle);
         model->add_positional_constraint(closest_vertex, physics_params->positional_constraint_wi);
         solver->set_dirty();
+        subspace_solver->set_dirty();
+    }
+    if (modifier == GLFW_MOD_ALT && model->elements().rows() > 1)
+    {
+        // tear the elements around the vertex out of the mesh, the solver bridges the
+        // refactorization with its previous factorization
+        std::vector<int> elements;
+        for (auto e = 0; e < model->elements().rows(); ++e)
+            for (auto j = 0; j < model->elements().cols(); ++j)
+                if (model->elements()(e, j) == static_cast<int>(closest_vertex))
+                    elements.push_back(e);
+
+        if (elements.size() < static_cast<std::size_t>(model->elements().rows()))
+        {
+            model->remove_elements(elements);
+            solver->update_topology();
+            subspace_solver->set_dirty();
+            if (auto* collision_detector = solver->collision_detector())
+                collision_detector->reset();
+            surface_bvh->build(model->positions(), model->faces());
+            viewer.data().clear();
+            viewer.data().set_mesh(model->positions(), model->faces());
+        }
     }
 
     return process_pick;
@@ -1,5 +1,12 @@
 #include "ui/pre_draw_handler.h"
 
+#include "pd/thread_pool.h"
+
+#include <filesystem>
+#include <igl/write_triangle_mesh.h>
+#include <iomanip>
+#include <sstream>
+
 namespace ui {
 
 bool pre_draw_handler_t::operator()(igl::opengl::glfw::Viewer& viewer)
@@ -24,6 +31,7 @@ bool pre_draw_handler_t::operator()(igl::opengl::glfw::Viewer& viewer)
         {
             model->mass()(i) = static_cast<double>(physics_params->mass_per_particle);
             solver->set_dirty();
+            subspace_solver->set_dirty();
         }
     }
 
@@ -31,16 +39,83 @@ bool pre_draw_handler_t::operator()(igl::opengl::glfw::Viewer& viewer)
     {
         fext->col(1).array() -= physics_params->mass_per_particle * (physics_params->is_gravity_active ? 9.81 : 0.);
 
-        if (!solver->ready())
+        // timestep changes are cheap, the solver keeps a cache of factorizations per dt
+        auto const dt = static_cast<double>(physics_params->dt);
+        solver->set_global_solver(static_cast<pd::global_solver_t>(physics_params->global_solver));
+        solver->set_subdomains(physics_params->subdomain_count, solver->subdomain_overlap());
+        auto acceleration = solver->chebyshev_acceleration();
+        acceleration.rho  = static_cast<double>(physics_params->chebyshev_rho);
+        solver->set_chebyshev_acceleration(acceleration);
+        solver->set_sleeping_active(physics_params->is_sleeping_active);
+        if (!solver->ready() || solver->dt() != dt)
         {
-            solver->prepare(physics_params->dt);
+            solver->prepare(dt);
         }
 
-        solver->step(*fext, physics_params->solver_iterations);
+        if (auto* collision_detector = solver->collision_detector())
+        {
+            collision_detector->set_floor(
+                physics_params->is_floor_active,
+                static_cast<double>(physics_params->floor_height));
+            collision_detector->set_self_collision_active(physics_params->is_self_collision_active);
+            collision_detector->set_thickness(
+                static_cast<double>(physics_params->collision_thickness));
+        }
+
+        if (physics_params->is_shape_target_animation_playing && !shape_target_animation->empty())
+        {
+            // shape targets stream into the constraints, they never trigger a refactorization
+            auto const start    = shape_target_animation->start_time();
+            auto const duration = shape_target_animation->end_time() - start;
+            auto& time          = physics_params->shape_target_animation_time;
+            if (time > duration)
+                time = 0.f;
+
+            shape_target_animation->apply(start + static_cast<double>(time), *model);
+            time += physics_params->dt;
+        }
+
+        if (physics_params->is_subspace_active)
+        {
+            if (subspace_solver->handle_count() != physics_params->subspace_handle_count)
+                subspace_solver->set_handle_count(physics_params->subspace_handle_count);
+            if (subspace_solver->sample_count() != physics_params->subspace_sample_count)
+                subspace_solver->set_sample_count(physics_params->subspace_sample_count);
+            if (!subspace_solver->ready() || subspace_solver->dt() != dt)
+                subspace_solver->prepare(dt);
+
+            subspace_solver->set_external_forces(*fext);
+            subspace_solver->step(physics_params->solver_iterations);
+            subspace_solver->reconstruct();
+        }
+        else
+        {
+            solver->set_mixed_precision(physics_params->is_mixed_precision_active);
+            solver->step(*fext, physics_params->solver_iterations);
+            // the subspace state is stale once the full solver moved the model
+            subspace_solver->set_dirty();
+        }
+        // the surface keeps its topology while simulating, so picking only needs a refit
+        surface_bvh->refit(model->positions());
 
         fext->setZero();
         viewer.data().clear();
         viewer.data().set_mesh(model->positions(), model->faces());
+
+        if (physics_params->is_frame_export_active)
+        {
+            // the frame is copied and written by the thread pool, the simulation does
+            // not wait for the disk
+            std::filesystem::create_directories("frames");
+            std::ostringstream filename;
+            filename << "frames/frame_" << std::setw(5) << std::setfill('0')
+                     << physics_params->exported_frame_count++ << ".obj";
+            pd::thread_pool().submit([filename = filename.str(),
+                                      V        = model->input_ordered_positions(),
+                                      F        = model->input_ordered_faces()]() {
+                igl::write_triangle_mesh(filename, V, F);
+            });
+        }
     }
 
     for (auto i = 0u; i < model->positions().rows(); ++i)